@@ -0,0 +1,166 @@
+// Сравнение роутеров на синтетическом городе: время построения и среднее время запроса.
+// Сборка из этой папки:
+//   g++ -std=c++20 -O2 -pthread -I../transport-catalogue router_bench.cpp
+//       ../transport-catalogue/{domain,geo,transport_catalogue,transport_router,raptor_router}.cpp -o router_bench
+// Запуск: router_bench [остановок] [автобусов] [остановок на автобус] [запросов] [роутеры...]
+// Роутеры: all_pairs dijkstra a_star contraction_hierarchies raptor. Ответы сверяются с первым из списка
+
+#include "transport_router.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <optional>
+#include <random>
+#include <string>
+#include <string_view>
+#include <vector>
+
+using namespace std;
+using namespace transport;
+using namespace transport_router;
+
+namespace {
+
+struct CityConfig {
+	size_t stops = 2000;
+	size_t buses = 200;
+	size_t stops_per_bus = 30;
+	size_t queries = 1000;
+};
+
+// Остановки на слегка сдвинутой сетке, автобусы - случайные блуждания по соседним узлам,
+// дорожное расстояние - геодезическое на 1..1.6. Некольцевые маршруты, как и в JsonReader, идут туда и обратно
+void BuildCity(TransportCatalogue& catalogue, const CityConfig& config, mt19937& random) {
+	const size_t side = static_cast<size_t>(ceil(sqrt(static_cast<double>(config.stops))));
+	uniform_real_distribution<double> jitter(-0.001, 0.001);
+	for (size_t i = 0; i < config.stops; ++i) {
+		const double lat = 55.5 + static_cast<double>(i / side) * 0.004 + jitter(random);
+		const double lng = 37.5 + static_cast<double>(i % side) * 0.006 + jitter(random);
+		catalogue.AddStop(Stop("S" + to_string(i), geo::Coordinates{ .lat = lat, .lng = lng }));
+	}
+
+	auto stops = catalogue.GetAllStops().begin();
+	uniform_real_distribution<double> curvature(1.0, 1.6);
+	uniform_int_distribution<size_t> pick_stop(0, config.stops - 1);
+	for (size_t bus = 0; bus < config.buses; ++bus) {
+		vector<size_t> route{ pick_stop(random) };
+		while (route.size() < config.stops_per_bus) {
+			const size_t row = route.back() / side;
+			const size_t col = route.back() % side;
+			vector<size_t> next;
+			if (col + 1 < side) next.push_back(route.back() + 1);
+			if (col > 0) next.push_back(route.back() - 1);
+			next.push_back(route.back() + side);
+			if (row > 0) next.push_back(route.back() - side);
+			next.erase(remove_if(next.begin(), next.end(), [&](size_t s) { return s >= config.stops; }), next.end());
+			route.push_back(next[uniform_int_distribution<size_t>(0, next.size() - 1)(random)]);
+		}
+
+		const bool is_round = bus % 2 == 0;
+		if (is_round) {
+			route.push_back(route.front());
+		}
+		vector<const Stop*> stop_ptrs;
+		for (size_t i = 0; i < route.size(); ++i) {
+			stop_ptrs.push_back(&stops[route[i]]);
+			if (i > 0 && catalogue.GetStopDistance(stop_ptrs[i - 1], stop_ptrs[i]) == 0) {
+				const double geo_distance = geo::ComputeDistance(stop_ptrs[i - 1]->coordinates_, stop_ptrs[i]->coordinates_);
+				catalogue.SetStopDistance(stop_ptrs[i - 1], stop_ptrs[i], max(1, static_cast<int>(geo_distance * curvature(random))));
+			}
+		}
+		if (!is_round) {
+			for (int i = static_cast<int>(stop_ptrs.size()) - 2; i >= 0; --i) {
+				stop_ptrs.push_back(stop_ptrs[i]);
+			}
+		}
+		catalogue.AddBus(Bus("B" + to_string(bus), move(stop_ptrs), is_round ? Type::RING : Type::NONRING));
+	}
+}
+
+optional<RouterType> ParseRouterType(string_view name) {
+	if (name == "all_pairs"sv) return RouterType::ALL_PAIRS;
+	if (name == "dijkstra"sv) return RouterType::DIJKSTRA;
+	if (name == "a_star"sv) return RouterType::A_STAR;
+	if (name == "contraction_hierarchies"sv) return RouterType::CONTRACTION_HIERARCHIES;
+	if (name == "raptor"sv) return RouterType::RAPTOR;
+	return nullopt;
+}
+
+double SecondsSince(chrono::steady_clock::time_point start) {
+	return chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
+
+}	// namespace
+
+int main(int argc, char* argv[]) {
+	CityConfig config;
+	size_t* numbers[] = { &config.stops, &config.buses, &config.stops_per_bus, &config.queries };
+	vector<string_view> router_names;
+	for (int i = 1; i < argc; ++i) {
+		if (i <= 4) {
+			*numbers[i - 1] = stoul(argv[i]);
+		} else {
+			router_names.push_back(argv[i]);
+		}
+	}
+	if (router_names.empty()) {
+		// все пары на больших городах строятся минутами и едят гигабайты
+		if (config.stops <= 2000) {
+			router_names.push_back("all_pairs"sv);
+		}
+		router_names.insert(router_names.end(), { "dijkstra"sv, "a_star"sv, "contraction_hierarchies"sv, "raptor"sv });
+	}
+
+	mt19937 random(42);
+	TransportCatalogue catalogue;
+	BuildCity(catalogue, config, random);
+	const auto stop_ptrs = catalogue.GetAllStopsPtrs();
+	vector<pair<const Stop*, const Stop*>> queries;
+	uniform_int_distribution<size_t> pick_stop(0, stop_ptrs.size() - 1);
+	for (size_t i = 0; i < config.queries; ++i) {
+		queries.emplace_back(stop_ptrs[pick_stop(random)], stop_ptrs[pick_stop(random)]);
+	}
+	cout << "stops: " << config.stops << ", buses: " << config.buses << " x " << config.stops_per_bus
+		<< ", queries: " << config.queries << endl;
+
+	vector<optional<double>> reference;
+	for (const string_view name : router_names) {
+		const auto type = ParseRouterType(name);
+		if (!type) {
+			cerr << "Unknown router: " << name << endl;
+			return EXIT_FAILURE;
+		}
+		const auto build_start = chrono::steady_clock::now();
+		const TransportRouter router(catalogue, 40, 6, *type);
+		const double build_seconds = SecondsSince(build_start);
+
+		vector<optional<double>> times;
+		times.reserve(queries.size());
+		const auto query_start = chrono::steady_clock::now();
+		for (const auto& [from, to] : queries) {
+			const auto route = router.BuildRoute(from, to);
+			times.push_back(route ? optional(route->toteal_time) : nullopt);
+		}
+		const double query_seconds = SecondsSince(query_start);
+
+		size_t mismatches = 0;
+		if (reference.empty()) {
+			reference = times;
+		} else {
+			for (size_t i = 0; i < times.size(); ++i) {
+				if (times[i].has_value() != reference[i].has_value()
+					|| (times[i] && abs(*times[i] - *reference[i]) > 1e-6 * max(1.0, *reference[i]))) {
+					++mismatches;
+				}
+			}
+		}
+		cout << left << setw(26) << name << right << fixed << setprecision(3)
+			<< "build " << setw(10) << build_seconds << " s, query " << setw(10)
+			<< query_seconds * 1e6 / static_cast<double>(max<size_t>(1, queries.size())) << " us"
+			<< ", mismatches " << mismatches << endl;
+	}
+}
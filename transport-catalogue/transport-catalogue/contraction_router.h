@@ -0,0 +1,491 @@
+#pragma once
+
+#include "graph.h"
+#include "parallel.h"
+
+#include <algorithm>
+#include <functional>
+#include <limits>
+#include <optional>
+#include <queue>
+#include <stdexcept>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+namespace graph {
+
+// Contraction hierarchies: вершины по очереди "стягиваются" в порядке возрастания
+// важности, а пути через стянутую вершину заменяются рёбрами-shortcut'ами. Запрос - двунаправленная
+// Дейкстра только вверх по рангу, она посещает сотни вершин вместо всего графа.
+// Порядок - по edge difference (shortcut'ов добавится минус рёбер уйдёт) плюс число уже стянутых соседей.
+// Стягивание идёт раундами: независимое множество вершин с локально минимальным приоритетом
+// обрабатывается параллельно. Shortcut'ы на ответе раскрываются обратно в исходные EdgeId
+template <typename Weight>
+class ContractionRouter {
+private:
+    using Graph = DirectedWeightedGraph<Weight>;
+
+public:
+    explicit ContractionRouter(const Graph& graph);
+
+    struct RouteInfo {
+        Weight weight;
+        std::vector<EdgeId> edges;
+    };
+
+    std::optional<RouteInfo> BuildRoute(VertexId from, VertexId to) const;
+
+    size_t GetShortcutCount() const {
+        return shortcut_count_;
+    }
+
+private:
+    static constexpr Weight ZERO_WEIGHT{};
+    static constexpr Weight INFINITE_WEIGHT = std::numeric_limits<Weight>::max();
+    static constexpr size_t NO_EDGE = std::numeric_limits<size_t>::max();
+    // поиск свидетеля обрывается после стольких просмотренных рёбер; не найденный свидетель -
+    // лишний shortcut, а не ошибка. Рёбра, а не вершины: в графе транспорта степени доходят до сотен
+    static constexpr size_t WITNESS_WORK_LIMIT = 20000;
+    // приоритет пересчитывается у соседей после каждого раунда, тут хватает грубой оценки
+    static constexpr size_t PRIORITY_WORK_LIMIT = 500;
+    // у вершины с большим in * out свидетелей не ищем, считаем, что нужны все shortcut'ы:
+    // такие вершины (пересадочные узлы) всё равно окажутся наверху иерархии
+    static constexpr size_t PRIORITY_DEGREE_LIMIT = 30;
+
+    // ребро иерархии: исходное ребро графа (original) или shortcut из двух рёбер иерархии first + second
+    struct HierarchyEdge {
+        VertexId from;
+        VertexId to;
+        Weight weight;
+        EdgeId original;
+        size_t first;
+        size_t second;
+    };
+
+    // to - другой конец ребра, edge - номер в edges_
+    struct Arc {
+        VertexId to;
+        Weight weight;
+        size_t edge;
+    };
+
+    // рёбра иерархии, сгруппированные по вершине
+    struct Arcs {
+        std::vector<size_t> offsets;
+        std::vector<Arc> arcs;
+
+        ranges::Range<typename std::vector<Arc>::const_iterator> Get(VertexId vertex) const {
+            return {arcs.begin() + offsets[vertex], arcs.begin() + offsets[vertex + 1]};
+        }
+    };
+
+    class Contractor;
+
+    void UnpackEdge(size_t edge, std::vector<EdgeId>& result) const;
+
+    std::vector<HierarchyEdge> edges_;
+    // up_[v] - рёбра v -> u, down_[v] - рёбра u -> v (to = u), в обоих ранг u выше ранга v
+    Arcs up_;
+    Arcs down_;
+    size_t shortcut_count_ = 0;
+};
+
+// Состояние стягивания, после построения не нужно
+template <typename Weight>
+class ContractionRouter<Weight>::Contractor {
+public:
+    Contractor(const Graph& graph, std::vector<HierarchyEdge>& edges)
+        : edges_(edges)
+        , out_(graph.GetVertexCount())
+        , in_(graph.GetVertexCount())
+        , contracted_(graph.GetVertexCount())
+        , in_round_(graph.GetVertexCount())
+        , deleted_neighbors_(graph.GetVertexCount())
+        , priorities_(graph.GetVertexCount())
+        , up_(graph.GetVertexCount())
+        , down_(graph.GetVertexCount())
+        , scratches_(detail::GetWorkerCount())
+    {
+        // из параллельных рёбер нужно только самое лёгкое, петли не нужны вовсе
+        std::vector<EdgeId> order;
+        order.reserve(graph.GetEdgeCount());
+        for (EdgeId edge_id = 0; edge_id < graph.GetEdgeCount(); ++edge_id) {
+            const auto& edge = graph.GetEdge(edge_id);
+            if (edge.weight < ZERO_WEIGHT) {
+                throw std::domain_error("Edges' weights should be non-negative");
+            }
+            if (edge.from != edge.to) {
+                order.push_back(edge_id);
+            }
+        }
+        std::sort(order.begin(), order.end(), [&graph](EdgeId lhs, EdgeId rhs) {
+            const auto& l = graph.GetEdge(lhs);
+            const auto& r = graph.GetEdge(rhs);
+            return std::tie(l.from, l.to, l.weight, lhs) < std::tie(r.from, r.to, r.weight, rhs);
+        });
+        for (size_t i = 0; i < order.size(); ++i) {
+            const auto& edge = graph.GetEdge(order[i]);
+            if (i > 0 && graph.GetEdge(order[i - 1]).from == edge.from && graph.GetEdge(order[i - 1]).to == edge.to) {
+                continue;
+            }
+            AddEdge(HierarchyEdge{edge.from, edge.to, edge.weight, order[i], NO_EDGE, NO_EDGE});
+        }
+        for (auto& scratch : scratches_) {
+            scratch.weights.assign(graph.GetVertexCount(), INFINITE_WEIGHT);
+            scratch.is_target.assign(graph.GetVertexCount(), false);
+        }
+    }
+
+    // стягивает все вершины; up/down - рёбра к более важным вершинам, как в ContractionRouter
+    void Run(Arcs& up, Arcs& down) {
+        const size_t vertex_count = out_.size();
+        std::vector<VertexId> remaining(vertex_count);
+        for (VertexId vertex = 0; vertex < vertex_count; ++vertex) {
+            remaining[vertex] = vertex;
+        }
+        UpdatePriorities(remaining);
+
+        std::vector<char> selected(vertex_count);
+        std::vector<std::vector<HierarchyEdge>> shortcuts;
+        while (!remaining.empty()) {
+            // независимое множество: вершины, которые важнее каждого своего соседа не считаются
+            detail::ParallelFor(remaining.size(), [&](size_t i, size_t) {
+                selected[remaining[i]] = IsLocalMinimum(remaining[i]);
+            });
+            std::vector<VertexId> round;
+            for (const VertexId vertex : remaining) {
+                if (selected[vertex]) {
+                    round.push_back(vertex);
+                    in_round_[vertex] = true;
+                }
+            }
+
+            // свидетели ищутся в обход всего раунда, поэтому shortcut'ы разных вершин друг от друга не зависят
+            shortcuts.assign(round.size(), {});
+            detail::ParallelFor(round.size(), [&](size_t i, size_t worker) {
+                FindShortcuts(round[i], scratches_[worker], WITNESS_WORK_LIMIT, &shortcuts[i]);
+            });
+
+            std::vector<VertexId> neighbors;
+            for (size_t i = 0; i < round.size(); ++i) {
+                Contract(round[i], neighbors);
+                for (const HierarchyEdge& shortcut : shortcuts[i]) {
+                    AddEdge(shortcut);
+                }
+            }
+            for (const VertexId vertex : round) {
+                in_round_[vertex] = false;
+                selected[vertex] = false;
+            }
+
+            std::sort(neighbors.begin(), neighbors.end());
+            neighbors.erase(std::unique(neighbors.begin(), neighbors.end()), neighbors.end());
+            UpdatePriorities(neighbors);
+
+            remaining.erase(std::remove_if(remaining.begin(), remaining.end(), [this](VertexId vertex) {
+                return contracted_[vertex] != 0;
+            }), remaining.end());
+        }
+
+        Flatten(up_, up);
+        Flatten(down_, down);
+    }
+
+private:
+    struct Scratch {
+        std::vector<Weight> weights;
+        std::vector<VertexId> touched;
+        std::vector<std::pair<Weight, VertexId>> heap;
+        std::vector<char> is_target;
+    };
+
+    void AddEdge(const HierarchyEdge& edge) {
+        auto& out = out_[edge.from];
+        auto it = std::find_if(out.begin(), out.end(), [&edge](const Arc& arc) {
+            return arc.to == edge.to;
+        });
+        if (it != out.end() && it->weight <= edge.weight) {
+            return;
+        }
+        const size_t edge_index = edges_.size();
+        edges_.push_back(edge);
+        if (it != out.end()) {
+            *it = Arc{edge.to, edge.weight, edge_index};
+            auto& in = in_[edge.to];
+            *std::find_if(in.begin(), in.end(), [&edge](const Arc& arc) {
+                return arc.to == edge.from;
+            }) = Arc{edge.from, edge.weight, edge_index};
+        } else {
+            out.push_back(Arc{edge.to, edge.weight, edge_index});
+            in_[edge.to].push_back(Arc{edge.from, edge.weight, edge_index});
+        }
+    }
+
+    bool IsBlocked(VertexId vertex) const {
+        return contracted_[vertex] || in_round_[vertex];
+    }
+
+    bool IsLocalMinimum(VertexId vertex) const {
+        const auto key = std::pair{priorities_[vertex], vertex};
+        auto is_less = [&](const std::vector<Arc>& arcs) {
+            return std::all_of(arcs.begin(), arcs.end(), [&](const Arc& arc) {
+                return key < std::pair{priorities_[arc.to], arc.to};
+            });
+        };
+        return is_less(out_[vertex]) && is_less(in_[vertex]);
+    }
+
+    // Дейкстра из source по нестянутым вершинам, кроме via; останавливается, когда дошла до всех target_count
+    // отмеченных в scratch.is_target вершин, ушла дальше limit или просмотрела work_limit рёбер
+    void WitnessSearch(Scratch& scratch, VertexId source, VertexId via, Weight limit, size_t work_limit,
+                       size_t target_count) const {
+        auto& heap = scratch.heap;
+        auto by_weight = std::greater<std::pair<Weight, VertexId>>{};
+        scratch.weights[source] = ZERO_WEIGHT;
+        scratch.touched.push_back(source);
+        heap.emplace_back(ZERO_WEIGHT, source);
+        for (size_t work = 0; !heap.empty() && work < work_limit;) {
+            std::pop_heap(heap.begin(), heap.end(), by_weight);
+            const auto [weight, vertex] = heap.back();
+            heap.pop_back();
+            if (weight > scratch.weights[vertex]) {
+                continue;
+            }
+            if (weight > limit) {
+                break;
+            }
+            if (scratch.is_target[vertex] && --target_count == 0) {
+                break;
+            }
+            work += out_[vertex].size() + 1;
+            for (const Arc& arc : out_[vertex]) {
+                if (arc.to == via || IsBlocked(arc.to)) {
+                    continue;
+                }
+                const Weight candidate = weight + arc.weight;
+                if (candidate < scratch.weights[arc.to]) {
+                    if (scratch.weights[arc.to] == INFINITE_WEIGHT) {
+                        scratch.touched.push_back(arc.to);
+                    }
+                    scratch.weights[arc.to] = candidate;
+                    heap.emplace_back(candidate, arc.to);
+                    std::push_heap(heap.begin(), heap.end(), by_weight);
+                }
+            }
+        }
+        heap.clear();
+    }
+
+    // shortcut'ы, без которых нельзя стянуть vertex; возвращает их число, сами пишет в result, если он есть
+    size_t FindShortcuts(VertexId vertex, Scratch& scratch, size_t work_limit,
+                         std::vector<HierarchyEdge>* result) const {
+        // в вершину, куда можно войти только из vertex, свидетеля нет - поиск к ней не нужен.
+        // В графе транспорта так устроены вершины посадки: в них ведёт лишь ребро ожидания
+        for (const Arc& out_arc : out_[vertex]) {
+            scratch.is_target[out_arc.to] = !IsBlocked(out_arc.to)
+                && std::any_of(in_[out_arc.to].begin(), in_[out_arc.to].end(), [this, vertex](const Arc& arc) {
+                    return arc.to != vertex && !IsBlocked(arc.to);
+                });
+        }
+
+        size_t count = 0;
+        for (const Arc& in_arc : in_[vertex]) {
+            if (IsBlocked(in_arc.to)) {
+                continue;
+            }
+            Weight max_out = ZERO_WEIGHT;
+            size_t target_count = 0;
+            for (const Arc& out_arc : out_[vertex]) {
+                if (out_arc.to != in_arc.to && scratch.is_target[out_arc.to]) {
+                    max_out = std::max(max_out, out_arc.weight);
+                    ++target_count;
+                }
+            }
+            // source тоже может быть целью (своё же ребро обратно), поэтому цель на одну больше
+            if (target_count > 0) {
+                WitnessSearch(scratch, in_arc.to, vertex, in_arc.weight + max_out, work_limit,
+                              target_count + (scratch.is_target[in_arc.to] ? 1 : 0));
+            }
+            for (const Arc& out_arc : out_[vertex]) {
+                if (out_arc.to == in_arc.to || IsBlocked(out_arc.to)) {
+                    continue;
+                }
+                // найденный свидетель не длиннее - путь через vertex не нужен
+                const Weight via_weight = in_arc.weight + out_arc.weight;
+                if (scratch.weights[out_arc.to] > via_weight) {
+                    ++count;
+                    if (result) {
+                        result->push_back(HierarchyEdge{in_arc.to, out_arc.to, via_weight, NO_EDGE,
+                                                        in_arc.edge, out_arc.edge});
+                    }
+                }
+            }
+            for (const VertexId touched : scratch.touched) {
+                scratch.weights[touched] = INFINITE_WEIGHT;
+            }
+            scratch.touched.clear();
+        }
+        for (const Arc& out_arc : out_[vertex]) {
+            scratch.is_target[out_arc.to] = false;
+        }
+        return count;
+    }
+
+    void UpdatePriorities(const std::vector<VertexId>& vertices) {
+        detail::ParallelFor(vertices.size(), [&](size_t i, size_t worker) {
+            const VertexId vertex = vertices[i];
+            const size_t degree_product = out_[vertex].size() * in_[vertex].size();
+            const auto shortcuts = static_cast<long long>(degree_product > PRIORITY_DEGREE_LIMIT
+                ? degree_product
+                : FindShortcuts(vertex, scratches_[worker], PRIORITY_WORK_LIMIT, nullptr));
+            const auto removed = static_cast<long long>(out_[vertex].size() + in_[vertex].size());
+            priorities_[vertex] = shortcuts - removed + deleted_neighbors_[vertex];
+        });
+    }
+
+    // убирает vertex из графа; всё, что у него осталось, ведёт к более важным вершинам
+    void Contract(VertexId vertex, std::vector<VertexId>& neighbors) {
+        contracted_[vertex] = true;
+        for (const Arc& arc : out_[vertex]) {
+            auto& in = in_[arc.to];
+            in.erase(std::find_if(in.begin(), in.end(), [vertex](const Arc& a) { return a.to == vertex; }));
+            ++deleted_neighbors_[arc.to];
+            neighbors.push_back(arc.to);
+        }
+        for (const Arc& arc : in_[vertex]) {
+            auto& out = out_[arc.to];
+            out.erase(std::find_if(out.begin(), out.end(), [vertex](const Arc& a) { return a.to == vertex; }));
+            ++deleted_neighbors_[arc.to];
+            neighbors.push_back(arc.to);
+        }
+        up_[vertex] = std::move(out_[vertex]);
+        down_[vertex] = std::move(in_[vertex]);
+        out_[vertex].clear();
+        in_[vertex].clear();
+    }
+
+    static void Flatten(std::vector<std::vector<Arc>>& by_vertex, Arcs& result) {
+        result.offsets.reserve(by_vertex.size() + 1);
+        result.offsets.push_back(0);
+        for (auto& arcs : by_vertex) {
+            result.arcs.insert(result.arcs.end(), arcs.begin(), arcs.end());
+            result.offsets.push_back(result.arcs.size());
+            arcs = {};
+        }
+    }
+
+    std::vector<HierarchyEdge>& edges_;
+    // рабочий граф из ещё не стянутых вершин: out_[v] - рёбра v -> to, in_[v] - рёбра to -> v
+    std::vector<std::vector<Arc>> out_;
+    std::vector<std::vector<Arc>> in_;
+    std::vector<char> contracted_;
+    std::vector<char> in_round_;
+    std::vector<long long> deleted_neighbors_;
+    std::vector<long long> priorities_;
+    std::vector<std::vector<Arc>> up_;
+    std::vector<std::vector<Arc>> down_;
+    std::vector<Scratch> scratches_;
+};
+
+template <typename Weight>
+ContractionRouter<Weight>::ContractionRouter(const Graph& graph) {
+    Contractor contractor(graph, edges_);
+    const size_t original_count = edges_.size();
+    contractor.Run(up_, down_);
+    shortcut_count_ = edges_.size() - original_count;
+}
+
+template <typename Weight>
+std::optional<typename ContractionRouter<Weight>::RouteInfo> ContractionRouter<Weight>::BuildRoute(VertexId from,
+                                                                                                   VertexId to) const {
+    const size_t vertex_count = up_.offsets.size() - 1;
+    if (from >= vertex_count || to >= vertex_count) {
+        throw std::out_of_range("Vertex id is out of range");
+    }
+
+    using QueueItem = std::pair<Weight, VertexId>;
+    using Queue = std::priority_queue<QueueItem, std::vector<QueueItem>, std::greater<>>;
+    // 0 - вперёд от from по up_, 1 - назад от to по down_
+    std::vector<Weight> weights[2] = {std::vector<Weight>(vertex_count, INFINITE_WEIGHT),
+                                      std::vector<Weight>(vertex_count, INFINITE_WEIGHT)};
+    std::vector<size_t> parents[2] = {std::vector<size_t>(vertex_count, NO_EDGE),
+                                      std::vector<size_t>(vertex_count, NO_EDGE)};
+    Queue queues[2];
+    const Arcs* arcs[2] = {&up_, &down_};
+
+    weights[0][from] = ZERO_WEIGHT;
+    weights[1][to] = ZERO_WEIGHT;
+    queues[0].emplace(ZERO_WEIGHT, from);
+    queues[1].emplace(ZERO_WEIGHT, to);
+    Weight best = INFINITE_WEIGHT;
+    VertexId meeting = from;
+
+    // направление заканчивается, когда его минимум не лучше уже найденного пути
+    while (true) {
+        for (auto& queue : queues) {
+            if (!queue.empty() && queue.top().first >= best) {
+                queue = {};
+            }
+        }
+        if (queues[0].empty() && queues[1].empty()) {
+            break;
+        }
+        const int side = queues[1].empty() || (!queues[0].empty() && queues[0].top() <= queues[1].top()) ? 0 : 1;
+        const auto [weight, vertex] = queues[side].top();
+        queues[side].pop();
+        if (weight > weights[side][vertex]) {
+            continue;
+        }
+        if (weights[1 - side][vertex] != INFINITE_WEIGHT && weight + weights[1 - side][vertex] < best) {
+            best = weight + weights[1 - side][vertex];
+            meeting = vertex;
+        }
+        for (const Arc& arc : arcs[side]->Get(vertex)) {
+            const Weight candidate = weight + arc.weight;
+            if (candidate < weights[side][arc.to]) {
+                weights[side][arc.to] = candidate;
+                parents[side][arc.to] = arc.edge;
+                queues[side].emplace(candidate, arc.to);
+            }
+        }
+    }
+
+    if (best == INFINITE_WEIGHT) {
+        return std::nullopt;
+    }
+
+    // рёбра иерархии от from до meeting, затем от meeting до to
+    std::vector<size_t> hierarchy_edges;
+    for (VertexId vertex = meeting; parents[0][vertex] != NO_EDGE; vertex = edges_[parents[0][vertex]].from) {
+        hierarchy_edges.push_back(parents[0][vertex]);
+    }
+    std::reverse(hierarchy_edges.begin(), hierarchy_edges.end());
+    for (VertexId vertex = meeting; parents[1][vertex] != NO_EDGE; vertex = edges_[parents[1][vertex]].to) {
+        hierarchy_edges.push_back(parents[1][vertex]);
+    }
+
+    std::vector<EdgeId> edges;
+    for (const size_t edge : hierarchy_edges) {
+        UnpackEdge(edge, edges);
+    }
+    return RouteInfo{best, std::move(edges)};
+}
+
+template <typename Weight>
+void ContractionRouter<Weight>::UnpackEdge(size_t edge, std::vector<EdgeId>& result) const {
+    std::vector<size_t> stack{edge};
+    while (!stack.empty()) {
+        const HierarchyEdge& current = edges_[stack.back()];
+        stack.pop_back();
+        if (current.original != NO_EDGE) {
+            result.push_back(current.original);
+        } else {
+            // second кладётся первым, чтобы first раскрылся раньше
+            stack.push_back(current.second);
+            stack.push_back(current.first);
+        }
+    }
+}
+
+}  // namespace graph
@@ -0,0 +1,121 @@
+#pragma once
+
+#include "graph.h"
+
+#include <algorithm>
+#include <functional>
+#include <limits>
+#include <optional>
+#include <queue>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace graph {
+
+// Маршрут ищется на каждый запрос (A* на двоичной куче), заранее ничего не считается:
+// построение O(E), память O(V + E) против O(V^3) и O(V^2) у Router.
+// potential(v, to) - нижняя оценка веса пути из v в to. Она должна быть согласованной,
+// weight(u -> v) >= potential(u, to) - potential(v, to), иначе маршрут может оказаться не кратчайшим.
+// Без potential это обычная Дейкстра
+template <typename Weight>
+class DijkstraRouter {
+private:
+    using Graph = DirectedWeightedGraph<Weight>;
+
+public:
+    using Potential = std::function<Weight(VertexId vertex, VertexId to)>;
+
+    explicit DijkstraRouter(const Graph& graph, Potential potential = {});
+
+    struct RouteInfo {
+        Weight weight;
+        std::vector<EdgeId> edges;
+    };
+
+    std::optional<RouteInfo> BuildRoute(VertexId from, VertexId to) const;
+
+private:
+    static constexpr Weight ZERO_WEIGHT{};
+    static constexpr Weight INFINITE_WEIGHT = std::numeric_limits<Weight>::max();
+    static constexpr EdgeId NO_EDGE = std::numeric_limits<EdgeId>::max();
+
+    const Graph& graph_;
+    Potential potential_;
+};
+
+template <typename Weight>
+DijkstraRouter<Weight>::DijkstraRouter(const Graph& graph, Potential potential)
+    : graph_(graph)
+    , potential_(std::move(potential))
+{
+    for (EdgeId edge_id = 0; edge_id < graph.GetEdgeCount(); ++edge_id) {
+        if (graph.GetEdge(edge_id).weight < ZERO_WEIGHT) {
+            throw std::domain_error("Edges' weights should be non-negative");
+        }
+    }
+}
+
+template <typename Weight>
+std::optional<typename DijkstraRouter<Weight>::RouteInfo> DijkstraRouter<Weight>::BuildRoute(VertexId from,
+                                                                                             VertexId to) const {
+    const size_t vertex_count = graph_.GetVertexCount();
+    if (from >= vertex_count || to >= vertex_count) {
+        throw std::out_of_range("Vertex id is out of range");
+    }
+
+    // состояние поиска своё у каждого запроса, так что BuildRoute можно звать из разных потоков
+    std::vector<Weight> weights(vertex_count, INFINITE_WEIGHT);
+    std::vector<EdgeId> prev_edges(vertex_count, NO_EDGE);
+    std::vector<bool> settled(vertex_count);
+    // оценка считается один раз на вершину, она может быть дорогой (геодезическое расстояние)
+    std::vector<Weight> potentials(potential_ ? vertex_count : 0, INFINITE_WEIGHT);
+    auto potential = [&](VertexId vertex) {
+        if (!potential_) {
+            return ZERO_WEIGHT;
+        }
+        if (potentials[vertex] == INFINITE_WEIGHT) {
+            potentials[vertex] = potential_(vertex, to);
+        }
+        return potentials[vertex];
+    };
+
+    using QueueItem = std::pair<Weight, VertexId>;
+    std::priority_queue<QueueItem, std::vector<QueueItem>, std::greater<>> queue;
+    weights[from] = ZERO_WEIGHT;
+    queue.emplace(potential(from), from);
+    while (!queue.empty()) {
+        const VertexId vertex = queue.top().second;
+        queue.pop();
+        // в куче остаются устаревшие записи, их просто пропускаем
+        if (settled[vertex]) {
+            continue;
+        }
+        if (vertex == to) {
+            break;
+        }
+        settled[vertex] = true;
+        for (const EdgeId edge_id : graph_.GetIncidentEdges(vertex)) {
+            const auto& edge = graph_.GetEdge(edge_id);
+            const Weight candidate_weight = weights[vertex] + edge.weight;
+            if (candidate_weight < weights[edge.to]) {
+                weights[edge.to] = candidate_weight;
+                prev_edges[edge.to] = edge_id;
+                queue.emplace(candidate_weight + potential(edge.to), edge.to);
+            }
+        }
+    }
+
+    if (weights[to] == INFINITE_WEIGHT) {
+        return std::nullopt;
+    }
+    std::vector<EdgeId> edges;
+    for (EdgeId edge_id = prev_edges[to]; edge_id != NO_EDGE; edge_id = prev_edges[graph_.GetEdge(edge_id).from]) {
+        edges.push_back(edge_id);
+    }
+    std::reverse(edges.begin(), edges.end());
+
+    return RouteInfo{weights[to], std::move(edges)};
+}
+
+}  // namespace graph
@@ -157,7 +157,23 @@ void JsonReader::GetDescription(const Array& discription) {
 void JsonReader::GetRoutingSetting(const json::Dict& routing_settings) {
 	double velocity = routing_settings.at("bus_velocity").AsDouble();
 	int wait_time = routing_settings.at("bus_wait_time").AsInt();
-	router_.emplace(catalogue_, velocity, wait_time);
+	// "router" необязателен, по умолчанию все пары считаются заранее, как раньше
+	transport_router::RouterType router_type = transport_router::RouterType::ALL_PAIRS;
+	if (auto it = routing_settings.find("router"); it != routing_settings.end()) {
+		const std::string& name = it->second.AsString();
+		if (name == "dijkstra"sv) {
+			router_type = transport_router::RouterType::DIJKSTRA;
+		} else if (name == "a_star"sv) {
+			router_type = transport_router::RouterType::A_STAR;
+		} else if (name == "contraction_hierarchies"sv) {
+			router_type = transport_router::RouterType::CONTRACTION_HIERARCHIES;
+		} else if (name == "raptor"sv) {
+			router_type = transport_router::RouterType::RAPTOR;
+		} else if (name != "all_pairs"sv) {
+			throw std::invalid_argument("Unknown router: " + name);
+		}
+	}
+	router_.emplace(catalogue_, velocity, wait_time, router_type);
 }
 
 void JsonReader::GetRequest(const Array& requests) {	// Здесь тоже массив нод, которые словари
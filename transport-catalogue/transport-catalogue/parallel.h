@@ -0,0 +1,42 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <thread>
+#include <vector>
+
+namespace graph {
+
+namespace detail {
+
+inline size_t GetWorkerCount() {
+    return std::max(1u, std::thread::hardware_concurrency());
+}
+
+// fn(i, worker) для всех i из [0, count) на всех ядрах; worker - номер потока для его личных буферов
+// min_parallel_count: на маленьких пачках запуск потоков дороже самой работы, тогда всё идёт в текущем потоке
+template <typename Fn>
+void ParallelFor(size_t count, const Fn& fn, size_t min_parallel_count = 64) {
+    const size_t worker_count = count < min_parallel_count ? 1 : std::min(GetWorkerCount(), count);
+    if (worker_count == 1) {
+        for (size_t i = 0; i < count; ++i) {
+            fn(i, size_t{0});
+        }
+        return;
+    }
+    std::atomic<size_t> next{0};
+    std::vector<std::jthread> workers;
+    workers.reserve(worker_count);
+    for (size_t worker = 0; worker < worker_count; ++worker) {
+        workers.emplace_back([&fn, &next, count, worker] {
+            for (size_t i = next.fetch_add(1); i < count; i = next.fetch_add(1)) {
+                fn(i, worker);
+            }
+        });
+    }
+}
+
+}  // namespace detail
+
+}  // namespace graph
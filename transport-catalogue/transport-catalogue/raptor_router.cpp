@@ -0,0 +1,145 @@
+#include "raptor_router.h"
+
+#include <algorithm>
+
+using namespace transport;
+using namespace std;
+
+namespace transport_router {
+
+RaptorRouter::RaptorRouter(const TransportCatalogue& catalogue, double meters_per_minute, int wait_time)
+	: meters_per_minute_(meters_per_minute), wait_time_(wait_time) {
+	const auto& all_stops = catalogue.GetAllStops();
+	for (const Stop& stop : all_stops) {
+		stop_ids_.emplace(&stop, stop_ids_.size());
+	}
+
+	// Расстояния целые, так что разность сумм от начала маршрута в точности равна сумме перегонов
+	vector<size_t> stop_route_counts(all_stops.size() + 1);
+	route_offsets_.push_back(0);
+	for (const Bus& bus : catalogue.GetAllBuses()) {
+		const auto& stops = bus.GetStops();
+		double total_distance = 0;
+		for (size_t i = 0; i < stops.size(); ++i) {
+			if (i > 0) {
+				total_distance += catalogue.GetStopDistance(stops[i - 1], stops[i]);
+			}
+			route_stops_.push_back(stop_ids_.at(stops[i]));
+			route_distances_.push_back(total_distance);
+			++stop_route_counts[route_stops_.back() + 1];
+		}
+		buses_.push_back(&bus);
+		route_offsets_.push_back(route_stops_.size());
+	}
+
+	// маршруты по остановкам: подсчёт, префиксные суммы, раскладка
+	stop_offsets_.resize(all_stops.size() + 1);
+	for (size_t stop = 0; stop < all_stops.size(); ++stop) {
+		stop_offsets_[stop + 1] = stop_offsets_[stop] + stop_route_counts[stop + 1];
+	}
+	stop_routes_.resize(route_stops_.size());
+	vector<size_t> next(stop_offsets_.begin(), stop_offsets_.end() - 1);
+	for (size_t route = 0; route < buses_.size(); ++route) {
+		for (size_t i = route_offsets_[route]; i < route_offsets_[route + 1]; ++i) {
+			stop_routes_[next[route_stops_[i]]++] = { route, i - route_offsets_[route] };
+		}
+	}
+}
+
+optional<RaptorRouter::Journey> RaptorRouter::BuildRoute(const Stop* from, const Stop* to) const {
+	const auto from_it = stop_ids_.find(from);
+	const auto to_it = stop_ids_.find(to);
+	if (from_it == stop_ids_.end() || to_it == stop_ids_.end()) {
+		return nullopt;
+	}
+	const size_t source = from_it->second;
+	const size_t target = to_it->second;
+	const size_t stop_count = stop_ids_.size();
+
+	// labels[k][s] заполнена, только если в раунде k остановку s улучшили; best - лучшее время за все раунды
+	vector<vector<Label>> labels(1, vector<Label>(stop_count));
+	vector<double> best(stop_count, INFINITE_TIME);
+	labels[0][source].time = 0;
+	best[source] = 0;
+
+	vector<size_t> marked{ source };
+	vector<char> is_marked(stop_count);
+	is_marked[source] = true;
+	vector<size_t> route_start(buses_.size(), NONE);
+	vector<size_t> routes;
+	vector<size_t> next_marked;
+	while (!marked.empty()) {
+		// маршруты через улучшенные остановки, каждый - с самой ранней такой позиции
+		for (const size_t stop : marked) {
+			for (size_t i = stop_offsets_[stop]; i < stop_offsets_[stop + 1]; ++i) {
+				const auto [route, position] = stop_routes_[i];
+				if (route_start[route] == NONE) {
+					routes.push_back(route);
+				}
+				route_start[route] = min(route_start[route], position);
+			}
+		}
+
+		labels.emplace_back(stop_count);
+		const auto& previous = labels[labels.size() - 2];
+		auto& current = labels.back();
+		for (const size_t route : routes) {
+			const size_t offset = route_offsets_[route];
+			const size_t length = route_offsets_[route + 1] - offset;
+			size_t board = NONE;
+			double board_time = INFINITE_TIME;
+			for (size_t position = route_start[route]; position < length; ++position) {
+				const size_t stop = route_stops_[offset + position];
+				double arrival = INFINITE_TIME;
+				if (board != NONE) {
+					arrival = board_time + GetRideTime(route, board, position);
+					// хуже уже известного сюда или до цели - не интересно
+					if (arrival < min(best[stop], best[target])) {
+						if (current[stop].route == NONE) {
+							next_marked.push_back(stop);
+						}
+						current[stop] = Label{ arrival, route, board, position };
+						best[stop] = arrival;
+					}
+				}
+				// Пересаживаться имеет смысл только на остановках, улучшенных в прошлом раунде:
+				// с остальных этот маршрут уже просмотрен раньше, а время от момента посадки не зависит
+				if (is_marked[stop] && previous[stop].time + wait_time_ < arrival) {
+					board = position;
+					board_time = previous[stop].time + wait_time_;
+				}
+			}
+			route_start[route] = NONE;
+		}
+		routes.clear();
+
+		for (const size_t stop : marked) {
+			is_marked[stop] = false;
+		}
+		for (const size_t stop : next_marked) {
+			is_marked[stop] = true;
+		}
+		marked.swap(next_marked);
+		next_marked.clear();
+	}
+
+	if (best[target] == INFINITE_TIME) {
+		return nullopt;
+	}
+	// цель последний раз улучшалась в раунде с лучшим временем, от него идём по поездкам назад
+	size_t round = labels.size() - 1;
+	while (round > 0 && labels[round][target].route == NONE) {
+		--round;
+	}
+	Journey result{ best[target], {} };
+	for (size_t stop = target; round > 0; --round) {
+		const Label& label = labels[round][stop];
+		result.legs.push_back(Leg{ buses_[label.route], label.board, label.alight,
+			GetRideTime(label.route, label.board, label.alight) });
+		stop = route_stops_[route_offsets_[label.route] + label.board];
+	}
+	reverse(result.legs.begin(), result.legs.end());
+	return result;
+}
+
+}	// namespace transport_router
@@ -0,0 +1,68 @@
+#pragma once
+
+#include "transport_catalogue.h"
+
+#include <limits>
+#include <optional>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace transport_router {
+
+// RAPTOR: маршрут ищется прямо по последовательностям остановок автобусов, без графа.
+// Раунд k - лучшие времена прибытия ровно с k посадками: каждый маршрут, через который проходит
+// улучшенная в прошлом раунде остановка, просматривается один раз от первой такой остановки.
+// Расписания нет, поэтому посадка всегда стоит wait_time, а поездка - расстояние по маршруту / скорость.
+// Раунд линеен по суммарной длине просмотренных маршрутов, рёбер "каждая с каждой" нет вовсе
+class RaptorRouter {
+public:
+	RaptorRouter(const transport::TransportCatalogue& catalogue, double meters_per_minute, int wait_time);
+
+	// поездка на bus от его остановки номер board до остановки alight (номера в bus->GetStops())
+	struct Leg {
+		const transport::Bus* bus;
+		size_t board;
+		size_t alight;
+		double time;	// только в автобусе, ожидание - wait_time перед каждой поездкой
+	};
+
+	struct Journey {
+		double total_time;
+		std::vector<Leg> legs;
+	};
+
+	std::optional<Journey> BuildRoute(const transport::Stop* from, const transport::Stop* to) const;
+
+private:
+	static constexpr size_t NONE = std::numeric_limits<size_t>::max();
+	static constexpr double INFINITE_TIME = std::numeric_limits<double>::infinity();
+
+	// метка остановки в раунде: время прибытия и поездка, которой приехали
+	struct Label {
+		double time = INFINITE_TIME;
+		size_t route = NONE;
+		size_t board = 0;
+		size_t alight = 0;
+	};
+
+	double GetRideTime(size_t route, size_t board, size_t alight) const {
+		return (route_distances_[route_offsets_[route] + alight] - route_distances_[route_offsets_[route] + board])
+			/ meters_per_minute_;
+	}
+
+	double meters_per_minute_;
+	double wait_time_;
+	std::unordered_map<const transport::Stop*, size_t> stop_ids_;
+	// маршруты подряд: остановки маршрута r - [route_offsets_[r], route_offsets_[r + 1]),
+	// для каждой - номер остановки и расстояние от начала маршрута
+	std::vector<const transport::Bus*> buses_;
+	std::vector<size_t> route_offsets_;
+	std::vector<size_t> route_stops_;
+	std::vector<double> route_distances_;
+	// маршруты через остановку s с позицией на маршруте - [stop_offsets_[s], stop_offsets_[s + 1])
+	std::vector<size_t> stop_offsets_;
+	std::vector<std::pair<size_t, size_t>> stop_routes_;
+};
+
+}	// namespace transport_router
@@ -1,24 +1,33 @@
 #pragma once
 
 #include "graph.h"
+#include "parallel.h"
 
 #include <algorithm>
-#include <cassert>
+#include <array>
 #include <cstdint>
-#include <iterator>
+#include <limits>
 #include <optional>
 #include <stdexcept>
-#include <unordered_map>
+#include <type_traits>
 #include <utility>
 #include <vector>
 
 namespace graph {
 
+// Кратчайшие пути между всеми парами вершин, ответ на запрос - только раскрутка пути.
+// Матрица плоская и разбита на плитки TILE_SIZE x TILE_SIZE, каждая плитка лежит в памяти подряд.
+// Вес пути хранится во float (нет пути - бесконечность), последнее ребро пути - в uint32_t,
+// то есть 8 байт на пару вместо optional<RouteInternalData> в 32 байта.
+// Флойд-Уоршелл блочный: на каждом шаге сначала диагональная плитка, потом её строка и столбец,
+// потом все остальные плитки, плитки одной фазы независимы и считаются параллельно
 template <typename Weight>
 class Router {
 private:
     using Graph = DirectedWeightedGraph<Weight>;
 
+    static_assert(std::is_floating_point_v<Weight>, "Router stores route weights as float");
+
 public:
     explicit Router(const Graph& graph);
 
@@ -30,88 +39,152 @@ public:
     std::optional<RouteInfo> BuildRoute(VertexId from, VertexId to) const;
 
 private:
-    struct RouteInternalData {
-        Weight weight;
-        std::optional<EdgeId> prev_edge;
-    };
-    using RoutesInternalData = std::vector<std::vector<std::optional<RouteInternalData>>>;
+    using StoredWeight = float;
+    using StoredEdgeId = std::uint32_t;
+
+    // 64 float - 256 байт на строку плитки, три плитки с рёбрами помещаются в L2
+    static constexpr size_t TILE_SIZE = 64;
+    static constexpr StoredWeight NO_ROUTE = std::numeric_limits<StoredWeight>::infinity();
+    static constexpr StoredEdgeId NO_EDGE = std::numeric_limits<StoredEdgeId>::max();
+
+    size_t GetIndex(VertexId from, VertexId to) const {
+        return ((from / TILE_SIZE) * tile_count_ + to / TILE_SIZE) * TILE_SIZE * TILE_SIZE
+            + (from % TILE_SIZE) * TILE_SIZE + to % TILE_SIZE;
+    }
+
+    size_t GetTileIndex(size_t tile_row, size_t tile_col) const {
+        return (tile_row * tile_count_ + tile_col) * TILE_SIZE * TILE_SIZE;
+    }
 
     void InitializeRoutesInternalData(const Graph& graph) {
-        const size_t vertex_count = graph.GetVertexCount();
-        for (VertexId vertex = 0; vertex < vertex_count; ++vertex) {
-            routes_internal_data_[vertex][vertex] = RouteInternalData{ZERO_WEIGHT, std::nullopt};
+        for (VertexId vertex = 0; vertex < tile_count_ * TILE_SIZE; ++vertex) {
+            weights_[GetIndex(vertex, vertex)] = 0;
+        }
+        for (VertexId vertex = 0; vertex < graph.GetVertexCount(); ++vertex) {
             for (const EdgeId edge_id : graph.GetIncidentEdges(vertex)) {
                 const auto& edge = graph.GetEdge(edge_id);
-                if (edge.weight < ZERO_WEIGHT) {
+                if (edge.weight < Weight{}) {
                     throw std::domain_error("Edges' weights should be non-negative");
                 }
-                auto& route_internal_data = routes_internal_data_[vertex][edge.to];
-                if (!route_internal_data || route_internal_data->weight > edge.weight) {
-                    route_internal_data = RouteInternalData{edge.weight, edge_id};
+                const size_t index = GetIndex(vertex, edge.to);
+                const auto weight = static_cast<StoredWeight>(edge.weight);
+                if (weight < weights_[index]) {
+                    weights_[index] = weight;
+                    prev_edges_[index] = static_cast<StoredEdgeId>(edge_id);
                 }
             }
         }
     }
 
-    void RelaxRoute(VertexId vertex_from, VertexId vertex_to, const RouteInternalData& route_from,
-                    const RouteInternalData& route_to) {
-        auto& route_relaxing = routes_internal_data_[vertex_from][vertex_to];
-        const Weight candidate_weight = route_from.weight + route_to.weight;
-        if (!route_relaxing || candidate_weight < route_relaxing->weight) {
-            route_relaxing = {candidate_weight,
-                              route_to.prev_edge ? route_to.prev_edge : route_from.prev_edge};
+    // Одна строка плитки через вершину k: вход - путь from -> k, row - строка k плитки-источника.
+    // Без ветвлений и с непересекающимися указателями, чтобы цикл векторизовался:
+    // ребро выбирается маской, а не тернарником (с ним gcc видит в цикле переходы)
+    static void RelaxRow(StoredWeight* __restrict weights, StoredEdgeId* __restrict prev_edges,
+                         const StoredWeight* __restrict row_weights, const StoredEdgeId* __restrict row_prev_edges,
+                         StoredWeight weight_through, StoredEdgeId edge_through) {
+        for (size_t col = 0; col < TILE_SIZE; ++col) {
+            const StoredWeight candidate_weight = weight_through + row_weights[col];
+            // у пути k -> k нет рёбер, тогда последнее ребро - от пути from -> k
+            const StoredEdgeId candidate_edge = row_prev_edges[col] == NO_EDGE ? edge_through : row_prev_edges[col];
+            const StoredEdgeId better = StoredEdgeId{0} - static_cast<StoredEdgeId>(candidate_weight < weights[col]);
+            prev_edges[col] = (candidate_edge & better) | (prev_edges[col] & ~better);
+            weights[col] = std::min(weights[col], candidate_weight);
         }
     }
 
-    void RelaxRoutesInternalDataThroughVertex(size_t vertex_count, VertexId vertex_through) {
-        for (VertexId vertex_from = 0; vertex_from < vertex_count; ++vertex_from) {
-            if (const auto& route_from = routes_internal_data_[vertex_from][vertex_through]) {
-                for (VertexId vertex_to = 0; vertex_to < vertex_count; ++vertex_to) {
-                    if (const auto& route_to = routes_internal_data_[vertex_through][vertex_to]) {
-                        RelaxRoute(vertex_from, vertex_to, *route_from, *route_to);
-                    }
+    // target = min(target, through + source) по всем k плитки. Плитки могут совпадать
+    // (диагональ, её строка и столбец): строку k копируем заранее, а пути через k с k не меняются
+    void RelaxTile(size_t target, size_t through, size_t source) {
+        std::array<StoredWeight, TILE_SIZE> row_weights;
+        std::array<StoredEdgeId, TILE_SIZE> row_prev_edges;
+        for (size_t k = 0; k < TILE_SIZE; ++k) {
+            std::copy_n(&weights_[source + k * TILE_SIZE], TILE_SIZE, row_weights.begin());
+            std::copy_n(&prev_edges_[source + k * TILE_SIZE], TILE_SIZE, row_prev_edges.begin());
+            for (size_t row = 0; row < TILE_SIZE; ++row) {
+                const StoredWeight weight_through = weights_[through + row * TILE_SIZE + k];
+                if (weight_through == NO_ROUTE) {
+                    continue;
                 }
+                RelaxRow(&weights_[target + row * TILE_SIZE], &prev_edges_[target + row * TILE_SIZE],
+                         row_weights.data(), row_prev_edges.data(),
+                         weight_through, prev_edges_[through + row * TILE_SIZE + k]);
             }
         }
     }
 
-    static constexpr Weight ZERO_WEIGHT{};
+    void RelaxRoutesInternalDataThroughTile(size_t tile_through) {
+        const size_t diagonal = GetTileIndex(tile_through, tile_through);
+        RelaxTile(diagonal, diagonal, diagonal);
+
+        // плитка - крупная работа, параллелим даже пару штук
+        constexpr size_t MIN_PARALLEL_TILES = 2;
+        const size_t other_tiles = tile_count_ - 1;
+        auto other = [tile_through](size_t i) {
+            return i < tile_through ? i : i + 1;
+        };
+        detail::ParallelFor(2 * other_tiles, [&](size_t i, size_t) {
+            if (i < other_tiles) {
+                const size_t tile = GetTileIndex(tile_through, other(i));
+                RelaxTile(tile, diagonal, tile);
+            } else {
+                const size_t tile = GetTileIndex(other(i - other_tiles), tile_through);
+                RelaxTile(tile, tile, diagonal);
+            }
+        }, MIN_PARALLEL_TILES);
+        detail::ParallelFor(other_tiles * other_tiles, [&](size_t i, size_t) {
+            const size_t tile_row = other(i / other_tiles);
+            const size_t tile_col = other(i % other_tiles);
+            RelaxTile(GetTileIndex(tile_row, tile_col), GetTileIndex(tile_row, tile_through),
+                      GetTileIndex(tile_through, tile_col));
+        }, MIN_PARALLEL_TILES);
+    }
+
     const Graph& graph_;
-    RoutesInternalData routes_internal_data_;
+    size_t tile_count_;
+    std::vector<StoredWeight> weights_;
+    std::vector<StoredEdgeId> prev_edges_;
 };
 
 template <typename Weight>
 Router<Weight>::Router(const Graph& graph)
     : graph_(graph)
-    , routes_internal_data_(graph.GetVertexCount(),
-                            std::vector<std::optional<RouteInternalData>>(graph.GetVertexCount()))
+    , tile_count_((graph.GetVertexCount() + TILE_SIZE - 1) / TILE_SIZE)
+    , weights_(tile_count_ * tile_count_ * TILE_SIZE * TILE_SIZE, NO_ROUTE)
+    , prev_edges_(weights_.size(), NO_EDGE)
 {
+    if (graph.GetEdgeCount() >= NO_EDGE) {
+        throw std::length_error("Too many edges for Router");
+    }
     InitializeRoutesInternalData(graph);
 
-    const size_t vertex_count = graph.GetVertexCount();
-    for (VertexId vertex_through = 0; vertex_through < vertex_count; ++vertex_through) {
-        RelaxRoutesInternalDataThroughVertex(vertex_count, vertex_through);
+    for (size_t tile_through = 0; tile_through < tile_count_; ++tile_through) {
+        RelaxRoutesInternalDataThroughTile(tile_through);
     }
 }
 
 template <typename Weight>
 std::optional<typename Router<Weight>::RouteInfo> Router<Weight>::BuildRoute(VertexId from,
                                                                              VertexId to) const {
-    const auto& route_internal_data = routes_internal_data_.at(from).at(to);
-    if (!route_internal_data) {
+    const size_t vertex_count = graph_.GetVertexCount();
+    if (from >= vertex_count || to >= vertex_count) {
+        throw std::out_of_range("Vertex id is out of range");
+    }
+    if (weights_[GetIndex(from, to)] == NO_ROUTE) {
         return std::nullopt;
     }
-    const Weight weight = route_internal_data->weight;
+    // в матрице вес округлён до float, поэтому точный вес собираем по рёбрам
+    Weight weight{};
     std::vector<EdgeId> edges;
-    for (std::optional<EdgeId> edge_id = route_internal_data->prev_edge;
-         edge_id;
-         edge_id = routes_internal_data_[from][graph_.GetEdge(*edge_id).from]->prev_edge)
+    for (StoredEdgeId edge_id = prev_edges_[GetIndex(from, to)];
+         edge_id != NO_EDGE;
+         edge_id = prev_edges_[GetIndex(from, graph_.GetEdge(edge_id).from)])
     {
-        edges.push_back(*edge_id);
+        edges.push_back(edge_id);
+        weight += graph_.GetEdge(edge_id).weight;
     }
     std::reverse(edges.begin(), edges.end());
 
     return RouteInfo{weight, std::move(edges)};
 }
 
-}  // namespace graph
\ No newline at end of file
+}  // namespace graph
@@ -1,4 +1,9 @@
 #include "transport_router.h"
+
+#include <cmath>
+#include <limits>
+#include <numbers>
+
 using namespace transport;
 using namespace graph;
 using namespace std;
@@ -6,19 +11,36 @@ using namespace std;
 namespace transport_router {
 
 
-TransportRouter::TransportRouter(const transport::TransportCatalogue& catalogue, double velocity, int wait_time)
+TransportRouter::TransportRouter(const transport::TransportCatalogue& catalogue, double velocity, int wait_time,
+	RouterType router_type)
 	: catalogue_(catalogue), velocity_(velocity), wait_time_(wait_time) {
-	BuildGraph();
-	InitRouter();
+	// RAPTOR     ,    
+	if (router_type != RouterType::RAPTOR) {
+		BuildGraph(router_type != RouterType::ALL_PAIRS);
+	}
+	InitRouter(router_type);
 }
 
-void TransportRouter::BuildGraph() {
+void TransportRouter::BuildGraph(bool ride_vertices) {
 	auto& all_stops = catalogue_.GetAllStops();
-	const size_t vertex_count = all_stops.size() * 2;	//   Bus  Wait
+	auto& all_buses = catalogue_.GetAllBuses();
+	size_t vertex_count = all_stops.size() * 2;	//   Bus  Wait
+	if (ride_vertices) {
+		for (const Bus& bus : all_buses) {
+			vertex_count += bus.GetStops().size();
+		}
+	}
 	graph_ = DirectedWeightedGraph<double>(vertex_count);
+	vertex_stop_ids_.reserve(vertex_count);
 	VertexId current_vertex_id = 0;
 	//   
+	stop_points_.reserve(all_stops.size());
 	for (const Stop& stop : all_stops) {
+		vertex_stop_ids_.insert(vertex_stop_ids_.end(), 2, stop_points_.size());
+		const double lat = stop.coordinates_.lat * numbers::pi / 180;
+		const double lng = stop.coordinates_.lng * numbers::pi / 180;
+		stop_points_.push_back({ geo::RADIUS_OF_EATH * cos(lat) * cos(lng), geo::RADIUS_OF_EATH * cos(lat) * sin(lng),
+			geo::RADIUS_OF_EATH * sin(lat) });
 		stop_ptr_to_vertexes_ids_[&stop] = VertexPairInfo{ .stop = current_vertex_id, .bus = current_vertex_id + 1 };
 		Edge<double> wait_edge{ .from = current_vertex_id, .to = current_vertex_id + 1, .weight = double(wait_time_) };
 		graph_.AddEdge(wait_edge);
@@ -26,49 +48,169 @@ void TransportRouter::BuildGraph() {
 		edges_info_.push_back(EdgeInfo{ .type = EdgeInfo::Type::WAIT, .host_stop = &stop, .time = double(wait_time_) });
 		current_vertex_id += 2;
 	}
-	
 
-	auto& all_buses = catalogue_.GetAllBuses();
+	road_to_geo_factor_ = numeric_limits<double>::infinity();
+	vector<VertexPairInfo> stop_vertexes;
+	vector<double> distances;
 	for (const auto& bus : all_buses) {
 		auto& stops = bus.GetStops();
+		//        -    ,     .
+		//  ,          
+		stop_vertexes.clear();
+		distances.clear();
+		double total_distance = 0;
 		for (size_t i = 0; i < stops.size(); ++i) {
-			double total_distance = 0;
-			for (size_t j = i + 1; j < stops.size(); ++j) {
-				total_distance += catalogue_.GetStopDistance(stops[j - 1], stops[j]);
-				VertexId vertex_from = stop_ptr_to_vertexes_ids_[stops[i]].bus;
-				VertexId vertex_to = stop_ptr_to_vertexes_ids_[stops[j]].stop;
-				double time = total_distance / (velocity_ * KMH_TO_MPM_FACTOR);	//       
-				Edge<double> bus_edge{ .from = vertex_from, .to = vertex_to, .weight = time };
-				graph_.AddEdge(bus_edge);
-				edges_info_.push_back(EdgeInfo{ .type = EdgeInfo::Type::BUS, .bus_ptr = &bus, .span_count = j - i, .time = time });
+			stop_vertexes.push_back(stop_ptr_to_vertexes_ids_.at(stops[i]));
+			if (i > 0) {
+				const int distance = catalogue_.GetStopDistance(stops[i - 1], stops[i]);
+				const double geo_distance = geo::ComputeDistance(stops[i - 1]->coordinates_, stops[i]->coordinates_);
+				if (geo_distance > 0) {	//    acos   NaN
+					road_to_geo_factor_ = min(road_to_geo_factor_, distance / geo_distance);
+				}
+				total_distance += distance;
 			}
+			distances.push_back(total_distance);
+		}
+		if (ride_vertices) {
+			current_vertex_id = AddRideBusEdges(bus, stop_vertexes, distances, current_vertex_id);
+		} else {
+			AddBusEdges(bus, stop_vertexes, distances);
 		}
 	}
 }
 
-void TransportRouter::InitRouter() {
-	router_ = make_unique <graph::Router<double>>(graph_);
+void TransportRouter::AddBusEdges(const Bus& bus, const vector<VertexPairInfo>& stop_vertexes,
+	const vector<double>& distances) {
+	for (size_t i = 0; i < stop_vertexes.size(); ++i) {
+		for (size_t j = i + 1; j < stop_vertexes.size(); ++j) {
+			//        ,     
+			if (stop_vertexes[j].stop == stop_vertexes[i].stop) {
+				continue;
+			}
+			double time = (distances[j] - distances[i]) / (velocity_ * KMH_TO_MPM_FACTOR);	//       
+			Edge<double> bus_edge{ .from = stop_vertexes[i].bus, .to = stop_vertexes[j].stop, .weight = time };
+			graph_.AddEdge(bus_edge);
+			edges_info_.push_back(EdgeInfo{ .type = EdgeInfo::Type::BUS, .bus_ptr = &bus, .span_count = j - i, .time = time });
+		}
+	}
+}
+
+VertexId TransportRouter::AddRideBusEdges(const Bus& bus, const vector<VertexPairInfo>& stop_vertexes,
+	const vector<double>& distances, VertexId first_ride_vertex) {
+	const EdgeInfo transfer_info{ .type = EdgeInfo::Type::BUS, .bus_ptr = &bus, .span_count = 0, .time = 0 };
+	for (size_t i = 0; i < stop_vertexes.size(); ++i) {
+		const VertexId ride_vertex = first_ride_vertex + i;
+		vertex_stop_ids_.push_back(stop_vertexes[i].stop / 2);
+		//    (    )   (   )
+		if (i + 1 < stop_vertexes.size()) {
+			graph_.AddEdge(Edge<double>{ .from = stop_vertexes[i].bus, .to = ride_vertex, .weight = 0 });
+			edges_info_.push_back(transfer_info);
+
+			double time = (distances[i + 1] - distances[i]) / (velocity_ * KMH_TO_MPM_FACTOR);
+			graph_.AddEdge(Edge<double>{ .from = ride_vertex, .to = ride_vertex + 1, .weight = time });
+			edges_info_.push_back(EdgeInfo{ .type = EdgeInfo::Type::BUS, .bus_ptr = &bus, .span_count = 1, .time = time });
+		}
+		if (i > 0) {
+			graph_.AddEdge(Edge<double>{ .from = ride_vertex, .to = stop_vertexes[i].stop, .weight = 0 });
+			edges_info_.push_back(transfer_info);
+		}
+	}
+	return first_ride_vertex + stop_vertexes.size();
+}
+
+void TransportRouter::InitRouter(RouterType router_type) {
+	switch (router_type) {
+	case RouterType::ALL_PAIRS:
+		router_ = make_unique<graph::Router<double>>(graph_);
+		break;
+	case RouterType::DIJKSTRA:
+		router_ = make_unique<graph::DijkstraRouter<double>>(graph_);
+		break;
+	case RouterType::A_STAR:
+		router_ = make_unique<graph::DijkstraRouter<double>>(graph_, [this](VertexId from, VertexId to) {
+			return GetTimeLowerBound(from, to);
+		});
+		break;
+	case RouterType::CONTRACTION_HIERARCHIES:
+		router_ = make_unique<graph::ContractionRouter<double>>(graph_);
+		break;
+	case RouterType::RAPTOR:
+		//    ,    ,     
+		raptor_ = make_unique<RaptorRouter>(catalogue_, velocity_ * KMH_TO_MPM_FACTOR, wait_time_);
+		break;
+	}
+}
+
+double TransportRouter::GetTimeLowerBound(VertexId from, VertexId to) const {
+	const size_t from_stop = vertex_stop_ids_[from];
+	const size_t to_stop = vertex_stop_ids_[to];
+	if (from_stop == to_stop) {
+		return 0;
+	}
+	//    (,     )       ;
+	//       
+	double result = from < stop_points_.size() * 2 && from % 2 == 0 ? wait_time_ : 0;
+	const auto& from_point = stop_points_[from_stop];
+	const auto& to_point = stop_points_[to_stop];
+	const double chord = hypot(from_point[0] - to_point[0], from_point[1] - to_point[1], from_point[2] - to_point[2]);
+	if (isfinite(road_to_geo_factor_) && chord > 0) {
+		//   -  ,    factor *  (   ),   
+		//          .    double
+		result += road_to_geo_factor_ * (1 - 1e-9) * chord / (velocity_ * KMH_TO_MPM_FACTOR);
+	}
+	return result;
+}
+
+FullRouteInfo TransportRouter::MakeRouteInfo(const RaptorRouter::Journey& journey) const {
+	FullRouteInfo result;
+	result.edges_info.reserve(journey.legs.size() * 2);
+	result.toteal_time = journey.total_time;
+	for (const RaptorRouter::Leg& leg : journey.legs) {
+		result.edges_info.push_back(EdgeInfo{ .type = EdgeInfo::Type::WAIT, .host_stop = leg.bus->GetStops()[leg.board],
+			.time = double(wait_time_) });
+		result.edges_info.push_back(EdgeInfo{ .type = EdgeInfo::Type::BUS, .bus_ptr = leg.bus,
+			.span_count = leg.alight - leg.board, .time = leg.time });
+	}
+	return result;
 }
 
 optional<FullRouteInfo> TransportRouter::BuildRoute(const Stop* from, const Stop* to) const {
+	// RAPTOR    ,     
+	if (raptor_) {
+		const auto journey = raptor_->BuildRoute(from, to);
+		if (!journey) {
+			return nullopt;
+		}
+		return MakeRouteInfo(*journey);
+	}
 	if (!stop_ptr_to_vertexes_ids_.contains(from) || !stop_ptr_to_vertexes_ids_.contains(to)) {
 		return nullopt;
 	}
 	VertexId vertex_from = stop_ptr_to_vertexes_ids_.at(from).stop;
 	VertexId vertex_to = stop_ptr_to_vertexes_ids_.at(to).stop;
-	auto route = router_->BuildRoute(vertex_from, vertex_to);
-	
-	if (!route) {
-		return nullopt;
-	}
-	FullRouteInfo result;
-	result.edges_info.reserve(route->edges.size());
-	result.toteal_time = route->weight;	//  
-	
-	for (const EdgeId edge_id : route->edges) {
-		result.edges_info.push_back(edges_info_[edge_id]);
-	}
-	return result;
+	return visit([&](const auto& router) -> optional<FullRouteInfo> {
+		auto route = router->BuildRoute(vertex_from, vertex_to);
+
+		if (!route) {
+			return nullopt;
+		}
+		FullRouteInfo result;
+		result.edges_info.reserve(route->edges.size());
+		result.toteal_time = route->weight;	//  
+
+		for (const EdgeId edge_id : route->edges) {
+			const EdgeInfo& edge_info = edges_info_[edge_id];
+			// ,      -  
+			if (edge_info.type == EdgeInfo::Type::BUS && !result.edges_info.empty()
+				&& result.edges_info.back().type == EdgeInfo::Type::BUS) {
+				result.edges_info.back().span_count += edge_info.span_count;
+				result.edges_info.back().time += edge_info.time;
+				continue;
+			}
+			result.edges_info.push_back(edge_info);
+		}
+		return result;
+	}, router_);
 }
 
 }	// namespace transport_router
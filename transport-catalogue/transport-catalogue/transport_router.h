@@ -1,12 +1,27 @@
 #include "transport_catalogue.h"
 #include "router.h"
+#include "dijkstra_router.h"
+#include "contraction_router.h"
+#include "raptor_router.h"
+#include <array>
 #include <memory>
+#include <variant>
 
 namespace transport_router {
 
 constexpr double KMH_TO_MPM_FACTOR = 1000.0 / 60.0;
 
+// Как искать маршрут (routing_settings.router):
+// ALL_PAIRS - все пары заранее (Флойд-Уоршелл), ответ мгновенный, но построение O(V^3) и память O(V^2);
+// DIJKSTRA и A_STAR - поиск на каждый запрос, построение линейное. A* отсекает вершины по
+// нижней оценке времени из геодезического расстояния до цели;
+// CONTRACTION_HIERARCHIES - предподсчёт иерархии (параллельный, почти линейный по памяти), запрос за доли миллисекунды;
+// RAPTOR - без графа, раунды по маршрутам автобусов (RaptorRouter), построение - только раскладка остановок
+enum class RouterType { ALL_PAIRS, DIJKSTRA, A_STAR, CONTRACTION_HIERARCHIES, RAPTOR };
+
 struct EdgeInfo {
+	// у BUS-ребра графа с вершинами поездки span_count = 1 (перегон) или 0 (посадка и высадка),
+	// в ответе подряд идущие BUS-рёбра склеиваются в одну поездку
 	enum class Type { WAIT, BUS } type;
 	const transport::Stop* host_stop = nullptr;
 	const transport::Bus* bus_ptr = nullptr;
@@ -26,23 +41,42 @@ struct FullRouteInfo {
 
 class TransportRouter {
 public:
-	TransportRouter(const transport::TransportCatalogue& catalogue, double velocity, int wait_time);	
+	TransportRouter(const transport::TransportCatalogue& catalogue, double velocity, int wait_time,
+		RouterType router_type = RouterType::ALL_PAIRS);
 
 	std::optional<FullRouteInfo> BuildRoute(const transport::Stop* from, const transport::Stop* to) const;
 
 private:
-	void BuildGraph();
-	void InitRouter();
+	// Для ALL_PAIRS вершин две на остановку, а рёбра автобуса - от каждой остановки до каждой следующей:
+	// Флойду-Уоршеллу важно число вершин, а не рёбер. Остальным роутерам - вершина на каждую остановку
+	// каждого автобуса (поездка), перегон между ними, посадка и высадка: O(L) рёбер на маршрут вместо O(L^2)
+	void BuildGraph(bool ride_vertices);
+	void AddBusEdges(const transport::Bus& bus, const std::vector<VertexPairInfo>& stop_vertexes,
+		const std::vector<double>& distances);
+	graph::VertexId AddRideBusEdges(const transport::Bus& bus, const std::vector<VertexPairInfo>& stop_vertexes,
+		const std::vector<double>& distances, graph::VertexId first_ride_vertex);
+	void InitRouter(RouterType router_type);
+	FullRouteInfo MakeRouteInfo(const RaptorRouter::Journey& journey) const;
+	// нижняя оценка времени в пути от вершины до вершины для A*
+	double GetTimeLowerBound(graph::VertexId from, graph::VertexId to) const;
 
 	const transport::TransportCatalogue& catalogue_;	
 
 	double velocity_;
 	int wait_time_;
+	// дорожное расстояние не короче геодезического, умноженного на этот коэффициент (минимум по перегонам)
+	double road_to_geo_factor_ = 0;
+	// остановки точками на сфере радиуса Земли, по номеру остановки (её вершины 2i и 2i + 1):
+	// хорда между ними не длиннее геодезического расстояния и считается без тригонометрии
+	std::vector<std::array<double, 3>> stop_points_;
+	std::vector<size_t> vertex_stop_ids_;	// номер остановки каждой вершины, включая вершины поездки
 
 	graph::DirectedWeightedGraph<double> graph_;
 	std::vector<EdgeInfo> edges_info_;
 	std::unordered_map<const transport::Stop*, VertexPairInfo> stop_ptr_to_vertexes_ids_;
-	std::unique_ptr<graph::Router<double>> router_;
+	std::variant<std::unique_ptr<graph::Router<double>>, std::unique_ptr<graph::DijkstraRouter<double>>,
+		std::unique_ptr<graph::ContractionRouter<double>>> router_;
+	std::unique_ptr<RaptorRouter> raptor_;	// вместо router_ и графа при RouterType::RAPTOR
 };
 
 }	// namespace transport_router
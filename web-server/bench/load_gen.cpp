@@ -0,0 +1,359 @@
+/*
+ * Нагрузочный генератор: N ботов-игроков против уже запущенного game_server (например, с data/config.json).
+ * Каждый бот держит своё keep-alive соединение: входит в игру через /api/v1/game/join,
+ * потом шлёт случайные /game/player/action и опрашивает /game/state с заданной частотой.
+ * Задержка считается от момента, когда запрос должен был уйти по расписанию, а не когда реально ушёл:
+ * если сервер тормозит, очередь на стороне бота тоже попадает в квантили (иначе p99 выглядит лучше, чем есть).
+ *
+ * load_gen [--host 127.0.0.1] [--port 8080] [--players 100] [--seconds 10]
+ *          [--state-rate 10] [--action-rate 2] [--map id] [--threads 1] [--seed 1]
+ */
+#include "../src/metrics.h"
+
+#include <boost/asio.hpp>
+#include <boost/beast.hpp>
+#include <boost/json.hpp>
+#include <boost/program_options.hpp>
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <optional>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+namespace net = boost::asio;
+namespace beast = boost::beast;
+namespace http = beast::http;
+namespace json = boost::json;
+using tcp = net::ip::tcp;
+using Clock = std::chrono::steady_clock;
+using namespace std::literals;
+
+constexpr std::string_view API_V1_MAPS_S = "/api/v1/maps";
+constexpr std::string_view API_V1_GAME_JOIN_S = "/api/v1/game/join";
+constexpr std::string_view API_V1_GAME_STATE_S = "/api/v1/game/state";
+constexpr std::string_view API_V1_GAME_PLAYER_ACTION_S = "/api/v1/game/player/action";
+constexpr std::array<std::string_view, 5> MOVES = { "L", "R", "U", "D", "" };
+
+struct Options {
+    std::string host = "127.0.0.1";
+    unsigned short port = 8080;
+    int players = 100;
+    int seconds = 10;
+    double state_rate = 10;   // запросов состояния в секунду на бота
+    double action_rate = 2;   // смен направления в секунду на бота
+    std::string map_id;       // пусто - случайная карта из /api/v1/maps
+    unsigned threads = 1;
+    uint32_t seed = 1;
+};
+
+enum Endpoint : size_t { JOIN, ACTION, STATE, ENDPOINT_COUNT };
+constexpr std::array<std::string_view, ENDPOINT_COUNT> ENDPOINT_NAMES = { "join", "action", "state" };
+
+struct EndpointStats {
+    metrics::Histogram latency_us;
+    std::atomic<uint64_t> requests{ 0 };
+    std::atomic<uint64_t> errors{ 0 };
+};
+
+using Stats = std::array<EndpointStats, ENDPOINT_COUNT>;
+
+std::optional<Options> ParseOptions(int argc, char** argv) {
+    namespace po = boost::program_options;
+    Options options;
+    po::options_description desc{ "Allowed options"s };
+    desc.add_options()
+        ("help,h", "produce help message")
+        ("host", po::value(&options.host)->value_name("address"), "game_server address")
+        ("port", po::value(&options.port)->value_name("port"), "game_server port")
+        ("players", po::value(&options.players)->value_name("count"), "simulated players, one keep-alive connection each")
+        ("seconds", po::value(&options.seconds)->value_name("seconds"), "test duration")
+        ("state-rate", po::value(&options.state_rate)->value_name("rps"), "/game/state polls per second per player")
+        ("action-rate", po::value(&options.action_rate)->value_name("rps"), "/game/player/action requests per second per player")
+        ("map", po::value(&options.map_id)->value_name("id"), "join this map, by default a random one from /api/v1/maps")
+        ("threads", po::value(&options.threads)->value_name("count"), "client threads")
+        ("seed", po::value(&options.seed)->value_name("seed"), "random seed");
+
+    po::variables_map vm;
+    po::store(po::parse_command_line(argc, argv, desc), vm);
+    po::notify(vm);
+    if (vm.contains("help")) {
+        std::cout << desc;
+        return std::nullopt;
+    }
+    options.threads = std::max(1u, options.threads);
+    return options;
+}
+
+// карты берём у самого сервера, чтобы не зависеть от содержимого конфига
+std::vector<std::string> FetchMapIds(net::io_context& ioc, const tcp::endpoint& endpoint) {
+    beast::tcp_stream stream(ioc);
+    stream.connect(endpoint);
+    http::request<http::empty_body> request{ http::verb::get, API_V1_MAPS_S, 11 };
+    request.set(http::field::host, endpoint.address().to_string());
+    http::write(stream, request);
+
+    beast::flat_buffer buffer;
+    http::response<http::string_body> response;
+    http::read(stream, buffer, response);
+    if (response.result() != http::status::ok) {
+        throw std::runtime_error("GET /api/v1/maps failed: "s + std::to_string(response.result_int()));
+    }
+
+    std::vector<std::string> ids;
+    const json::value maps = json::parse(response.body());
+    for (const json::value& map : maps.as_array()) {
+        ids.emplace_back(map.as_object().at("id").as_string());
+    }
+    if (ids.empty()) {
+        throw std::runtime_error("server has no maps");
+    }
+    return ids;
+}
+
+class Bot : public std::enable_shared_from_this<Bot> {
+public:
+    Bot(net::io_context& ioc, const tcp::endpoint& endpoint, const Options& options, Stats& stats,
+        std::string name, std::string map_id, uint32_t seed, Clock::time_point deadline)
+        : strand_(net::make_strand(ioc))
+        , stream_(strand_)
+        , timer_(strand_)
+        , endpoint_(endpoint)
+        , stats_(stats)
+        , name_(std::move(name))
+        , map_id_(std::move(map_id))
+        , rng_(seed)
+        , deadline_(deadline)
+        , action_share_(options.action_rate / std::max(options.action_rate + options.state_rate, 1e-9)) {
+        const double rate = options.action_rate + options.state_rate;
+        if (rate > 0) {
+            interval_ = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / rate));
+        }
+    }
+
+    void Start() {
+        net::dispatch(strand_, [self = shared_from_this()] {
+            self->stream_.async_connect(self->endpoint_, [self](beast::error_code ec) {
+                if (ec) {
+                    self->Fail(JOIN);
+                    return;
+                }
+                self->Join();
+                });
+            });
+    }
+
+private:
+    void Join() {
+        json::object body;
+        body["userName"] = name_;
+        body["mapId"] = map_id_;
+        PrepareRequest(http::verb::post, API_V1_GAME_JOIN_S, json::serialize(body));
+
+        Exchange(JOIN, Clock::now(), [self = shared_from_this()](bool ok) {
+            if (!ok) {
+                return;  // без токена боту делать нечего
+            }
+            self->token_ = json::parse(self->response_.body()).as_object().at("authToken").as_string().c_str();
+            // первые запросы ботов разбросаны по интервалу, чтобы они не шли залпом
+            std::uniform_int_distribution<Clock::rep> offset(0, std::max<Clock::rep>(self->interval_.count(), 0));
+            self->next_ = Clock::now() + Clock::duration(offset(self->rng_));
+            self->Wait();
+            });
+    }
+
+    void Wait() {
+        if (interval_ == Clock::duration::zero() || next_ >= deadline_) {
+            return;
+        }
+        timer_.expires_at(next_);
+        timer_.async_wait([self = shared_from_this()](beast::error_code ec) {
+            if (!ec) {
+                self->SendNext();
+            }
+            });
+    }
+
+    void SendNext() {
+        const Clock::time_point scheduled = next_;
+        next_ += interval_;
+
+        Endpoint endpoint = STATE;
+        if (std::uniform_real_distribution<double>(0, 1)(rng_) < action_share_) {
+            endpoint = ACTION;
+            json::object body;
+            body["move"] = MOVES[std::uniform_int_distribution<size_t>(0, MOVES.size() - 1)(rng_)];
+            PrepareRequest(http::verb::post, API_V1_GAME_PLAYER_ACTION_S, json::serialize(body));
+        }
+        else {
+            PrepareRequest(http::verb::get, API_V1_GAME_STATE_S, {});
+        }
+        Exchange(endpoint, scheduled, [self = shared_from_this()](bool) {
+            self->Wait();
+            });
+    }
+
+    void PrepareRequest(http::verb method, std::string_view target, std::string body) {
+        request_ = {};
+        request_.method(method);
+        request_.target(target);
+        request_.version(11);
+        request_.keep_alive(true);
+        request_.set(http::field::host, endpoint_.address().to_string());
+        if (!token_.empty()) {
+            request_.set(http::field::authorization, "Bearer " + token_);
+        }
+        if (method == http::verb::post) {
+            request_.set(http::field::content_type, "application/json");
+        }
+        request_.body() = std::move(body);
+        request_.prepare_payload();
+    }
+
+    void Exchange(Endpoint endpoint, Clock::time_point scheduled, std::function<void(bool)> then) {
+        http::async_write(stream_, request_,
+            [self = shared_from_this(), endpoint, scheduled, then = std::move(then)](beast::error_code ec, size_t) mutable {
+                if (ec) {
+                    self->Reconnect(endpoint, std::move(then));
+                    return;
+                }
+                self->response_ = {};
+                http::async_read(self->stream_, self->buffer_, self->response_,
+                    [self, endpoint, scheduled, then = std::move(then)](beast::error_code ec, size_t) mutable {
+                        if (ec) {
+                            self->Reconnect(endpoint, std::move(then));
+                            return;
+                        }
+                        EndpointStats& stats = self->stats_[endpoint];
+                        stats.latency_us.Record(static_cast<uint64_t>(
+                            std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - scheduled).count()));
+                        stats.requests.fetch_add(1, std::memory_order_relaxed);
+                        const bool ok = self->response_.result() == http::status::ok;
+                        if (!ok) {
+                            stats.errors.fetch_add(1, std::memory_order_relaxed);
+                        }
+                        if (!self->response_.keep_alive()) {
+                            self->Reconnect(std::nullopt, [then = std::move(then), ok](bool) { then(ok); });
+                            return;
+                        }
+                        then(ok);
+                    });
+            });
+    }
+
+    // сетевая ошибка считается неудачным запросом; бот переподключается и живёт дальше
+    void Reconnect(std::optional<Endpoint> failed, std::function<void(bool)> then) {
+        if (failed) {
+            Fail(*failed);
+        }
+        beast::error_code ignored;
+        stream_.socket().close(ignored);
+        buffer_.clear();
+        stream_.async_connect(endpoint_, [then = std::move(then)](beast::error_code) {
+            then(false);
+            });
+    }
+
+    void Fail(Endpoint endpoint) {
+        stats_[endpoint].requests.fetch_add(1, std::memory_order_relaxed);
+        stats_[endpoint].errors.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    net::strand<net::io_context::executor_type> strand_;
+    beast::tcp_stream stream_;
+    net::steady_timer timer_;
+    tcp::endpoint endpoint_;
+    Stats& stats_;
+    std::string name_;
+    std::string map_id_;
+    std::string token_;
+    std::mt19937 rng_;
+    Clock::time_point deadline_;
+    Clock::time_point next_;
+    Clock::duration interval_ = Clock::duration::zero();
+    double action_share_;
+    beast::flat_buffer buffer_;
+    http::request<http::string_body> request_;
+    http::response<http::string_body> response_;
+};
+
+void PrintReport(const Stats& stats, std::chrono::duration<double> elapsed) {
+    auto ms = [](uint64_t us) {
+        return static_cast<double>(us) / 1000.0;
+    };
+    std::cout << std::fixed << std::setprecision(2)
+        << std::left << std::setw(8) << "endpoint"
+        << std::right << std::setw(10) << "requests" << std::setw(10) << "req/s" << std::setw(9) << "errors"
+        << std::setw(11) << "p50 ms" << std::setw(11) << "p99 ms" << std::setw(11) << "p999 ms" << std::endl;
+
+    uint64_t total = 0;
+    for (size_t i = 0; i < ENDPOINT_COUNT; ++i) {
+        const auto snapshot = stats[i].latency_us.TakeSnapshot();
+        const uint64_t requests = stats[i].requests.load();
+        const uint64_t errors = stats[i].errors.load();
+        total += requests;
+        std::cout << std::left << std::setw(8) << ENDPOINT_NAMES[i]
+            << std::right << std::setw(10) << requests
+            << std::setw(10) << static_cast<double>(requests) / elapsed.count()
+            << std::setw(8) << (requests ? 100.0 * static_cast<double>(errors) / static_cast<double>(requests) : 0.0) << "%"
+            << std::setw(11) << ms(snapshot.ValueAtQuantile(0.5))
+            << std::setw(11) << ms(snapshot.ValueAtQuantile(0.99))
+            << std::setw(11) << ms(snapshot.ValueAtQuantile(0.999)) << std::endl;
+    }
+    std::cout << "total: " << total << " requests, " << static_cast<double>(total) / elapsed.count() << " req/s" << std::endl;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    try {
+        const auto options = ParseOptions(argc, argv);
+        if (!options) {
+            return EXIT_SUCCESS;
+        }
+
+        net::io_context ioc(static_cast<int>(options->threads));
+        const tcp::endpoint endpoint = *tcp::resolver(ioc).resolve(options->host, std::to_string(options->port)).begin();
+        const std::vector<std::string> map_ids = options->map_id.empty()
+            ? FetchMapIds(ioc, endpoint)
+            : std::vector<std::string>{ options->map_id };
+
+        std::cout << "players: " << options->players
+            << ", duration: " << options->seconds << "s"
+            << ", state: " << options->state_rate << "/s"
+            << ", action: " << options->action_rate << "/s per player" << std::endl;
+
+        Stats stats;
+        std::mt19937 rng(options->seed);
+        const auto start = Clock::now();
+        const auto deadline = start + std::chrono::seconds(options->seconds);
+        for (int i = 0; i < options->players; ++i) {
+            const std::string& map_id = map_ids[std::uniform_int_distribution<size_t>(0, map_ids.size() - 1)(rng)];
+            std::make_shared<Bot>(ioc, endpoint, *options, stats, "bot" + std::to_string(i), map_id, rng(), deadline)->Start();
+        }
+
+        std::vector<std::thread> workers;
+        for (unsigned i = 1; i < options->threads; ++i) {
+            workers.emplace_back([&ioc] { ioc.run(); });
+        }
+        ioc.run();
+        for (auto& worker : workers) {
+            worker.join();
+        }
+
+        PrintReport(stats, Clock::now() - start);
+    }
+    catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+}
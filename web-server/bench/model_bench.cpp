@@ -0,0 +1,353 @@
+/*
+ * Микробенчмарки горячих мест модели на картах из конфига (по умолчанию data/config.json).
+ * Каждый бенчмарк регистрируется на каждую карту и прогоняется по сетке "собак x предметов",
+ * так что регрессию в MyLib видно по конкретной карте и размеру сессии.
+ *
+ * model_bench [config.json] [--benchmark_filter=...] [--benchmark_format=json] ...
+ */
+#include "../src/collision_detector.h"
+#include "../src/compression.h"
+#include "../src/infrastructure.h"
+#include "../src/json_loader.h"
+#include "../src/map_bundle.h"
+#include "../src/player.h"
+#include "../src/request_handler.h"
+
+#include <benchmark/benchmark.h>
+#include <boost/archive/text_iarchive.hpp>
+#include <boost/archive/text_oarchive.hpp>
+
+#include <algorithm>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+using namespace std::literals;
+
+// тики как у сервера по умолчанию
+constexpr int TICK_MS = 50;
+// столько тиков собаки бегут сами, потом им раздаются новые направления и возвращается лут
+constexpr int64_t TICKS_PER_SHUFFLE = 64;
+
+const std::vector<int64_t> DOG_COUNTS = { 16, 128, 1024 };
+const std::vector<int64_t> LOOT_COUNTS = { 16, 128, 1024 };
+const std::vector<int64_t> COMPRESSION_LEVELS = { 1, 6, 9 };
+
+class NullRepository final : public postgres::RetiredPlayersRepository {
+public:
+    void EnsureSchema() override {
+    }
+
+    void Add(const postgres::RetiredRecord&) override {
+    }
+
+    std::vector<postgres::RetiredRecord> Get(int, int) override {
+        return {};
+    }
+};
+
+std::filesystem::path g_config_path = GAME_CONFIG_PATH;
+
+/*
+ * Игра из конфига с одной сессией на выбранной карте.
+ * Лут генератором не добавляется, на покой собаки не уходят - размер сессии задаёт только бенчмарк.
+ */
+class World {
+public:
+    World(const std::string& map_id, size_t dogs, size_t loot)
+        : data_(json_loader::LoadGame(g_config_path))
+        , map_id_(map_id)
+        , generator_(loot_gen::LootGenerator::TimeInterval{ 1000 }, 0.0)
+        , manager_(std::make_unique<app::GameSessionManager>(data_.game, data_.loot_type_by_map_id, generator_,
+            /*is_random_dog_position=*/true, /*retirement_time_s=*/1e9, repository_)) {
+        for (size_t i = 0; i < dogs; ++i) {
+            tokens_.push_back(manager_->AddDogToMap("dog"s + std::to_string(i), map_id_).first);
+        }
+        session_ = manager_->GetSessionByMapId(map_id_);
+        loot_target_ = loot;
+        Shuffle();
+    }
+
+    // менеджер держит ссылки на игру, генератор и репозиторий
+    World(const World&) = delete;
+    World& operator=(const World&) = delete;
+
+    // новые направления собакам и лут обратно до нужного числа
+    void Shuffle() {
+        static constexpr std::string_view MOVES[] = { "L", "R", "U", "D" };
+        std::uniform_int_distribution<size_t> move(0, std::size(MOVES) - 1);
+        for (const app::Token& token : tokens_) {
+            manager_->SetMoveDog(manager_->FindPlayerByToken(token), MOVES[move(rng_)]);
+        }
+        const int loot_types = static_cast<int>(data_.loot_type_by_map_id.at(map_id_).size());
+        std::uniform_int_distribution<int> type(0, std::max(loot_types - 1, 0));
+        while (session_->GetLostObjects().size() < loot_target_) {
+            session_->AddLostObject(model::LostObject{ .type = type(rng_), .pos = session_->GenerateRandomPosition() });
+        }
+    }
+
+    app::GameSessionManager& GetManager() {
+        return *manager_;
+    }
+
+    app::GameSession& GetSession() {
+        return *session_;
+    }
+
+    const std::vector<app::Token>& GetTokens() const {
+        return tokens_;
+    }
+
+    // пустой менеджер над той же игрой, чтобы было куда восстанавливать состояние
+    std::unique_ptr<app::GameSessionManager> MakeEmptyManager() {
+        return std::make_unique<app::GameSessionManager>(data_.game, data_.loot_type_by_map_id, generator_,
+            true, 1e9, repository_);
+    }
+
+private:
+    json_loader::LoadedData data_;
+    model::Map::Id map_id_;
+    NullRepository repository_;
+    loot_gen::LootGenerator generator_;
+    std::unique_ptr<app::GameSessionManager> manager_;
+    app::GameSession* session_ = nullptr;
+    std::vector<app::Token> tokens_;
+    size_t loot_target_ = 0;
+    std::mt19937 rng_{ 42 };
+};
+
+World MakeWorld(const benchmark::State& state, const std::string& map_id) {
+    return World(map_id, static_cast<size_t>(state.range(0)), static_cast<size_t>(state.range(1)));
+}
+
+// раз в TICKS_PER_SHUFFLE итераций возвращает сессию к исходному размеру, вне замера
+void ShuffleIfNeeded(benchmark::State& state, World& world, int64_t& iteration) {
+    if (++iteration % TICKS_PER_SHUFFLE == 0) {
+        state.PauseTiming();
+        world.Shuffle();
+        state.ResumeTiming();
+    }
+}
+
+void BM_FindGatherEvents(benchmark::State& state, const std::string& map_id) {
+    World world = MakeWorld(state, map_id);
+    const auto moves = world.GetSession().ProcessTickMove(TICK_MS);
+    app::ItemGatherer gatherer;
+    for (const auto& [from, to] : moves) {
+        gatherer.AddGatherer(collision_detector::Gatherer{ from, to, 0.3 });
+    }
+    for (const model::LostObject& item : world.GetSession().GetLostObjects()) {
+        gatherer.AddItem(collision_detector::Item{ item.pos, 0.0 });
+    }
+
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(collision_detector::FindGatherEvents(gatherer));
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+// то же самое через SoA-пачки, как считает сервер
+void BM_FindGatherEventsBatch(benchmark::State& state, const std::string& map_id) {
+    World world = MakeWorld(state, map_id);
+    const auto moves = world.GetSession().ProcessTickMove(TICK_MS);
+    collision_detector::GathererBatch gatherers;
+    for (const auto& [from, to] : moves) {
+        gatherers.Add(collision_detector::Gatherer{ from, to, 0.3 });
+    }
+    collision_detector::ItemBatch items;
+    for (const model::LostObject& item : world.GetSession().GetLostObjects()) {
+        items.Add(collision_detector::Item{ item.pos, 0.0 });
+    }
+
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(collision_detector::FindGatherEvents(gatherers, items));
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+void BM_ProcessTickMove(benchmark::State& state, const std::string& map_id) {
+    World world = MakeWorld(state, map_id);
+    int64_t iteration = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(world.GetSession().ProcessTickMove(TICK_MS));
+        ShuffleIfNeeded(state, world, iteration);
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+void BM_ProcessTick(benchmark::State& state, const std::string& map_id) {
+    World world = MakeWorld(state, map_id);
+    int64_t iteration = 0;
+    for (auto _ : state) {
+        world.GetManager().ProcessTick(TICK_MS);
+        ShuffleIfNeeded(state, world, iteration);
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+void BM_GetStateSerialized(benchmark::State& state, const std::string& map_id) {
+    World world = MakeWorld(state, map_id);
+    app::Player* player = world.GetManager().FindPlayerByToken(world.GetTokens().front());
+    size_t bytes = 0;
+    for (auto _ : state) {
+        const std::string body = boost::json::serialize(http_handler::GetStateInSameSession(player));
+        bytes += body.size();
+        benchmark::DoNotOptimize(body.data());
+    }
+    state.SetBytesProcessed(static_cast<int64_t>(bytes));
+}
+
+// цена сжатия /game/state: CPU на уровень zlib против того, во сколько раз меньше уходит в сеть.
+// Собак и лута поровну, range(0)
+void BM_CompressState(benchmark::State& state, const std::string& map_id) {
+    const auto objects = static_cast<size_t>(state.range(0));
+    World world(map_id, objects, objects);
+    app::Player* player = world.GetManager().FindPlayerByToken(world.GetTokens().front());
+    const std::string body = boost::json::serialize(http_handler::GetStateInSameSession(player));
+    const int level = static_cast<int>(state.range(1));
+
+    size_t compressed = 0;
+    for (auto _ : state) {
+        const std::string encoded = http_server::Compress(body, http_server::ContentCoding::GZIP, level);
+        compressed = encoded.size();
+        benchmark::DoNotOptimize(encoded.data());
+    }
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * body.size()));
+    state.counters["body_bytes"] = static_cast<double>(body.size());
+    state.counters["gzip_bytes"] = static_cast<double>(compressed);
+    state.counters["ratio"] = static_cast<double>(body.size()) / static_cast<double>(std::max<size_t>(compressed, 1));
+}
+
+void BM_AddPlayerToken(benchmark::State& state) {
+    std::vector<app::Player> players(static_cast<size_t>(state.max_iterations), app::Player(nullptr, nullptr, {}));
+    app::PlayerTokens tokens;
+    size_t next = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(tokens.AddPlayer(players[next++ % players.size()]));
+    }
+}
+
+void BM_FindPlayerByToken(benchmark::State& state) {
+    std::vector<app::Player> players(static_cast<size_t>(state.range(0)), app::Player(nullptr, nullptr, {}));
+    app::PlayerTokens tokens;
+    std::vector<app::Token> issued;
+    for (app::Player& player : players) {
+        issued.push_back(tokens.AddPlayer(player));
+    }
+    size_t next = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(tokens.FindPlayerByToken(issued[next++ % issued.size()]));
+    }
+}
+
+void BM_ToSerState(benchmark::State& state, const std::string& map_id) {
+    World world = MakeWorld(state, map_id);
+    size_t bytes = 0;
+    for (auto _ : state) {
+        std::ostringstream out;
+        boost::archive::text_oarchive archive{ out };
+        const infrastructure::SerState ser_state = infrastructure::ToSerState(world.GetManager());
+        archive << ser_state;
+        bytes += out.view().size();
+    }
+    state.SetBytesProcessed(static_cast<int64_t>(bytes));
+}
+
+void BM_FromSerState(benchmark::State& state, const std::string& map_id) {
+    World world = MakeWorld(state, map_id);
+    std::ostringstream out;
+    {
+        boost::archive::text_oarchive archive{ out };
+        const infrastructure::SerState ser_state = infrastructure::ToSerState(world.GetManager());
+        archive << ser_state;
+    }
+    const std::string image = out.str();
+
+    for (auto _ : state) {
+        state.PauseTiming();
+        auto manager = world.MakeEmptyManager();
+        state.ResumeTiming();
+
+        std::istringstream in(image);
+        boost::archive::text_iarchive archive{ in };
+        infrastructure::SerState ser_state;
+        archive >> ser_state;
+        infrastructure::FromSerState(*manager, ser_state);
+    }
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * image.size()));
+}
+
+// старт сервера: разбор config.json против чтения бандла карт
+void BM_LoadGameJson(benchmark::State& state) {
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(json_loader::LoadGame(g_config_path));
+    }
+}
+
+void BM_LoadBundle(benchmark::State& state) {
+    const auto path = std::filesystem::temp_directory_path() / "model_bench.bundle";
+    map_bundle::WriteBundle(json_loader::LoadGame(g_config_path), path);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(map_bundle::LoadBundle(path));
+    }
+    std::filesystem::remove(path);
+}
+
+template <typename Fn>
+void RegisterForMaps(std::string_view name, Fn fn, const std::vector<std::string>& map_ids) {
+    for (const std::string& map_id : map_ids) {
+        benchmark::RegisterBenchmark((std::string(name) + "/" + map_id).c_str(), fn, map_id)
+            ->ArgNames({ "dogs", "loot" })
+            ->ArgsProduct({ DOG_COUNTS, LOOT_COUNTS })
+            ->Unit(benchmark::kMicrosecond);
+    }
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    benchmark::Initialize(&argc, argv);
+    // после Initialize в argv остаются только свои аргументы
+    if (argc > 1) {
+        g_config_path = argv[1];
+    }
+
+    std::vector<std::string> map_ids;
+    try {
+        const json_loader::LoadedData data = json_loader::LoadGame(g_config_path);
+        for (const model::Map& map : data.game.GetMaps()) {
+            map_ids.push_back(*map.GetId());
+        }
+    }
+    catch (const std::exception& e) {
+        std::cerr << "Failed to load " << g_config_path << ": " << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    RegisterForMaps("FindGatherEvents", BM_FindGatherEvents, map_ids);
+    RegisterForMaps("FindGatherEvents/batch", BM_FindGatherEventsBatch, map_ids);
+    RegisterForMaps("GameSession::ProcessTickMove", BM_ProcessTickMove, map_ids);
+    RegisterForMaps("GameSessionManager::ProcessTick", BM_ProcessTick, map_ids);
+    RegisterForMaps("GetStateInSameSession", BM_GetStateSerialized, map_ids);
+    RegisterForMaps("ToSerState", BM_ToSerState, map_ids);
+    RegisterForMaps("FromSerState", BM_FromSerState, map_ids);
+    for (const std::string& map_id : map_ids) {
+        benchmark::RegisterBenchmark(("CompressState/" + map_id).c_str(), BM_CompressState, map_id)
+            ->ArgNames({ "objects", "level" })
+            ->ArgsProduct({ DOG_COUNTS, COMPRESSION_LEVELS })
+            ->Unit(benchmark::kMicrosecond);
+    }
+    benchmark::RegisterBenchmark("LoadGame/json", BM_LoadGameJson)->Unit(benchmark::kMicrosecond);
+    benchmark::RegisterBenchmark("LoadGame/bundle", BM_LoadBundle)->Unit(benchmark::kMicrosecond);
+    benchmark::RegisterBenchmark("PlayerTokens::AddPlayer", BM_AddPlayerToken)->Iterations(100'000);
+    benchmark::RegisterBenchmark("PlayerTokens::FindPlayerByToken", BM_FindPlayerByToken)
+        ->ArgName("players")->Range(16, 1 << 16);
+
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+}
@@ -0,0 +1,188 @@
+/*
+ * Сравнение двух моделей сети на loopback:
+ *  shared   - один io_context, который крутят N потоков (как сервер работает по умолчанию);
+ *  reactors - N однопоточных io_context со своими SO_REUSEPORT acceptor'ами (--reactors N).
+ * Обработчик, как и настоящий API, уходит в strand игры и отвечает оттуда.
+ *
+ * reactor_bench [connections=64] [seconds=5] [threads=hardware_concurrency] [port=18080] [--pin]
+ */
+#include "../src/http_server.h"
+#include "../src/io_context_pool.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+namespace net = boost::asio;
+namespace beast = boost::beast;
+namespace http = beast::http;
+using tcp = net::ip::tcp;
+using namespace std::chrono_literals;
+
+struct Options {
+    int connections = 64;
+    std::chrono::seconds duration{ 5 };
+    unsigned threads = std::max(1u, std::thread::hardware_concurrency());
+    unsigned short port = 18080;
+    bool pin = false;
+};
+
+template <typename Executor>
+auto MakeHandler(Executor game_strand) {
+    return [game_strand](auto&& req, auto&& send, auto&&) {
+        net::post(game_strand, [version = req.version(), keep_alive = req.keep_alive(), send]() {
+            http::response<http::string_body> response{ http::status::ok, version };
+            response.set(http::field::content_type, "text/plain");
+            response.body() = "ok";
+            response.keep_alive(keep_alive);
+            response.prepare_payload();
+            send(std::move(response));
+            });
+        };
+}
+
+// одно keep-alive соединение, шлёт запросы подряд до дедлайна
+class Client : public std::enable_shared_from_this<Client> {
+public:
+    Client(net::io_context& ioc, std::atomic<uint64_t>& done, std::chrono::steady_clock::time_point deadline)
+        : stream_(ioc), done_(done), deadline_(deadline) {
+        request_.method(http::verb::get);
+        request_.target("/bench");
+        request_.set(http::field::host, "127.0.0.1");
+        request_.keep_alive(true);
+    }
+
+    void Start(const tcp::endpoint& endpoint) {
+        stream_.async_connect(endpoint, [self = shared_from_this()](beast::error_code ec) {
+            if (!ec) {
+                self->Send();
+            }
+            });
+    }
+
+private:
+    void Send() {
+        if (std::chrono::steady_clock::now() >= deadline_) {
+            return;
+        }
+        http::async_write(stream_, request_, [self = shared_from_this()](beast::error_code ec, size_t) {
+            if (ec) {
+                return;
+            }
+            self->response_ = {};
+            http::async_read(self->stream_, self->buffer_, self->response_,
+                [self](beast::error_code ec, size_t) {
+                    if (ec) {
+                        return;
+                    }
+                    self->done_.fetch_add(1, std::memory_order_relaxed);
+                    self->Send();
+                });
+            });
+    }
+
+    beast::tcp_stream stream_;
+    beast::flat_buffer buffer_;
+    http::request<http::empty_body> request_;
+    http::response<http::string_body> response_;
+    std::atomic<uint64_t>& done_;
+    std::chrono::steady_clock::time_point deadline_;
+};
+
+double RunClients(const tcp::endpoint& endpoint, const Options& options) {
+    net::io_context ioc(1);
+    std::atomic<uint64_t> done{ 0 };
+    const auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < options.connections; ++i) {
+        std::make_shared<Client>(ioc, done, start + options.duration)->Start(endpoint);
+    }
+    ioc.run();
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    return static_cast<double>(done.load()) / elapsed.count();
+}
+
+double RunShared(const Options& options) {
+    const tcp::endpoint endpoint(net::ip::make_address("127.0.0.1"), options.port);
+    net::io_context ioc(static_cast<int>(options.threads));
+    http_server::ServeHttp(ioc, endpoint, MakeHandler(net::make_strand(ioc)));
+
+    std::vector<std::thread> workers;
+    for (unsigned i = 0; i < options.threads; ++i) {
+        workers.emplace_back([&ioc] { ioc.run(); });
+    }
+    const double rps = RunClients(endpoint, options);
+    ioc.stop();
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    return rps;
+}
+
+double RunReactors(const Options& options) {
+    const tcp::endpoint endpoint(net::ip::make_address("127.0.0.1"), options.port + 1);
+    net::io_context game_ioc(1);
+    auto game_guard = net::make_work_guard(game_ioc);
+    auto game_strand = net::make_strand(game_ioc);
+
+    http_server::IoContextPool reactors(options.threads);
+    for (size_t i = 0; i < reactors.Size(); ++i) {
+        http_server::ServeHttp(reactors.Get(i), endpoint, MakeHandler(game_strand), {}, /*reuse_port=*/true);
+    }
+    reactors.Start(options.pin, /*first_cpu=*/1);
+    std::thread game_thread([&game_ioc] { game_ioc.run(); });
+
+    const double rps = RunClients(endpoint, options);
+    reactors.Stop();
+    reactors.Join();
+    game_guard.reset();
+    game_ioc.stop();
+    game_thread.join();
+    return rps;
+}
+
+Options ParseOptions(int argc, char** argv) {
+    Options options;
+    std::vector<std::string> positional;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--pin") {
+            options.pin = true;
+        }
+        else {
+            positional.push_back(std::move(arg));
+        }
+    }
+    if (positional.size() > 0) options.connections = std::stoi(positional[0]);
+    if (positional.size() > 1) options.duration = std::chrono::seconds(std::stoi(positional[1]));
+    if (positional.size() > 2) options.threads = std::max(1, std::stoi(positional[2]));
+    if (positional.size() > 3) options.port = static_cast<unsigned short>(std::stoi(positional[3]));
+    return options;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    try {
+        const Options options = ParseOptions(argc, argv);
+        std::cout << "connections: " << options.connections
+            << ", threads: " << options.threads
+            << ", duration: " << options.duration.count() << "s"
+            << (options.pin ? ", pinned" : "") << std::endl;
+
+        const double shared = RunShared(options);
+        std::cout << "shared io_context:   " << static_cast<uint64_t>(shared) << " req/s" << std::endl;
+
+        const double reactors = RunReactors(options);
+        std::cout << "per-core reactors:   " << static_cast<uint64_t>(reactors) << " req/s" << std::endl;
+    }
+    catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+}
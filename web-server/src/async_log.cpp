@@ -0,0 +1,173 @@
+#include "async_log.h"
+
+#include <boost/date_time/posix_time/posix_time.hpp>
+
+#include <charconv>
+#include <stdexcept>
+#include <random>
+
+namespace async_log {
+
+// ------------------------- AsyncLogSink -----------------------------
+
+AsyncLogSink::AsyncLogSink(std::ostream& out, size_t capacity)
+    : out_(out), queue_(capacity), worker_([this] { Run(); }) {
+}
+
+AsyncLogSink::~AsyncLogSink() {
+    Stop();
+}
+
+bool AsyncLogSink::TryWrite(std::string line) {
+    if (!queue_.TryPush(line)) {
+        dropped_.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    return true;
+}
+
+void AsyncLogSink::Stop() {
+    if (stopped_.exchange(true)) {
+        return;
+    }
+    if (worker_.joinable()) {
+        worker_.join();
+    }
+}
+
+size_t AsyncLogSink::Drain() {
+    size_t count = 0;
+    while (auto line = queue_.TryPop()) {
+        out_.write(line->data(), static_cast<std::streamsize>(line->size()));
+        ++count;
+    }
+    if (count) {
+        // сбрасываем пачкой, а не после каждой строки
+        out_.flush();
+        written_.fetch_add(count, std::memory_order_relaxed);
+    }
+    return count;
+}
+
+void AsyncLogSink::Run() {
+    using namespace std::chrono_literals;
+    while (!stopped_.load(std::memory_order_acquire)) {
+        if (Drain() == 0) {
+            // писатели не будят поток, чтобы не делать системный вызов на каждую строку
+            std::this_thread::sleep_for(1ms);
+        }
+    }
+    Drain();
+}
+
+// ------------------------- SamplingConfig ---------------------------
+
+SamplingConfig SamplingConfig::Parse(const std::vector<std::string>& rules, double default_rate,
+    std::chrono::milliseconds slow_threshold) {
+    SamplingConfig config;
+    config.default_rate = default_rate;
+    config.slow_threshold = slow_threshold;
+    for (const std::string& rule : rules) {
+        const auto eq = rule.rfind('=');
+        if (eq == std::string::npos || eq == 0) {
+            throw std::invalid_argument("log sample rule must look like endpoint=rate: " + rule);
+        }
+        config.rate_by_endpoint[rule.substr(0, eq)] = std::stod(rule.substr(eq + 1));
+    }
+    return config;
+}
+
+double SamplingConfig::RateFor(std::string_view endpoint) const {
+    if (auto it = rate_by_endpoint.find(std::string(endpoint)); it != rate_by_endpoint.end()) {
+        return it->second;
+    }
+    return default_rate;
+}
+
+bool SamplingConfig::ShouldSample(std::string_view endpoint) const {
+    const double rate = RateFor(endpoint);
+    if (rate >= 1.0) {
+        return true;
+    }
+    if (rate <= 0.0) {
+        return false;
+    }
+    thread_local std::minstd_rand rng{ std::random_device{}() };
+    return std::uniform_real_distribution<double>(0.0, 1.0)(rng) < rate;
+}
+
+bool SamplingConfig::MustKeep(int status_code, std::chrono::microseconds duration) const {
+    return status_code >= 400 || duration >= slow_threshold;
+}
+
+// ------------------------- JsonLine ---------------------------------
+
+void AppendJsonString(std::string& out, std::string_view value) {
+    static constexpr char HEX[] = "0123456789abcdef";
+    out += '"';
+    for (char c : value) {
+        switch (c) {
+        case '"': out += "\\\""; break;
+        case '\\': out += "\\\\"; break;
+        case '\n': out += "\\n"; break;
+        case '\r': out += "\\r"; break;
+        case '\t': out += "\\t"; break;
+        default:
+            if (static_cast<unsigned char>(c) < 0x20) {
+                out += "\\u00";
+                out += HEX[(c >> 4) & 0xF];
+                out += HEX[c & 0xF];
+            }
+            else {
+                out += c;
+            }
+        }
+    }
+    out += '"';
+}
+
+JsonLine::JsonLine() {
+    line_.reserve(256);
+    line_ += "{\"timestamp\":";
+    AppendJsonString(line_, boost::posix_time::to_iso_extended_string(
+        boost::posix_time::microsec_clock::local_time()));
+    line_ += ",\"data\":{";
+}
+
+void JsonLine::AppendKey(std::string_view key) {
+    if (has_fields_) {
+        line_ += ',';
+    }
+    has_fields_ = true;
+    AppendJsonString(line_, key);
+    line_ += ':';
+}
+
+JsonLine& JsonLine::Field(std::string_view key, std::string_view value) {
+    AppendKey(key);
+    AppendJsonString(line_, value);
+    return *this;
+}
+
+JsonLine& JsonLine::Field(std::string_view key, int64_t value) {
+    AppendKey(key);
+    char buf[24];
+    auto [end, ec] = std::to_chars(buf, buf + sizeof(buf), value);
+    line_.append(buf, end);
+    return *this;
+}
+
+JsonLine& JsonLine::NullField(std::string_view key) {
+    AppendKey(key);
+    line_ += "null";
+    return *this;
+}
+
+std::string JsonLine::Finish(std::string_view message) {
+    line_ += "},\"message\":";
+    AppendJsonString(line_, message);
+    line_ += "}\n";
+    return std::move(line_);
+}
+
+}  // namespace async_log
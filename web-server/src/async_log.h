@@ -0,0 +1,174 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace async_log {
+
+/*
+ * Ограниченная MPMC-очередь без блокировок (схема Д. Вьюкова).
+ * У каждой ячейки свой номер последовательности: по нему писатель понимает, что ячейка свободна,
+ * а читатель - что в ней уже лежит значение. Ёмкость округляется вверх до степени двойки.
+ */
+template <typename T>
+class BoundedQueue {
+public:
+    explicit BoundedQueue(size_t capacity) {
+        size_t size = 2;
+        while (size < capacity) {
+            size <<= 1;
+        }
+        mask_ = size - 1;
+        cells_ = std::make_unique<Cell[]>(size);
+        for (size_t i = 0; i < size; ++i) {
+            cells_[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    size_t Capacity() const {
+        return mask_ + 1;
+    }
+
+    // false - очередь заполнена, value остаётся у вызывающего
+    bool TryPush(T& value) {
+        size_t pos = enqueue_pos_.load(std::memory_order_relaxed);
+        for (;;) {
+            Cell& cell = cells_[pos & mask_];
+            const size_t seq = cell.sequence.load(std::memory_order_acquire);
+            const auto diff = static_cast<std::ptrdiff_t>(seq) - static_cast<std::ptrdiff_t>(pos);
+            if (diff == 0) {
+                if (enqueue_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    cell.value = std::move(value);
+                    cell.sequence.store(pos + 1, std::memory_order_release);
+                    return true;
+                }
+            }
+            else if (diff < 0) {
+                return false;
+            }
+            else {
+                pos = enqueue_pos_.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    std::optional<T> TryPop() {
+        size_t pos = dequeue_pos_.load(std::memory_order_relaxed);
+        for (;;) {
+            Cell& cell = cells_[pos & mask_];
+            const size_t seq = cell.sequence.load(std::memory_order_acquire);
+            const auto diff = static_cast<std::ptrdiff_t>(seq) - static_cast<std::ptrdiff_t>(pos + 1);
+            if (diff == 0) {
+                if (dequeue_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    std::optional<T> result(std::move(cell.value));
+                    cell.sequence.store(pos + mask_ + 1, std::memory_order_release);
+                    return result;
+                }
+            }
+            else if (diff < 0) {
+                return std::nullopt;
+            }
+            else {
+                pos = dequeue_pos_.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+private:
+    struct Cell {
+        std::atomic<size_t> sequence{ 0 };
+        T value{};
+    };
+
+    std::unique_ptr<Cell[]> cells_;
+    size_t mask_ = 0;
+    alignas(64) std::atomic<size_t> enqueue_pos_{ 0 };
+    alignas(64) std::atomic<size_t> dequeue_pos_{ 0 };
+};
+
+/*
+ * Асинхронный вывод готовых строк лога.
+ * Потоки-обработчики только кладут строку в очередь, пишет в поток вывода отдельный поток.
+ * Если очередь переполнена, строка выкидывается и учитывается в счётчике dropped.
+ */
+class AsyncLogSink {
+public:
+    AsyncLogSink(std::ostream& out, size_t capacity);
+    ~AsyncLogSink();
+
+    AsyncLogSink(const AsyncLogSink&) = delete;
+    AsyncLogSink& operator=(const AsyncLogSink&) = delete;
+
+    bool TryWrite(std::string line);
+    // дописывает всё, что уже в очереди, и останавливает поток
+    void Stop();
+
+    uint64_t GetDropped() const {
+        return dropped_.load(std::memory_order_relaxed);
+    }
+
+    uint64_t GetWritten() const {
+        return written_.load(std::memory_order_relaxed);
+    }
+
+private:
+    void Run();
+    size_t Drain();
+
+    std::ostream& out_;
+    BoundedQueue<std::string> queue_;
+    std::atomic<bool> stopped_{ false };
+    std::atomic<uint64_t> dropped_{ 0 };
+    std::atomic<uint64_t> written_{ 0 };
+    std::thread worker_;
+};
+
+// какая доля запросов попадает в лог, по endpoint
+struct SamplingConfig {
+    double default_rate = 1.0;
+    std::unordered_map<std::string, double> rate_by_endpoint;
+    // ответы дольше порога пишем всегда, как и ошибки
+    std::chrono::milliseconds slow_threshold{ 100 };
+
+    // строки вида "/api/v1/game/state=0.01"
+    static SamplingConfig Parse(const std::vector<std::string>& rules, double default_rate,
+        std::chrono::milliseconds slow_threshold);
+
+    double RateFor(std::string_view endpoint) const;
+    bool ShouldSample(std::string_view endpoint) const;
+    bool MustKeep(int status_code, std::chrono::microseconds duration) const;
+};
+
+/*
+ * Сборка строки лога сразу в текст, без промежуточного boost::json::object.
+ * Формат такой же, как у JsonFormatter: {"timestamp":...,"data":{...},"message":...}
+ */
+class JsonLine {
+public:
+    JsonLine();
+
+    JsonLine& Field(std::string_view key, std::string_view value);
+    JsonLine& Field(std::string_view key, int64_t value);
+    JsonLine& NullField(std::string_view key);
+
+    std::string Finish(std::string_view message);
+
+private:
+    void AppendKey(std::string_view key);
+
+    std::string line_;
+    bool has_fields_ = false;
+};
+
+void AppendJsonString(std::string& out, std::string_view value);
+
+}  // namespace async_log
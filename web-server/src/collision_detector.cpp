@@ -1,6 +1,11 @@
 ﻿#include "collision_detector.h"
 #include <cassert>
 
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#define COLLISION_DETECTOR_AVX2
+#include <immintrin.h>
+#endif
+
 namespace collision_detector {
 
 CollectionResult TryCollectPoint(model::RealCoord a, model::RealCoord b, model::RealCoord c) {
@@ -23,40 +28,120 @@ CollectionResult TryCollectPoint(model::RealCoord a, model::RealCoord b, model::
 }
 
 
-std::vector<GatheringEvent> FindGatherEvents(const ItemGathererProvider& provider) {
-    std::vector<GatheringEvent> events;
-
-    const size_t items_count = provider.ItemsCount();
-    const size_t gatherers_count = provider.GatherersCount();
-
-    // Перебираем всех собирателей и все предметы
-    for (size_t g_id = 0; g_id < gatherers_count; ++g_id) {
-        Gatherer g = provider.GetGatherer(g_id);
+namespace {
+
+// отрезок одного собирателя, посчитанный один раз на все предметы
+struct Segment {
+    size_t id;
+    double a_x;
+    double a_y;
+    double v_x;
+    double v_y;
+    double v_len2;
+    double width;
+};
+
+// те же формулы, что в TryCollectPoint, для предметов начиная с first
+void CollectScalar(const Segment& g, const ItemBatch& items, size_t first, std::vector<GatheringEvent>& events) {
+    const auto xs = items.X();
+    const auto ys = items.Y();
+    const auto widths = items.Width();
+    for (size_t i = first; i < xs.size(); ++i) {
+        const double u_x = xs[i] - g.a_x;
+        const double u_y = ys[i] - g.a_y;
+        const double u_dot_v = u_x * g.v_x + u_y * g.v_y;
+        const double u_len2 = u_x * u_x + u_y * u_y;
+        const double proj_ratio = u_dot_v / g.v_len2;
+        const double sq_distance = u_len2 - (u_dot_v * u_dot_v) / g.v_len2;
+        const double collect_radius = g.width + widths[i];
+        if (proj_ratio >= 0 && proj_ratio <= 1 && sq_distance <= collect_radius * collect_radius) {
+            events.push_back(GatheringEvent{ i, g.id, sq_distance, proj_ratio });
+        }
+    }
+}
 
-        // Если собиратель не двигался — столкновений не ищем
-        if (g.start_pos.GetX() == g.end_pos.GetX() && g.start_pos.GetY() == g.end_pos.GetY()) {
+#ifdef COLLISION_DETECTOR_AVX2
+// по четыре предмета за раз. Умножения и сложения раздельные (без FMA),
+// поэтому результат побитово совпадает со скалярной версией
+__attribute__((target("avx2")))
+void CollectAvx2(const Segment& g, const ItemBatch& items, std::vector<GatheringEvent>& events) {
+    const double* xs = items.X().data();
+    const double* ys = items.Y().data();
+    const double* widths = items.Width().data();
+    const size_t count = items.Size();
+
+    const __m256d a_x = _mm256_set1_pd(g.a_x);
+    const __m256d a_y = _mm256_set1_pd(g.a_y);
+    const __m256d v_x = _mm256_set1_pd(g.v_x);
+    const __m256d v_y = _mm256_set1_pd(g.v_y);
+    const __m256d v_len2 = _mm256_set1_pd(g.v_len2);
+    const __m256d width = _mm256_set1_pd(g.width);
+    const __m256d zero = _mm256_setzero_pd();
+    const __m256d one = _mm256_set1_pd(1.0);
+
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        const __m256d u_x = _mm256_sub_pd(_mm256_loadu_pd(xs + i), a_x);
+        const __m256d u_y = _mm256_sub_pd(_mm256_loadu_pd(ys + i), a_y);
+        const __m256d u_dot_v = _mm256_add_pd(_mm256_mul_pd(u_x, v_x), _mm256_mul_pd(u_y, v_y));
+        const __m256d u_len2 = _mm256_add_pd(_mm256_mul_pd(u_x, u_x), _mm256_mul_pd(u_y, u_y));
+        const __m256d proj_ratio = _mm256_div_pd(u_dot_v, v_len2);
+        const __m256d sq_distance = _mm256_sub_pd(u_len2, _mm256_div_pd(_mm256_mul_pd(u_dot_v, u_dot_v), v_len2));
+        const __m256d radius = _mm256_add_pd(width, _mm256_loadu_pd(widths + i));
+
+        const __m256d collected = _mm256_and_pd(
+            _mm256_and_pd(_mm256_cmp_pd(proj_ratio, zero, _CMP_GE_OQ), _mm256_cmp_pd(proj_ratio, one, _CMP_LE_OQ)),
+            _mm256_cmp_pd(sq_distance, _mm256_mul_pd(radius, radius), _CMP_LE_OQ));
+        int mask = _mm256_movemask_pd(collected);
+        if (mask == 0) {
             continue;
         }
+        alignas(32) double sq_distances[4];
+        alignas(32) double proj_ratios[4];
+        _mm256_store_pd(sq_distances, sq_distance);
+        _mm256_store_pd(proj_ratios, proj_ratio);
+        while (mask) {
+            const int lane = __builtin_ctz(static_cast<unsigned>(mask));
+            events.push_back(GatheringEvent{ i + lane, g.id, sq_distances[lane], proj_ratios[lane] });
+            mask &= mask - 1;
+        }
+    }
+    CollectScalar(g, items, i, events);
+}
 
-        for (size_t i_id = 0; i_id < items_count; ++i_id) {
-            Item item = provider.GetItem(i_id);
+bool HasAvx2() {
+    static const bool has_avx2 = __builtin_cpu_supports("avx2");
+    return has_avx2;
+}
+#endif
 
-            // Радиус сбора это сумма радиусов
-            const double collect_radius = g.width + item.width;
+}  // namespace
 
-            // Считаем расстояние и относительное время
-            CollectionResult res = TryCollectPoint(g.start_pos, g.end_pos, item.position);
+std::vector<GatheringEvent> FindGatherEvents(const GathererBatch& gatherers, const ItemBatch& items) {
+    std::vector<GatheringEvent> events;
 
-            if (res.IsCollected(collect_radius)) {
-                GatheringEvent ev;
-                ev.item_id = i_id;
-                ev.gatherer_id = g_id;
-                ev.sq_distance = res.sq_distance;
-                ev.time = res.proj_ratio; // относительное время [0,1] вдоль отрезка
+    const auto start_x = gatherers.StartX();
+    const auto start_y = gatherers.StartY();
+    const auto end_x = gatherers.EndX();
+    const auto end_y = gatherers.EndY();
+    const auto widths = gatherers.Width();
 
-                events.emplace_back(ev);
-            }
+    for (size_t g_id = 0; g_id < gatherers.Size(); ++g_id) {
+        // Если собиратель не двигался — столкновений не ищем
+        if (start_x[g_id] == end_x[g_id] && start_y[g_id] == end_y[g_id]) {
+            continue;
+        }
+        const double v_x = end_x[g_id] - start_x[g_id];
+        const double v_y = end_y[g_id] - start_y[g_id];
+        const Segment segment{ g_id, start_x[g_id], start_y[g_id], v_x, v_y, v_x * v_x + v_y * v_y, widths[g_id] };
+
+#ifdef COLLISION_DETECTOR_AVX2
+        if (HasAvx2()) {
+            CollectAvx2(segment, items, events);
+            continue;
         }
+#endif
+        CollectScalar(segment, items, 0, events);
     }
 
     // Сортируем события в хронологическом порядке
@@ -75,5 +160,19 @@ std::vector<GatheringEvent> FindGatherEvents(const ItemGathererProvider& provide
     return events;
 }
 
+std::vector<GatheringEvent> FindGatherEvents(const ItemGathererProvider& provider) {
+    GathererBatch gatherers;
+    gatherers.Reserve(provider.GatherersCount());
+    for (size_t i = 0; i < provider.GatherersCount(); ++i) {
+        gatherers.Add(provider.GetGatherer(i));
+    }
+    ItemBatch items;
+    items.Reserve(provider.ItemsCount());
+    for (size_t i = 0; i < provider.ItemsCount(); ++i) {
+        items.Add(provider.GetItem(i));
+    }
+    return FindGatherEvents(gatherers, items);
+}
+
 
 }  // namespace collision_detector
\ No newline at end of file
@@ -1,6 +1,7 @@
 ﻿#pragma once
 
 #include <algorithm>
+#include <span>
 #include <vector>
 #include "model.h"
 
@@ -51,6 +52,116 @@ struct GatheringEvent {
     double time;
 };
 
+/*
+ * Предметы и собиратели, разложенные по массивам (SoA).
+ * В таком виде FindGatherEvents проверяет несколько предметов за инструкцию и обходится без виртуальных вызовов.
+ * id предмета/собирателя в событиях - порядковый номер добавления.
+ */
+class ItemBatch {
+public:
+    void Add(const Item& item) {
+        x_.push_back(item.position.GetX());
+        y_.push_back(item.position.GetY());
+        width_.push_back(item.width);
+    }
+
+    void Reserve(size_t count) {
+        x_.reserve(count);
+        y_.reserve(count);
+        width_.reserve(count);
+    }
+
+    // память остаётся, пачку удобно переиспользовать от тика к тику
+    void Clear() {
+        x_.clear();
+        y_.clear();
+        width_.clear();
+    }
+
+    size_t Size() const {
+        return x_.size();
+    }
+
+    std::span<const double> X() const {
+        return x_;
+    }
+
+    std::span<const double> Y() const {
+        return y_;
+    }
+
+    std::span<const double> Width() const {
+        return width_;
+    }
+
+private:
+    std::vector<double> x_;
+    std::vector<double> y_;
+    std::vector<double> width_;
+};
+
+class GathererBatch {
+public:
+    void Add(const Gatherer& gatherer) {
+        start_x_.push_back(gatherer.start_pos.GetX());
+        start_y_.push_back(gatherer.start_pos.GetY());
+        end_x_.push_back(gatherer.end_pos.GetX());
+        end_y_.push_back(gatherer.end_pos.GetY());
+        width_.push_back(gatherer.width);
+    }
+
+    void Reserve(size_t count) {
+        start_x_.reserve(count);
+        start_y_.reserve(count);
+        end_x_.reserve(count);
+        end_y_.reserve(count);
+        width_.reserve(count);
+    }
+
+    void Clear() {
+        start_x_.clear();
+        start_y_.clear();
+        end_x_.clear();
+        end_y_.clear();
+        width_.clear();
+    }
+
+    size_t Size() const {
+        return start_x_.size();
+    }
+
+    std::span<const double> StartX() const {
+        return start_x_;
+    }
+
+    std::span<const double> StartY() const {
+        return start_y_;
+    }
+
+    std::span<const double> EndX() const {
+        return end_x_;
+    }
+
+    std::span<const double> EndY() const {
+        return end_y_;
+    }
+
+    std::span<const double> Width() const {
+        return width_;
+    }
+
+private:
+    std::vector<double> start_x_;
+    std::vector<double> start_y_;
+    std::vector<double> end_x_;
+    std::vector<double> end_y_;
+    std::vector<double> width_;
+};
+
+// события по возрастанию времени, при равном времени - по собирателю, затем по предмету
+std::vector<GatheringEvent> FindGatherEvents(const GathererBatch& gatherers, const ItemBatch& items);
+
+// старый интерфейс: копирует провайдера в пачки и считает тем же кодом
 std::vector<GatheringEvent> FindGatherEvents(const ItemGathererProvider& provider);
 
 }  // namespace collision_detector
\ No newline at end of file
@@ -0,0 +1,171 @@
+#include "command_stream.h"
+
+#include <algorithm>
+#include <array>
+#include <istream>
+#include <ostream>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+
+namespace app {
+
+namespace {
+
+constexpr char TICK_C = 'T';
+constexpr char JOIN_C = 'J';
+constexpr char MOVE_C = 'M';
+constexpr std::array<std::string_view, 5> MOVES = { "U", "D", "L", "R", "" };
+
+template <typename... Fns>
+struct Overloaded : Fns... {
+    using Fns::operator()...;
+};
+
+// одна команда - одна строка
+std::string OneLine(std::string_view text) {
+    std::string line(text);
+    std::replace_if(line.begin(), line.end(), [](char c) { return c == '\n' || c == '\r'; }, ' ');
+    return line;
+}
+
+}  // namespace
+
+void WriteCommand(std::ostream& out, const Command& command) {
+    std::visit(Overloaded{
+        [&out](const TickCommand& tick) {
+            out << TICK_C << ' ' << tick.ms << '\n';
+        },
+        [&out](const JoinCommand& join) {
+            out << JOIN_C << ' ' << join.map_id << ' ' << OneLine(join.name) << '\n';
+        },
+        [&out](const MoveCommand& move) {
+            out << MOVE_C << ' ' << move.player << ' ' << move.move << '\n';
+        },
+        }, command);
+}
+
+std::vector<Command> ReadCommands(std::istream& in) {
+    std::vector<Command> commands;
+    std::string line;
+    size_t line_number = 0;
+    while (std::getline(in, line)) {
+        ++line_number;
+        if (line.empty()) {
+            continue;
+        }
+        std::istringstream fields(line.substr(1));
+        // после поля ровно один пробел, дальше остаток строки
+        auto rest = [&fields] {
+            fields.get();
+            std::string text;
+            std::getline(fields, text);
+            return text;
+        };
+
+        bool ok = line.size() == 1 || line[1] == ' ';
+        switch (line[0]) {
+        case TICK_C: {
+            TickCommand tick{};
+            ok = ok && static_cast<bool>(fields >> tick.ms);
+            commands.emplace_back(tick);
+            break;
+        }
+        case JOIN_C: {
+            JoinCommand join;
+            ok = ok && static_cast<bool>(fields >> join.map_id);
+            join.name = rest();
+            commands.emplace_back(std::move(join));
+            break;
+        }
+        case MOVE_C: {
+            MoveCommand move{};
+            ok = ok && static_cast<bool>(fields >> move.player);
+            move.move = rest();
+            commands.emplace_back(std::move(move));
+            break;
+        }
+        default:
+            ok = false;
+        }
+        if (!ok) {
+            throw std::runtime_error("Bad command at line " + std::to_string(line_number) + ": " + line);
+        }
+    }
+    return commands;
+}
+
+void CommandRecorder::OnJoin(const Token& token, const model::Map::Id& map_id, std::string_view name) {
+    const size_t player = player_by_token_.size();
+    player_by_token_.emplace(*token, player);
+    WriteCommand(out_, JoinCommand{ *map_id, std::string(name) });
+}
+
+void CommandRecorder::OnMove(const Token& token, std::string_view move) {
+    if (auto it = player_by_token_.find(*token); it != player_by_token_.end()) {
+        WriteCommand(out_, MoveCommand{ it->second, std::string(move) });
+    }
+}
+
+void CommandRecorder::OnTick(int64_t ms) {
+    WriteCommand(out_, TickCommand{ ms });
+    // тик - граница, по которой запись осмысленно обрезать при падении
+    out_.flush();
+}
+
+ReplayStats ReplayCommands(GameSessionManager& manager, const std::vector<Command>& commands) {
+    ReplayStats stats;
+    std::vector<Token> tokens;
+    for (const Command& command : commands) {
+        std::visit(Overloaded{
+            [&](const TickCommand& tick) {
+                manager.ProcessTick(static_cast<int>(tick.ms));
+                ++stats.ticks;
+            },
+            [&](const JoinCommand& join) {
+                tokens.push_back(manager.AddDogToMap(join.name, model::Map::Id(join.map_id)).first);
+                ++stats.joins;
+            },
+            [&](const MoveCommand& move) {
+                Player* player = move.player < tokens.size() ? manager.FindPlayerByToken(tokens[move.player]) : nullptr;
+                if (!player) {
+                    ++stats.skipped_moves;
+                    return;
+                }
+                manager.SetMoveDog(player, move.move);
+                ++stats.moves;
+            },
+            }, command);
+    }
+    return stats;
+}
+
+std::vector<Command> MakeSyntheticCommands(const model::Game& game, size_t players, size_t ticks,
+    int64_t tick_ms, uint64_t seed) {
+    const auto& maps = game.GetMaps();
+    if (maps.empty()) {
+        throw std::invalid_argument("No maps to play on");
+    }
+
+    std::mt19937_64 rng(seed);
+    std::uniform_int_distribution<size_t> pick_move(0, MOVES.size() - 1);
+    std::bernoulli_distribution change_move(1.0 / 20);
+
+    std::vector<Command> commands;
+    commands.reserve(players * 2 + ticks * (players / 20 + 2));
+    for (size_t i = 0; i < players; ++i) {
+        commands.emplace_back(JoinCommand{ *maps[i % maps.size()].GetId(), "bot" + std::to_string(i) });
+        commands.emplace_back(MoveCommand{ i, std::string(MOVES[pick_move(rng)]) });
+    }
+    for (size_t tick = 0; tick < ticks; ++tick) {
+        for (size_t i = 0; i < players; ++i) {
+            if (change_move(rng)) {
+                commands.emplace_back(MoveCommand{ i, std::string(MOVES[pick_move(rng)]) });
+            }
+        }
+        commands.emplace_back(TickCommand{ tick_ms });
+    }
+    return commands;
+}
+
+}  // namespace app
@@ -0,0 +1,80 @@
+#pragma once
+
+#include "player.h"
+
+#include <cstdint>
+#include <iosfwd>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <variant>
+#include <vector>
+
+namespace app {
+
+/*
+ * Поток команд, которые меняют игру: вход игрока, смена направления, тик.
+ * По нему игру можно прогнать заново без HTTP (--headless) - при том же seed результат тот же.
+ * Игрок адресуется номером входа в потоке (0, 1, ...), токены в запись не попадают.
+ *
+ * Текстовый формат, команда на строку:
+ *   T <ms>
+ *   J <map id> <имя до конца строки>
+ *   M <номер игрока> <U|D|L|R или пусто>
+ */
+struct JoinCommand {
+    std::string map_id;
+    std::string name;
+};
+
+struct MoveCommand {
+    size_t player;
+    std::string move;
+};
+
+struct TickCommand {
+    int64_t ms;
+};
+
+using Command = std::variant<JoinCommand, MoveCommand, TickCommand>;
+
+void WriteCommand(std::ostream& out, const Command& command);
+// на битой строке бросает std::runtime_error с её номером
+std::vector<Command> ReadCommands(std::istream& in);
+
+/*
+ * Пишет живой поток команд от GameSessionManager.
+ * Вызывается из strand'а игры, своей синхронизации нет.
+ * Игроки, которых нет в записи (например, восстановленные из файла состояния), пропускаются.
+ */
+class CommandRecorder {
+public:
+    explicit CommandRecorder(std::ostream& out)
+        : out_(out) {
+    }
+
+    void OnJoin(const Token& token, const model::Map::Id& map_id, std::string_view name);
+    void OnMove(const Token& token, std::string_view move);
+    void OnTick(int64_t ms);
+
+private:
+    std::ostream& out_;
+    std::unordered_map<std::string, size_t> player_by_token_;
+};
+
+struct ReplayStats {
+    size_t ticks = 0;
+    size_t joins = 0;
+    size_t moves = 0;
+    // игрок уже ушёл на покой или не входил
+    size_t skipped_moves = 0;
+};
+
+ReplayStats ReplayCommands(GameSessionManager& manager, const std::vector<Command>& commands);
+
+// players игроков входят на карты по кругу, потом ticks тиков; на каждом тике
+// игрок с вероятностью 1/20 меняет направление
+std::vector<Command> MakeSyntheticCommands(const model::Game& game, size_t players, size_t ticks,
+    int64_t tick_ms, uint64_t seed);
+
+}  // namespace app
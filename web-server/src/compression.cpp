@@ -0,0 +1,138 @@
+#include "compression.h"
+
+#include <zlib.h>
+
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <stdexcept>
+
+namespace http_server {
+
+namespace {
+
+constexpr std::string_view GZIP_S = "gzip";
+constexpr std::string_view DEFLATE_S = "deflate";
+
+// zlib: 15 бит окна, +16 - заголовок gzip вместо zlib
+constexpr int WINDOW_BITS = 15;
+constexpr int GZIP_WINDOW_BITS = WINDOW_BITS + 16;
+constexpr int MEM_LEVEL = 8;
+
+std::string_view Trim(std::string_view text) {
+    while (!text.empty() && std::isspace(static_cast<unsigned char>(text.front()))) {
+        text.remove_prefix(1);
+    }
+    while (!text.empty() && std::isspace(static_cast<unsigned char>(text.back()))) {
+        text.remove_suffix(1);
+    }
+    return text;
+}
+
+bool EqualsNoCase(std::string_view lhs, std::string_view rhs) {
+    return lhs.size() == rhs.size() && std::equal(lhs.begin(), lhs.end(), rhs.begin(), [](char a, char b) {
+        return std::tolower(static_cast<unsigned char>(a)) == std::tolower(static_cast<unsigned char>(b));
+        });
+}
+
+// q из параметров "gzip;q=0.5"; без q - 1, кривое значение - 0
+double ParseQuality(std::string_view params) {
+    while (!params.empty()) {
+        const size_t semicolon = params.find(';');
+        const std::string_view param = Trim(params.substr(0, semicolon));
+        params = semicolon == std::string_view::npos ? std::string_view{} : params.substr(semicolon + 1);
+        if (param.size() < 2 || std::tolower(static_cast<unsigned char>(param[0])) != 'q' || param[1] != '=') {
+            continue;
+        }
+        const std::string_view value = param.substr(2);
+        double quality = 0;
+        const auto [ptr, ec] = std::from_chars(value.data(), value.data() + value.size(), quality);
+        if (ec != std::errc{} || ptr != value.data() + value.size()) {
+            return 0;
+        }
+        return std::clamp(quality, 0.0, 1.0);
+    }
+    return 1;
+}
+
+}  // namespace
+
+std::string_view ToString(ContentCoding coding) {
+    switch (coding) {
+    case ContentCoding::GZIP:
+        return GZIP_S;
+    case ContentCoding::DEFLATE:
+        return DEFLATE_S;
+    case ContentCoding::IDENTITY:
+        break;
+    }
+    return "identity";
+}
+
+ContentCoding SelectContentCoding(std::string_view accept_encoding) {
+    double gzip = -1;
+    double deflate = -1;
+    double any = -1;
+    while (!accept_encoding.empty()) {
+        const size_t comma = accept_encoding.find(',');
+        const std::string_view item = accept_encoding.substr(0, comma);
+        accept_encoding = comma == std::string_view::npos ? std::string_view{} : accept_encoding.substr(comma + 1);
+
+        const size_t semicolon = item.find(';');
+        const std::string_view name = Trim(item.substr(0, semicolon));
+        const double quality = semicolon == std::string_view::npos ? 1 : ParseQuality(item.substr(semicolon + 1));
+        if (EqualsNoCase(name, GZIP_S) || EqualsNoCase(name, "x-gzip")) {
+            gzip = quality;
+        }
+        else if (EqualsNoCase(name, DEFLATE_S)) {
+            deflate = quality;
+        }
+        else if (name == "*") {
+            any = quality;
+        }
+    }
+    // не названное явно подпадает под "*"
+    if (gzip < 0) {
+        gzip = any;
+    }
+    if (deflate < 0) {
+        deflate = any;
+    }
+
+    if (gzip > 0 && gzip >= deflate) {
+        return ContentCoding::GZIP;
+    }
+    if (deflate > 0) {
+        return ContentCoding::DEFLATE;
+    }
+    return ContentCoding::IDENTITY;
+}
+
+std::string Compress(std::string_view data, ContentCoding coding, int level) {
+    if (coding == ContentCoding::IDENTITY) {
+        return std::string(data);
+    }
+
+    z_stream stream{};
+    const int window_bits = coding == ContentCoding::GZIP ? GZIP_WINDOW_BITS : WINDOW_BITS;
+    if (deflateInit2(&stream, std::clamp(level, 1, 9), Z_DEFLATED, window_bits, MEM_LEVEL, Z_DEFAULT_STRATEGY) != Z_OK) {
+        throw std::runtime_error("deflateInit2 failed");
+    }
+
+    // deflateBound - верхняя оценка, одного вызова deflate с Z_FINISH хватает
+    std::string result(deflateBound(&stream, static_cast<uLong>(data.size())), '\0');
+    stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data.data()));
+    stream.avail_in = static_cast<uInt>(data.size());
+    stream.next_out = reinterpret_cast<Bytef*>(result.data());
+    stream.avail_out = static_cast<uInt>(result.size());
+
+    const int status = deflate(&stream, Z_FINISH);
+    result.resize(stream.total_out);
+    deflateEnd(&stream);
+    if (status != Z_STREAM_END) {
+        throw std::runtime_error("deflate failed");
+    }
+    return result;
+}
+
+}  // namespace http_server
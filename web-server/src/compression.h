@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+namespace http_server {
+
+// кодирования тела ответа, которые умеет сервер (Content-Encoding)
+enum class ContentCoding {
+    IDENTITY,
+    GZIP,
+    DEFLATE
+};
+
+std::string_view ToString(ContentCoding coding);
+
+/*
+ * Выбирает кодирование по заголовку Accept-Encoding (RFC 9110).
+ * Из разрешённых клиентом берётся вариант с большим q, при равных - gzip.
+ * q=0 запрещает кодирование, "*" разрешает всё, что не названо явно.
+ */
+ContentCoding SelectContentCoding(std::string_view accept_encoding);
+
+// сжимает zlib'ом; deflate в HTTP - это zlib-обёртка, а не "сырой" поток. Ошибку zlib бросает как std::runtime_error
+std::string Compress(std::string_view data, ContentCoding coding, int level);
+
+struct CompressionSettings {
+    // уровень zlib 1..9, 0 - не сжимать
+    int level = 0;
+    // ответы короче не сжимаются: заголовки gzip и время CPU дороже выигрыша
+    size_t min_size = 1024;
+
+    bool IsEnabled() const {
+        return level > 0;
+    }
+};
+
+}  // namespace http_server
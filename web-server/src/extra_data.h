@@ -15,7 +15,7 @@ public:
             value_ = 0;
         }
     }
-    boost::json::object GetAsJsonObject() {
+    boost::json::object GetAsJsonObject() const {
         return object_;
     }
 
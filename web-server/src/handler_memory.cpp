@@ -0,0 +1,55 @@
+#include "handler_memory.h"
+
+#include <new>
+
+namespace http_server {
+
+HandlerMemory::~HandlerMemory() {
+    for (Block& block : cache_) {
+        if (block.pointer) {
+            ::operator delete(block.pointer);
+        }
+    }
+}
+
+size_t HandlerMemory::BlockSize(size_t size) {
+    size_t block = MIN_BLOCK_SIZE;
+    while (block < size) {
+        block <<= 1;
+    }
+    return block;
+}
+
+void* HandlerMemory::Allocate(size_t size) {
+    const size_t block_size = BlockSize(size);
+    if (block_size <= MAX_CACHED_SIZE) {
+        std::lock_guard lock(mutex_);
+        for (Block& block : cache_) {
+            if (block.pointer && block.size == block_size) {
+                return std::exchange(block.pointer, nullptr);
+            }
+        }
+    }
+    return ::operator new(block_size);
+}
+
+void HandlerMemory::Deallocate(void* pointer, size_t size) noexcept {
+    const size_t block_size = BlockSize(size);
+    if (block_size <= MAX_CACHED_SIZE) {
+        std::lock_guard lock(mutex_);
+        for (Block& block : cache_) {
+            if (!block.pointer) {
+                block = { pointer, block_size };
+                return;
+            }
+        }
+    }
+    ::operator delete(pointer);
+}
+
+HandlerMemory& HandlerMemory::ForThisThread() {
+    thread_local HandlerMemory memory;
+    return memory;
+}
+
+}  // namespace http_server
@@ -0,0 +1,165 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <type_traits>
+#include <utility>
+
+namespace http_server {
+
+/*
+ * Кэш освобождённых блоков памяти.
+ * Размеры округляются до степени двойки, поэтому блок, который отдали после запроса,
+ * подходит под тот же объект на следующем запросе. Пока кэш не пуст, operator new не зовётся.
+ * Блоки крупнее MAX_CACHED_SIZE и блоки сверх CACHE_SLOTS идут мимо кэша.
+ */
+class HandlerMemory {
+public:
+    static constexpr size_t CACHE_SLOTS = 16;
+    static constexpr size_t MIN_BLOCK_SIZE = 64;
+    static constexpr size_t MAX_CACHED_SIZE = 64 * 1024;
+
+    HandlerMemory() = default;
+    HandlerMemory(const HandlerMemory&) = delete;
+    HandlerMemory& operator=(const HandlerMemory&) = delete;
+    ~HandlerMemory();
+
+    void* Allocate(size_t size);
+    void Deallocate(void* pointer, size_t size) noexcept;
+
+    // память потока; для объектов, которые живут дольше любого отдельного соединения
+    static HandlerMemory& ForThisThread();
+
+private:
+    struct Block {
+        void* pointer = nullptr;
+        size_t size = 0;
+    };
+
+    static size_t BlockSize(size_t size);
+
+    // ответ может прийти из strand игры, а освободиться в потоке соединения
+    std::mutex mutex_;
+    std::array<Block, CACHE_SLOTS> cache_;
+};
+
+/*
+ * Аллокатор поверх памяти соединения.
+ * Держит её через shared_ptr: запрос, переехавший в обработчик, может пережить саму сессию.
+ */
+template <typename T>
+class HandlerAllocator {
+public:
+    using value_type = T;
+    using propagate_on_container_copy_assignment = std::true_type;
+    using propagate_on_container_move_assignment = std::true_type;
+    using propagate_on_container_swap = std::true_type;
+
+    explicit HandlerAllocator(std::shared_ptr<HandlerMemory> memory) noexcept
+        : memory_(std::move(memory)) {
+    }
+
+    template <typename U>
+    HandlerAllocator(const HandlerAllocator<U>& other) noexcept
+        : memory_(other.memory_) {
+    }
+
+    // перемещения нет специально: по требованиям к аллокатору источник после move не меняется
+    HandlerAllocator(const HandlerAllocator&) = default;
+    HandlerAllocator& operator=(const HandlerAllocator&) = default;
+
+    T* allocate(size_t n) {
+        static_assert(alignof(T) <= __STDCPP_DEFAULT_NEW_ALIGNMENT__, "over-aligned types are not supported");
+        return static_cast<T*>(memory_->Allocate(sizeof(T) * n));
+    }
+
+    void deallocate(T* pointer, size_t n) noexcept {
+        memory_->Deallocate(pointer, sizeof(T) * n);
+    }
+
+    template <typename U>
+    bool operator==(const HandlerAllocator<U>& other) const noexcept {
+        return memory_ == other.memory_;
+    }
+
+    template <typename U>
+    bool operator!=(const HandlerAllocator<U>& other) const noexcept {
+        return memory_ != other.memory_;
+    }
+
+private:
+    template <typename U>
+    friend class HandlerAllocator;
+
+    std::shared_ptr<HandlerMemory> memory_;
+};
+
+// Аллокатор без состояния: берёт кэш того потока, в котором вызван
+template <typename T>
+class RecyclingAllocator {
+public:
+    using value_type = T;
+
+    RecyclingAllocator() noexcept = default;
+
+    template <typename U>
+    RecyclingAllocator(const RecyclingAllocator<U>&) noexcept {
+    }
+
+    T* allocate(size_t n) {
+        static_assert(alignof(T) <= __STDCPP_DEFAULT_NEW_ALIGNMENT__, "over-aligned types are not supported");
+        return static_cast<T*>(HandlerMemory::ForThisThread().Allocate(sizeof(T) * n));
+    }
+
+    void deallocate(T* pointer, size_t n) noexcept {
+        HandlerMemory::ForThisThread().Deallocate(pointer, sizeof(T) * n);
+    }
+
+    template <typename U>
+    bool operator==(const RecyclingAllocator<U>&) const noexcept {
+        return true;
+    }
+
+    template <typename U>
+    bool operator!=(const RecyclingAllocator<U>&) const noexcept {
+        return false;
+    }
+};
+
+/*
+ * Обработчик завершения с привязанным аллокатором.
+ * Asio берёт память под свои операции через associated_allocator обработчика,
+ * так что состояние async_read/async_write и post между executor'ами ложится в память соединения.
+ */
+template <typename Handler, typename Allocator>
+class AllocatorBinder {
+public:
+    using allocator_type = Allocator;
+
+    template <typename H>
+    AllocatorBinder(H&& handler, const Allocator& allocator)
+        : handler_(std::forward<H>(handler)), allocator_(allocator) {
+    }
+
+    allocator_type get_allocator() const noexcept {
+        return allocator_;
+    }
+
+    template <typename... Args>
+    decltype(auto) operator()(Args&&... args) {
+        return handler_(std::forward<Args>(args)...);
+    }
+
+private:
+    Handler handler_;
+    Allocator allocator_;
+};
+
+template <typename Allocator, typename Handler>
+AllocatorBinder<std::decay_t<Handler>, Allocator> BindAllocator(const Allocator& allocator, Handler&& handler) {
+    return { std::forward<Handler>(handler), allocator };
+}
+
+}  // namespace http_server
@@ -0,0 +1,172 @@
+#pragma once
+#include "request_handler.h"
+#include "metrics.h"
+
+#include <array>
+#include <chrono>
+#include <string>
+
+namespace http_handler {
+
+static constexpr std::string_view METRICS_PATH_S = "/metrics";
+static constexpr std::string_view PROMETHEUS_CONTENT_TYPE_S = "text/plain; version=0.0.4";
+static constexpr std::string_view ENDPOINT_S = "endpoint";
+static constexpr std::string_view MAP_BY_ID_ENDPOINT_S = "/api/v1/maps/:id";
+static constexpr std::string_view ADMIN_ENDPOINT_S = "/api/v1/admin";
+static constexpr std::string_view OTHER_API_ENDPOINT_S = "api_other";
+static constexpr std::string_view STATIC_ENDPOINT_S = "static";
+static constexpr std::string_view API_V1_ADMIN_TRACE_S = "/api/v1/admin/trace";
+static constexpr std::string_view API_V1_ADMIN_SLOW_TICKS_S = "/api/v1/admin/trace/slow-ticks";
+static constexpr std::string_view ADMIN_TOKEN_HEADER_S = "X-Admin-Token";
+
+// сравнение без раннего выхода, чтобы токен не подбирали по времени ответа (длина не секрет)
+inline bool SecretEquals(std::string_view lhs, std::string_view rhs) {
+    if (lhs.size() != rhs.size()) {
+        return false;
+    }
+    unsigned char diff = 0;
+    for (size_t i = 0; i < lhs.size(); ++i) {
+        diff |= static_cast<unsigned char>(lhs[i] ^ rhs[i]);
+    }
+    return diff == 0;
+}
+
+// путь запроса -> метка endpoint с ограниченным числом значений (id карт и файлы не плодят метки)
+inline std::string_view EndpointLabel(std::string_view target) {
+    const auto qpos = target.find('?');
+    const std::string_view path = target.substr(0, qpos);
+
+    if (!path.starts_with(API_S)) {
+        return STATIC_ENDPOINT_S;
+    }
+    for (std::string_view known : { MAP_ID_PREFIX_SHORT, API_V1_GAME_JOIN_S, API_V1_GAME_PLAYERS_S,
+        API_V1_GAME_STATE_S, API_V1_GAME_PLAYER_ACTION_S, API_V1_GAME_TICK_S, API_V1_GAME_RECORDS_S }) {
+        if (path == known) {
+            return known;
+        }
+    }
+    if (path.starts_with(MAP_ID_PREFIX)) {
+        return MAP_BY_ID_ENDPOINT_S;
+    }
+    if (path.starts_with(ADMIN_ENDPOINT_S)) {
+        return ADMIN_ENDPOINT_S;
+    }
+    return OTHER_API_ENDPOINT_S;
+}
+
+/*
+ * Декоратор, который считает метрики по каждому endpoint и сам отвечает на /metrics.
+ * /metrics не проходит ни через логирование, ни через api_strand, поэтому снимается
+ * даже когда strand забит. Так же, мимо strand'а, отдаются дампы трассировки - но только
+ * с админским токеном в X-Admin-Token; без --trace или без токена их просто нет.
+ */
+template<class SomeRequestHandler>
+class MetricsRequestHandler {
+    struct EndpointMetrics {
+        std::string_view endpoint;
+        metrics::Histogram* latency_us;
+        metrics::Histogram* request_bytes;
+        metrics::Histogram* response_bytes;
+    };
+
+public:
+    explicit MetricsRequestHandler(SomeRequestHandler& decorated) : decorated_(decorated) {
+        auto& registry = metrics::Registry::Instance();
+        for (size_t i = 0; i < ENDPOINTS.size(); ++i) {
+            const std::string labels = metrics::Label(ENDPOINT_S, ENDPOINTS[i]);
+            endpoints_[i] = EndpointMetrics{
+                .endpoint = ENDPOINTS[i],
+                .latency_us = &registry.GetHistogram("http_request_duration_us",
+                    "Time from request received to response sent, microseconds", labels),
+                .request_bytes = &registry.GetHistogram("http_request_size_bytes", "Request body size", labels),
+                .response_bytes = &registry.GetHistogram("http_response_size_bytes", "Response body size", labels)
+            };
+        }
+    }
+
+    template <typename Body, typename Allocator, typename Send>
+    void operator()(http::request<Body, http::basic_fields<Allocator>>&& req, Send&& send, std::string ip) {
+        if (req.target() == METRICS_PATH_S) {
+            StringResponse res{ http::status::ok, req.version() };
+            res.set(http::field::content_type, PROMETHEUS_CONTENT_TYPE_S);
+            res.set(http::field::cache_control, NO_CACHE_S);
+            res.keep_alive(req.keep_alive());
+            res.body() = metrics::Registry::Instance().RenderPrometheus();
+            res.prepare_payload();
+            send(std::move(res));
+            return;
+        }
+        if (IsTraceDump(req.target())) {
+            send(MakeTraceDump(req));
+            return;
+        }
+
+        EndpointMetrics& endpoint = FindEndpoint(EndpointLabel(req.target()));
+        endpoint.request_bytes->Record(req.payload_size().value_or(0));
+
+        const auto started = std::chrono::steady_clock::now();
+        auto metrics_send = [&endpoint, started, send = std::forward<Send>(send)](auto&& resp) mutable {
+            const auto duration = std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::steady_clock::now() - started);
+            endpoint.latency_us->Record(static_cast<uint64_t>(duration.count()));
+            endpoint.response_bytes->Record(resp.payload_size().value_or(0));
+            send(std::forward<decltype(resp)>(resp));
+            };
+
+        decorated_(std::move(req), std::move(metrics_send), std::move(ip));
+    }
+
+    // пустой токен - дампы трассировки выключены
+    void SetAdminToken(std::string token) {
+        admin_token_ = std::move(token);
+    }
+
+private:
+    static constexpr std::array<std::string_view, 11> ENDPOINTS = {
+        MAP_ID_PREFIX_SHORT, MAP_BY_ID_ENDPOINT_S, API_V1_GAME_JOIN_S, API_V1_GAME_PLAYERS_S,
+        API_V1_GAME_STATE_S, API_V1_GAME_PLAYER_ACTION_S, API_V1_GAME_TICK_S, API_V1_GAME_RECORDS_S,
+        ADMIN_ENDPOINT_S, OTHER_API_ENDPOINT_S, STATIC_ENDPOINT_S
+    };
+
+    EndpointMetrics& FindEndpoint(std::string_view label) {
+        for (EndpointMetrics& endpoint : endpoints_) {
+            if (endpoint.endpoint == label) {
+                return endpoint;
+            }
+        }
+        return endpoints_.back();
+    }
+
+    bool IsTraceDump(std::string_view target) const {
+        const std::string_view path = target.substr(0, target.find('?'));
+        return (path == API_V1_ADMIN_TRACE_S || path == API_V1_ADMIN_SLOW_TICKS_S)
+            && !admin_token_.empty() && tracing::Tracer::Instance().IsEnabled();
+    }
+
+    template <typename Request>
+    StringResponse MakeTraceDump(const Request& req) const {
+        StringResponse res{ http::status::ok, req.version() };
+        res.set(http::field::content_type, APPLICATION_JSON_S);
+        res.set(http::field::cache_control, NO_CACHE_S);
+        res.keep_alive(req.keep_alive());
+
+        const auto it = req.find(ADMIN_TOKEN_HEADER_S);
+        if (it == req.end() || !SecretEquals(it->value(), admin_token_)) {
+            res.result(http::status::unauthorized);
+            res.body() = boost::json::serialize(ErrorInvalidAdminToken());
+        }
+        else {
+            const auto& tracer = tracing::Tracer::Instance();
+            const std::string_view path = req.target().substr(0, req.target().find('?'));
+            res.body() = path == API_V1_ADMIN_TRACE_S ? tracer.DumpChromeTrace() : tracer.DumpSlowTicks();
+        }
+        res.prepare_payload();
+        return res;
+    }
+
+    SomeRequestHandler& decorated_;
+    std::array<EndpointMetrics, ENDPOINTS.size()> endpoints_;
+    std::string admin_token_;
+};
+
+}  // namespace http_handler
@@ -1,53 +1,223 @@
 ﻿#include "http_server.h"
 #include "logger.h"
 
+#include <algorithm>
+
 namespace http_server {
 
+// --------------- ConnectionTracker ------------
+
+ConnectionTracker::ConnectionTracker(net::io_context& ioc, const ConnectionLimits& limits)
+    : limits_(limits)
+    , timer_(ioc)
+    , start_(std::chrono::steady_clock::now())
+    , active_gauge_(metrics::Registry::Instance().GetGauge("http_connections_active", "Open HTTP connections"))
+    , rejected_(metrics::Registry::Instance().GetCounter("http_connections_rejected_total",
+        "Connections closed right after accept because max connections was reached"))
+    , evicted_read_(metrics::Registry::Instance().GetCounter("http_connections_evicted_total",
+        "Connections closed by timeout", metrics::Label("reason", "read")))
+    , evicted_idle_(metrics::Registry::Instance().GetCounter("http_connections_evicted_total",
+        "Connections closed by timeout", metrics::Label("reason", "idle"))) {
+    if (limits_.tick <= std::chrono::milliseconds::zero()) {
+        throw std::invalid_argument("connection timeout tick must be positive");
+    }
+}
+
+void ConnectionTracker::Start() {
+    WaitTick();
+}
+
+uint64_t ConnectionTracker::TickAt(std::chrono::steady_clock::time_point time) const {
+    return static_cast<uint64_t>((time - start_) / limits_.tick);
+}
+
+void ConnectionTracker::WaitTick() {
+    timer_.expires_after(limits_.tick);
+    timer_.async_wait([self = shared_from_this()](sys::error_code ec) {
+        if (!ec) {
+            self->OnTick();
+        }
+    });
+}
+
+void ConnectionTracker::OnTick() {
+    // сессии закрываем уже без мьютекса: последняя ссылка на сессию может уйти здесь,
+    // а её деструктор сам берёт мьютекс в Remove
+    std::vector<std::shared_ptr<SessionBase>> expired;
+    {
+        std::lock_guard lock(mutex_);
+        wheel_.Advance(TickAt(std::chrono::steady_clock::now()), [this, &expired](TimerWheel::Entry& wheel_entry) {
+            auto& entry = static_cast<Entry&>(wheel_entry);
+            (entry.kind == Timeout::Idle ? evicted_idle_ : evicted_read_).Add();
+            // запись снята с колеса, а деструктор сессии ждёт мьютекс, так что weak_ptr здесь ещё цел
+            if (auto session = entry.session.lock()) {
+                expired.push_back(std::move(session));
+            }
+        });
+    }
+    for (auto& session : expired) {
+        session->OnTimeout();
+    }
+    WaitTick();
+}
+
+bool ConnectionTracker::TryAdd() {
+    const size_t active = active_.fetch_add(1, std::memory_order_relaxed);
+    if (limits_.max_connections && active >= limits_.max_connections) {
+        active_.fetch_sub(1, std::memory_order_relaxed);
+        rejected_.Add();
+        return false;
+    }
+    active_gauge_.Add(1);
+    return true;
+}
+
+void ConnectionTracker::Remove(Entry& entry) {
+    Disarm(entry);
+    active_.fetch_sub(1, std::memory_order_relaxed);
+    active_gauge_.Add(-1);
+}
+
+void ConnectionTracker::Arm(Entry& entry, Timeout kind) {
+    const auto timeout = kind == Timeout::Idle ? limits_.idle_timeout : limits_.read_timeout;
+    // +1: тик, в котором ставим, уже частично прошёл, таймаут не должен сработать раньше срока
+    const uint64_t expires = TickAt(std::chrono::steady_clock::now() + timeout) + 1;
+    std::lock_guard lock(mutex_);
+    entry.kind = kind;
+    wheel_.Schedule(entry, expires);
+}
+
+void ConnectionTracker::Disarm(Entry& entry) {
+    std::lock_guard lock(mutex_);
+    wheel_.Cancel(entry);
+}
+
 // --------------- SessionBase ------------------
 
 void SessionBase::Run() {
-    net::dispatch(stream_.get_executor(),
-        beast::bind_front_handler(&SessionBase::Read, GetSharedThis()));
+    net::dispatch(socket_.get_executor(), [self = GetSharedThis()] {
+        self->timeout_.session = self;
+        self->tracker_->Arm(self->timeout_, ConnectionTracker::Timeout::Read);
+        self->Read();
+    });
 }
 
 void SessionBase::Read() {
-    request_ = {};
-    stream_.expires_after(30s);
+    reading_ = true;
+    request_ = HttpRequest(std::piecewise_construct, std::make_tuple(GetAllocator()), std::make_tuple(GetAllocator()));
 
-    http::async_read(stream_, buffer_, request_,
-        beast::bind_front_handler(&SessionBase::OnRead, GetSharedThis()));
+    http::async_read(socket_, buffer_, request_, BindAllocator(GetAllocator(),
+        beast::bind_front_handler(&SessionBase::OnRead, GetSharedThis())));
 }
 
 void SessionBase::OnRead(beast::error_code ec, [[maybe_unused]] std::size_t bytes_read) {
+    reading_ = false;
     if (ec == http::error::end_of_stream) {
-        return Close();
+        // клиент больше ничего не пришлёт, но ответы на уже прочитанные запросы допишем
+        stop_reading_ = true;
+        eof_ = true;
+        if (next_write_ == next_read_) {
+            Close();
+        }
+        return;
     }
     if (ec) {
+        if (timed_out_) {
+            // соединение закрыли по таймауту, это уже посчитано в метриках
+            return;
+        }
         LogNetError(ec.value(), ec.message(), READ_S);
         return ReportError(ec, "read"sv);
     }
-    HandleRequest(std::move(request_));
+    // соединение уже закрывается после ответа с Connection: close
+    if (stop_reading_) {
+        return;
+    }
+    // обработка и отправка ответа укладываются в read_timeout
+    tracker_->Arm(timeout_, ConnectionTracker::Timeout::Read);
+    // после Connection: close запросы дальше не читаем
+    stop_reading_ = !request_.keep_alive();
+    HandleRequest(std::move(request_), next_read_++);
+
+    // не ждём ответа: следующий запрос уже может лежать в буфере или идти по сети
+    if (!stop_reading_ && next_read_ - next_write_ < pending_.size()) {
+        Read();
+    }
+}
+
+void SessionBase::Enqueue(uint64_t sequence, std::shared_ptr<PendingWriteBase> pending) {
+    pending_[sequence % pending_.size()] = std::move(pending);
+    WriteNext();
+}
+
+void SessionBase::WriteNext() {
+    if (writing_) {
+        return;
+    }
+    auto& next = pending_[next_write_ % pending_.size()];
+    if (!next) {
+        return;
+    }
+    writing_ = std::move(next);
+    writing_->Start(*this);
 }
 
 void SessionBase::Close() {
-    stream_.socket().shutdown(tcp::socket::shutdown_send);
+    tracker_->Disarm(timeout_);
+    socket_.shutdown(tcp::socket::shutdown_send);
+}
+
+void SessionBase::OnTimeout() {
+    net::post(socket_.get_executor(), [self = GetSharedThis()] {
+        self->timed_out_ = true;
+        // незавершённые чтение или запись получат operation_aborted
+        beast::error_code ignored;
+        self->socket_.close(ignored);
+    });
+}
+
+SessionBase::SessionBase(SessionSocket&& socket, std::shared_ptr<ConnectionTracker> tracker)
+    : memory_(std::allocate_shared<HandlerMemory>(RecyclingAllocator<HandlerMemory>()))
+    , socket_(std::move(socket))
+    , tracker_(std::move(tracker))
+    , request_(std::piecewise_construct, std::make_tuple(GetAllocator()), std::make_tuple(GetAllocator()))
+    , pending_(std::max<size_t>(tracker_->GetPipelineDepth(), 1)) {
+    client_ip_ = socket_.remote_endpoint().address().to_string();
 }
 
-SessionBase::SessionBase(tcp::socket&& socket)
-    : stream_(std::move(socket)) {
-    client_ip_ = stream_.socket().remote_endpoint().address().to_string();
+SessionBase::~SessionBase() {
+    tracker_->Remove(timeout_);
 }
 
 void SessionBase::OnWrite(bool close, beast::error_code ec, [[maybe_unused]] std::size_t bytes_written) {
+    writing_.reset();
+    ++next_write_;
     if (ec) {
+        if (timed_out_) {
+            return;
+        }
         return ReportError(ec, "write"sv);
     }
 
     if (close) {
+        // ответы на запросы, прочитанные после этого, уже не нужны
+        stop_reading_ = true;
         return Close();
     }
 
-    Read();
+    const bool idle = next_write_ == next_read_;
+    if (idle && eof_) {
+        return Close();
+    }
+    if (idle) {
+        // keep-alive: ждём следующий запрос не дольше idle_timeout
+        tracker_->Arm(timeout_, ConnectionTracker::Timeout::Idle);
+    }
+    // чтение стояло, потому что конвейер был заполнен
+    if (!reading_ && !stop_reading_) {
+        Read();
+    }
+    WriteNext();
 }
 
 std::string SessionBase::GetClientIp() const {
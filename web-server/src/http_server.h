@@ -1,11 +1,22 @@
 ﻿#pragma once
 #include "sdk.h"
+#include "handler_memory.h"
+#include "timer_wheel.h"
+#include "metrics.h"
+
 #include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/dispatch.hpp>
+#include <boost/asio/post.hpp>
+#include <boost/asio/steady_timer.hpp>
 #include <boost/asio/strand.hpp>
 #include <boost/beast/core.hpp>
 #include <boost/beast/http.hpp>
+#include <chrono>
 #include <iostream>
 #include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <vector>
 
 namespace http_server {
 
@@ -17,13 +28,89 @@ namespace http_server {
     using namespace boost;
     using namespace std::literals;
 
+    // Executor соединения задан конкретным типом, а не any_io_executor:
+    // стертый executor со strand'ом внутри выделяет память при каждой операции с сокетом.
+    // По той же причине не используем beast::tcp_stream: таймауты ведёт ConnectionTracker
+    using SessionStrand = net::strand<net::io_context::executor_type>;
+    using SessionSocket = tcp::socket::rebind_executor<SessionStrand>::other;
+
     inline void ReportError(beast::error_code ec, std::string_view what) {
         std::cerr << what << ": "sv << ec.message() << std::endl;
     }
 
+    class SessionBase;
+
+    struct ConnectionLimits {
+        size_t max_connections = 0;                    // 0 - без ограничения
+        std::chrono::seconds read_timeout{ 30 };       // от начала запроса до отправки ответа
+        std::chrono::seconds idle_timeout{ 30 };       // keep-alive соединение ждёт следующий запрос
+        std::chrono::milliseconds tick{ 1000 };        // шаг колеса таймаутов
+        size_t pipeline_depth = 8;                     // сколько запросов соединения обрабатываются одновременно, 1 - без конвейера
+    };
+
+    /*
+     * Соединения одного Listener'а: их число и таймауты.
+     * Все таймауты лежат в одном TimerWheel, который прокручивает один таймер раз в тик,
+     * вместо отдельного таймера Asio на каждое соединение и каждый запрос.
+     */
+    class ConnectionTracker : public std::enable_shared_from_this<ConnectionTracker> {
+    public:
+        enum class Timeout {
+            Read,
+            Idle
+        };
+
+        struct Entry : TimerWheel::Entry {
+            std::weak_ptr<SessionBase> session;
+            Timeout kind = Timeout::Read;
+        };
+
+        ConnectionTracker(net::io_context& ioc, const ConnectionLimits& limits);
+
+        // запускает прокрутку колеса
+        void Start();
+
+        // false - достигнут max_connections, соединение надо закрыть
+        bool TryAdd();
+        void Remove(Entry& entry);
+
+        void Arm(Entry& entry, Timeout kind);
+        void Disarm(Entry& entry);
+
+        size_t GetActiveConnections() const {
+            return active_.load(std::memory_order_relaxed);
+        }
+
+        size_t GetPipelineDepth() const {
+            return limits_.pipeline_depth;
+        }
+
+    private:
+        void WaitTick();
+        void OnTick();
+        uint64_t TickAt(std::chrono::steady_clock::time_point time) const;
+
+        ConnectionLimits limits_;
+        net::steady_timer timer_;
+        std::chrono::steady_clock::time_point start_;
+
+        // сессии разных потоков общего io_context трогают колесо одновременно
+        std::mutex mutex_;
+        TimerWheel wheel_;
+        std::atomic<size_t> active_{ 0 };
+
+        metrics::Gauge& active_gauge_;
+        metrics::Counter& rejected_;
+        metrics::Counter& evicted_read_;
+        metrics::Counter& evicted_idle_;
+    };
+
     class SessionBase {
     protected:
-        using HttpRequest = http::request<http::string_body>;
+        // заголовки и тело запроса выделяются из памяти соединения
+        using Allocator = HandlerAllocator<char>;
+        using HttpRequest = http::request<http::basic_string_body<char, std::char_traits<char>, Allocator>,
+            http::basic_fields<Allocator>>;
 
     public:
         SessionBase(const SessionBase&) = delete;
@@ -33,47 +120,98 @@ namespace http_server {
 
         void Run();
 
+        // срабатывание таймаута из ConnectionTracker; закрытие уходит на executor соединения
+        void OnTimeout();
+
     private:
+        // ответ, который ждёт своей очереди: ответы уходят строго в порядке запросов
+        struct PendingWriteBase {
+            virtual ~PendingWriteBase() = default;
+            virtual void Start(SessionBase& session) = 0;
+        };
+
+        template <typename Response>
+        struct PendingWrite final : PendingWriteBase {
+            explicit PendingWrite(Response&& res)
+                : response(std::move(res)) {
+            }
+
+            void Start(SessionBase& session) override {
+                // ответ живёт в session.writing_ до OnWrite
+                http::async_write(session.socket_, response, BindAllocator(session.GetAllocator(),
+                    [self = session.GetSharedThis(), close = response.need_eof()](beast::error_code ec, std::size_t bytes_written) {
+                        self->OnWrite(close, ec, bytes_written);
+                    }));
+            }
+
+            Response response;
+        };
+
         void Read();
 
         void OnRead(beast::error_code ec, [[maybe_unused]] std::size_t bytes_read);
 
         void Close();
 
-        virtual void HandleRequest(HttpRequest&& request) = 0;
+        void Enqueue(uint64_t sequence, std::shared_ptr<PendingWriteBase> pending);
+        // пишет следующий по порядку ответ, если он готов и запись свободна
+        void WriteNext();
+
+        // sequence - номер запроса на соединении, с ним же потом приходит ответ в Write
+        virtual void HandleRequest(HttpRequest&& request, uint64_t sequence) = 0;
 
         virtual std::shared_ptr<SessionBase> GetSharedThis() = 0;
 
     protected:
-        explicit SessionBase(tcp::socket&& socket);
+        SessionBase(SessionSocket&& socket, std::shared_ptr<ConnectionTracker> tracker);
 
+        // вызывается на executor'е соединения, ответы на конвейер запросов могут приходить в любом порядке
         template <typename Body, typename Fields>
-        void Write(http::response<Body, Fields>&& response) {
-            auto safe_response = std::make_shared<http::response<Body, Fields>>(std::move(response));
-
-            auto self = GetSharedThis();
-            http::async_write(stream_, *safe_response,
-                [safe_response, self](beast::error_code ec, std::size_t bytes_written) {
-                    self->OnWrite(safe_response->need_eof(), ec, bytes_written);
-                });
+        void Write(http::response<Body, Fields>&& response, uint64_t sequence) {
+            // слот под ответ берётся из памяти соединения и возвращается туда после отправки,
+            // на keep-alive соединении следующий ответ того же типа ляжет в тот же блок
+            using Pending = PendingWrite<http::response<Body, Fields>>;
+            Enqueue(sequence, std::allocate_shared<Pending>(HandlerAllocator<Pending>(memory_), std::move(response)));
         }
 
-        ~SessionBase() = default;
+        ~SessionBase();
+
+        // executor сокета: все операции с соединением выполняются на нём
+        SessionStrand GetExecutor() {
+            return socket_.get_executor();
+        }
+
+        Allocator GetAllocator() const {
+            return Allocator(memory_);
+        }
     private:
         void OnWrite(bool close, beast::error_code ec, [[maybe_unused]] std::size_t bytes_written);
 
-        beast::tcp_stream stream_;
+        std::shared_ptr<HandlerMemory> memory_;
+        SessionSocket socket_;
+        std::shared_ptr<ConnectionTracker> tracker_;
+        ConnectionTracker::Entry timeout_;
+        bool timed_out_ = false;
         beast::flat_buffer buffer_;
         HttpRequest request_;
         std::string client_ip_;
+
+        // конвейер: следующий запрос читается, пока предыдущие ещё в обработке
+        std::vector<std::shared_ptr<PendingWriteBase>> pending_;    // готовые ответы, индекс - номер запроса % глубина
+        std::shared_ptr<PendingWriteBase> writing_;
+        uint64_t next_read_ = 0;        // номер следующего прочитанного запроса
+        uint64_t next_write_ = 0;       // номер ответа, который уходит следующим
+        bool reading_ = false;
+        bool stop_reading_ = false;     // Connection: close или клиент закрыл свою сторону
+        bool eof_ = false;
     };
 
     template <typename RequestHandler>
     class Session : public SessionBase, public std::enable_shared_from_this<Session<RequestHandler>> {
     public:
         template <typename Handler>
-        Session(tcp::socket&& socket, Handler&& request_handler)
-            : SessionBase(std::move(socket))
+        Session(SessionSocket&& socket, Handler&& request_handler, std::shared_ptr<ConnectionTracker> tracker)
+            : SessionBase(std::move(socket), std::move(tracker))
             , request_handler_(std::forward<Handler>(request_handler)) {
         }
 
@@ -82,11 +220,16 @@ namespace http_server {
             return this->shared_from_this();
         }
 
-        void HandleRequest(HttpRequest&& request) override {
+        void HandleRequest(HttpRequest&& request, uint64_t sequence) override {
             request_handler_(
                 std::move(request),
-                [self = this->shared_from_this()](auto&& response) {
-                    self->Write(std::move(response));
+                [self = this->shared_from_this(), sequence](auto&& response) {
+                    // ответ может прийти из strand игры, который крутится на другом io_context.
+                    // Запись явно переносим на executor соединения
+                    net::dispatch(self->GetExecutor(), BindAllocator(self->GetAllocator(),
+                        [self, sequence, response = std::move(response)]() mutable {
+                            self->Write(std::move(response), sequence);
+                        }));
                 }
                 , GetClientIp()
             );
@@ -99,17 +242,28 @@ namespace http_server {
     class Listener : public std::enable_shared_from_this<Listener<RequestHandler>> {
     public:
         template <typename Handler>
-        Listener(net::io_context& ioc, const tcp::endpoint& endpoint, Handler&& request_handler)
+        Listener(net::io_context& ioc, const tcp::endpoint& endpoint, Handler&& request_handler,
+            const ConnectionLimits& limits = {}, bool reuse_port = false)
             : ioc_(ioc)
             , acceptor_(net::make_strand(ioc))
+            , tracker_(std::make_shared<ConnectionTracker>(ioc, limits))
             , request_handler_(std::forward<Handler>(request_handler)) {
             acceptor_.open(endpoint.protocol());
             acceptor_.set_option(net::socket_base::reuse_address(true));
+            if (reuse_port) {
+                // несколько acceptor'ов на одном порту, ядро само раздаёт им соединения
+#ifdef SO_REUSEPORT
+                acceptor_.set_option(net::detail::socket_option::boolean<SOL_SOCKET, SO_REUSEPORT>(true));
+#else
+                throw std::runtime_error("SO_REUSEPORT is not supported on this platform");
+#endif
+            }
             acceptor_.bind(endpoint);
             acceptor_.listen(net::socket_base::max_listen_connections);
         }
 
         void Run() {
+            tracker_->Start();
             DoAccept();
         }
 
@@ -119,31 +273,40 @@ namespace http_server {
                 , beast::bind_front_handler(&Listener::OnAccept, this->shared_from_this()));
         }
 
-        void OnAccept(sys::error_code ec, tcp::socket socket) {
+        void OnAccept(sys::error_code ec, SessionSocket socket) {
             if (ec) {
                 return ReportError(ec, "accept"sv);
             }
 
-            AsyncRunSession(std::move(socket));
+            if (tracker_->TryAdd()) {
+                AsyncRunSession(std::move(socket));
+            }
+            else {
+                sys::error_code ignored;
+                socket.close(ignored);
+            }
 
             DoAccept();
         }
 
-        void AsyncRunSession(tcp::socket&& socket) {
-            std::make_shared<Session<RequestHandler>>(std::move(socket), request_handler_)->Run();
+        void AsyncRunSession(SessionSocket&& socket) {
+            using MySession = Session<RequestHandler>;
+            std::allocate_shared<MySession>(RecyclingAllocator<MySession>(), std::move(socket), request_handler_, tracker_)->Run();
         }
 
         net::io_context& ioc_;
         tcp::acceptor acceptor_;
+        std::shared_ptr<ConnectionTracker> tracker_;
         RequestHandler request_handler_;
 
     };
 
     template <typename RequestHandler>
-    void ServeHttp(net::io_context& ioc, const tcp::endpoint& endpoint, RequestHandler&& handler) {
+    void ServeHttp(net::io_context& ioc, const tcp::endpoint& endpoint, RequestHandler&& handler,
+        const ConnectionLimits& limits = {}, bool reuse_port = false) {
         using MyListener = Listener<std::decay_t<RequestHandler>>;
 
-        std::make_shared<MyListener>(ioc, endpoint, std::forward<RequestHandler>(handler))->Run();
+        std::make_shared<MyListener>(ioc, endpoint, std::forward<RequestHandler>(handler), limits, reuse_port)->Run();
     }
 
 }  // namespace http_server
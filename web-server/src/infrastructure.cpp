@@ -5,7 +5,7 @@ namespace infrastructure {
 
 // -------------- для сериализации ---------------------
 
-SerDog ToSerDog(const model::Dog& dog) {
+SerDog ToSerDog(const model::Dog& dog, std::chrono::milliseconds now) {
     // наполним сумку
     std::vector<SerBagItem> items;
     for (const auto& item : dog.bag_with_loot_) {
@@ -24,13 +24,14 @@ SerDog ToSerDog(const model::Dog& dog) {
         .name = dog.name_,
         .score = dog.score_,
         .bag = std::move(items),
-        .time_in_game_ms = dog.play_time_.count(),
-        .time_in_afk_ms = dog.afk_time_.count()
+        // формат файла прежний: сохраняем длительности, а не моменты
+        .time_in_game_ms = dog.GetPlayTime(now).count(),
+        .time_in_afk_ms = dog.GetAfkTime(now).count()
     };	
 }
 
 
-model::Dog FromSerDog(const SerDog& s) {
+model::Dog FromSerDog(const SerDog& s, std::chrono::milliseconds now) {
 	// сумка 
     std::vector<model::BagItem> items;
     for (const auto& item : s.bag) {
@@ -50,8 +51,11 @@ model::Dog FromSerDog(const SerDog& s) {
     dog.direction_ = static_cast<model::Direction>(s.direction);
     dog.bag_with_loot_ = std::move(items);
     dog.score_ = s.score;
-    dog.play_time_ = std::chrono::milliseconds(s.time_in_game_ms);
-    dog.afk_time_ = std::chrono::milliseconds(s.time_in_afk_ms);
+    // моменты восстанавливаем относительно часов новой сессии
+    dog.join_time_ = now - std::chrono::milliseconds(s.time_in_game_ms);
+    if (!dog.IsMoving()) {
+        dog.idle_since_ = now - std::chrono::milliseconds(s.time_in_afk_ms);
+    }
     return dog;    
 }
 
@@ -82,7 +86,7 @@ SerSessionState ToSerSession(const app::GameSession& session) {
     // конвертируем собак
     std::vector<SerDog> converted_dogs;
     for (const auto& dog : session.dogs_) {
-        converted_dogs.push_back(ToSerDog(dog));
+        converted_dogs.push_back(ToSerDog(dog, session.time_));
     }
 
     // теперь конвертируем потерянные объекты
@@ -100,24 +104,23 @@ SerSessionState ToSerSession(const app::GameSession& session) {
 
 // так как изначальное состояние сессии загружаем из конфига
 void FromSerSession(const SerSessionState& ser_session, app::GameSession& session, const model::Game& game /* для указателя на мапу */) {
+    
+    auto map_ptr = game.FindMap(model::Map::Id(ser_session.map_id));
+
     // конвертируем собак
-    std::deque<model::Dog> converted_dogs;
+    session.dogs_.clear();
     for (const auto& dog : ser_session.dogs) {
-        converted_dogs.push_back(FromSerDog(dog));
+        session.dogs_.Insert(FromSerDog(dog, session.time_));
     }
-    
+    session.RebuildIdleQueue();
+    session.local_id = session.dogs_.size();
     // конвертируем потерянные предметы
-    std::vector<model::LostObject> converted_objects;
+    session.lost_objects_.clear();
     for (const auto& object : ser_session.lost_objects) {
-        converted_objects.push_back(FromSerLostObject(object));
+        session.lost_objects_.Insert(FromSerLostObject(object));
     }
-
-    auto map_ptr = game.FindMap(model::Map::Id(ser_session.map_id));
-
-    session.dogs_ = std::move(converted_dogs);
-    session.local_id = session.dogs_.size();
-    session.lost_objects_ = std::move(converted_objects);
     session.map_ptr_ = game.FindMap(model::Map::Id(ser_session.map_id));
+    session.RebuildInterestGrids();
 }
 
 /*
@@ -196,8 +199,9 @@ void FromSerState(app::GameSessionManager& manager, const SerState& ser_state) {
 
         // создаём Player так же, как делает Players::AddDogToSession,
         // только без генерации токена
-        app::Player& player =
-            manager.players_.storage_.emplace_back(session, dog_ptr);
+        auto player_handle =
+            manager.players_.storage_.Emplace(session, dog_ptr, dog_it.GetHandle());
+        app::Player& player = *manager.players_.storage_.Get(player_handle);
 
         app::Token token(sp.token);
         player.SetToken(token);
@@ -206,10 +210,10 @@ void FromSerState(app::GameSessionManager& manager, const SerState& ser_state) {
         manager.player_tokens_.token_to_player_.emplace(std::move(token), &player);
 
         // индексируем по (map_id, dog_id)
-        manager.players_.player_ptr_by_key_[app::PlayerKey{
+        manager.players_.player_handle_by_key_[app::PlayerKey{
             .map_id = session->GetMapPtr()->GetId(),
             .dog_id = dog_ptr->GetId()
-        }] = &player;
+        }] = player_handle;
     }
 }
 
@@ -78,8 +78,8 @@ struct SerDog {
     }
 };
 
-SerDog ToSerDog(const model::Dog& dog);
-model::Dog FromSerDog(const SerDog& s);
+SerDog ToSerDog(const model::Dog& dog, std::chrono::milliseconds now);
+model::Dog FromSerDog(const SerDog& s, std::chrono::milliseconds now);
 
 
 struct SerLostObject {
@@ -99,7 +99,7 @@ SerLostObject ToSerLostObject(const model::LostObject& lo);
 model::LostObject FromSerLostObject(const SerLostObject& s);
 
 /*
-* std::deque<model::Dog> dogs_;
+* DogStorage dogs_;
 
 	uint64_t local_id = 0;
 	const model::Map* map_ptr_;
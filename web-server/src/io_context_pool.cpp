@@ -0,0 +1,72 @@
+#include "io_context_pool.h"
+
+#include <algorithm>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace http_server {
+
+bool PinThisThreadToCpu(unsigned cpu) {
+#ifdef __linux__
+    if (cpu >= CPU_SETSIZE) {
+        return false;
+    }
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#else
+    return false;
+#endif
+}
+
+IoContextPool::IoContextPool(size_t size) {
+    size = std::max<size_t>(1, size);
+    contexts_.reserve(size);
+    guards_.reserve(size);
+    for (size_t i = 0; i < size; ++i) {
+        // подсказка 1: контекст крутит ровно один поток, внутренние блокировки не нужны
+        contexts_.push_back(std::make_unique<net::io_context>(1));
+        guards_.push_back(net::make_work_guard(*contexts_.back()));
+    }
+}
+
+IoContextPool::~IoContextPool() {
+    Stop();
+    Join();
+}
+
+void IoContextPool::Start(bool pin_threads, unsigned first_cpu) {
+    const unsigned cpus = std::max(1u, std::thread::hardware_concurrency());
+    for (size_t i = 0; i < contexts_.size(); ++i) {
+        threads_.emplace_back([this, i, pin_threads, cpu = (first_cpu + i) % cpus] {
+            if (pin_threads) {
+                PinThisThreadToCpu(static_cast<unsigned>(cpu));
+            }
+            contexts_[i]->run();
+        });
+    }
+}
+
+void IoContextPool::Stop() {
+    for (auto& guard : guards_) {
+        guard.reset();
+    }
+    for (auto& context : contexts_) {
+        context->stop();
+    }
+}
+
+void IoContextPool::Join() {
+    for (auto& thread : threads_) {
+        if (thread.joinable()) {
+            thread.join();
+        }
+    }
+    threads_.clear();
+}
+
+}  // namespace http_server
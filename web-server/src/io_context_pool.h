@@ -0,0 +1,53 @@
+#pragma once
+#include "sdk.h"
+
+#include <boost/asio/executor_work_guard.hpp>
+#include <boost/asio/io_context.hpp>
+
+#include <memory>
+#include <thread>
+#include <vector>
+
+namespace http_server {
+
+namespace net = boost::asio;
+
+// привязать текущий поток к ядру; false, если платформа не умеет или ядра нет
+bool PinThisThreadToCpu(unsigned cpu);
+
+/*
+ * Набор однопоточных io_context: по одному на ядро.
+ * Каждый крутит свой поток, у каждого свой acceptor (SO_REUSEPORT) и свои сессии,
+ * поэтому сокеты не прыгают между ядрами, а потоки не делят очередь одного планировщика.
+ */
+class IoContextPool {
+public:
+    explicit IoContextPool(size_t size);
+
+    IoContextPool(const IoContextPool&) = delete;
+    IoContextPool& operator=(const IoContextPool&) = delete;
+
+    ~IoContextPool();
+
+    size_t Size() const {
+        return contexts_.size();
+    }
+
+    net::io_context& Get(size_t index) {
+        return *contexts_[index];
+    }
+
+    // поток i привязывается к ядру first_cpu + i, если pin_threads
+    void Start(bool pin_threads, unsigned first_cpu = 0);
+    void Stop();
+    void Join();
+
+private:
+    using WorkGuard = net::executor_work_guard<net::io_context::executor_type>;
+
+    std::vector<std::unique_ptr<net::io_context>> contexts_;
+    std::vector<WorkGuard> guards_;
+    std::vector<std::thread> threads_;
+};
+
+}  // namespace http_server
@@ -4,6 +4,7 @@
 
 #include "model.h"
 #include "extra_data.h"
+#include <string>
 #include <unordered_map>
 #include <vector>
 #include "tagged.h"
@@ -11,6 +12,8 @@
 #include <boost/json.hpp>
 
 using LootMap = std::unordered_map<model::Map::Id, std::vector<extra_data::LootType>, util::TaggedHasher<model::Map::Id>>;
+// mapId -> готовое тело ответа GET /api/v1/maps/{id}
+using MapResponses = std::unordered_map<model::Map::Id, std::string, util::TaggedHasher<model::Map::Id>>;
 
 namespace json_loader {	
 
@@ -19,6 +22,7 @@ struct LoadedData {
 	LootMap loot_type_by_map_id;	// mapId -> vector<loot_type>, loot_type пока что монолитный json объект
 	extra_data::LootGeneratorConfig gen_config;
 	double dog_retirement_time_sec;
+	MapResponses map_responses;	// есть только в бандле карт, из JSON ответы собираются на запрос
 };
 
 LoadedData LoadGame(const std::filesystem::path& json_path);
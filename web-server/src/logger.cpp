@@ -6,6 +6,12 @@
 #include <boost/log/core.hpp>        // для logging::core
 #include <boost/log/expressions.hpp> // для выражения, задающего фильтр 
 #include <boost/log/utility/manipulators/add_value.hpp>
+#include <boost/log/sinks/basic_sink_backend.hpp>
+#include <boost/log/sinks/sync_frontend.hpp>
+#include <boost/make_shared.hpp>
+
+#include <iostream>
+#include <mutex>
 
 static constexpr std::string_view PORT_S = "port";
 static constexpr std::string_view ADDRESS_S = "address";
@@ -79,10 +85,51 @@ void JsonFormatter(logging::record_view const& rec,
     strm << boost::json::serialize(obj) << '\n'; 
 }
 
+namespace {
+
+// Консольный вывод Boost.Log: в std::cout, а если подключён AsyncLogSink - через его очередь
+class ConsoleBackend : public sinks::basic_formatted_sink_backend<char, sinks::synchronized_feeding> {
+public:
+    void consume(const logging::record_view&, const string_type& line) {
+        std::lock_guard lock(mutex_);
+        if (async_sink_) {
+            async_sink_->TryWrite(line);
+        }
+        else {
+            std::cout << line << std::flush;
+        }
+    }
+
+    void SetAsyncSink(async_log::AsyncLogSink* sink) {
+        std::lock_guard lock(mutex_);
+        async_sink_ = sink;
+    }
+
+private:
+    // фронтенд и так вызывает consume по одному, мьютекс - для SetAsyncSink из другого потока
+    std::mutex mutex_;
+    async_log::AsyncLogSink* async_sink_ = nullptr;
+};
+
+boost::shared_ptr<ConsoleBackend> console_backend;
+
+}  // namespace
+
 void InitLogger() {
-    logging::add_console_log(
-        std::cout,
-        keywords::format = &JsonFormatter,
-        keywords::auto_flush = true
-    );
+    console_backend = boost::make_shared<ConsoleBackend>();
+    auto sink = boost::make_shared<sinks::synchronous_sink<ConsoleBackend>>(console_backend);
+    sink->set_formatter(&JsonFormatter);
+    logging::core::get()->add_sink(sink);
+}
+
+AsyncLogRedirect::AsyncLogRedirect(async_log::AsyncLogSink& sink) {
+    if (console_backend) {
+        console_backend->SetAsyncSink(&sink);
+    }
+}
+
+AsyncLogRedirect::~AsyncLogRedirect() {
+    if (console_backend) {
+        console_backend->SetAsyncSink(nullptr);
+    }
 }
\ No newline at end of file
@@ -1,5 +1,7 @@
 ﻿#pragma once
 #include "request_handler.h"
+#include "http_metrics.h"
+#include "async_log.h"
 
 #include <boost/log/trivial.hpp>     // для BOOST_LOG_TRIVIAL
 #include <boost/log/core.hpp>        // для logging::core
@@ -28,46 +30,77 @@ BOOST_LOG_ATTRIBUTE_KEYWORD(additional_data, "AdditionalData", boost::json::valu
 
 namespace http_handler {
 
+/*
+ * Лог запросов и ответов.
+ * Строки собираются сразу текстом и уходят в AsyncLogSink, обработчик на запись не ждёт.
+ * Запросы сэмплируются по endpoint, но ошибки и медленные ответы пишутся всегда -
+ * в таком случае в ответ добавляем данные запроса, раз сам запрос мог не попасть в лог.
+ * Для несэмплированного запроса ничего не копируем в кучу: вместо URI пишется endpoint,
+ * метод хранится как http::verb, а ip помещается в SSO строки.
+ */
 template<class SomeRequestHandler>
 class LoggingRequestHandler {
 
-    template <typename Body, typename Allocator>
-    static void LogRequest(const http::request<Body, Allocator>& r, std::string_view client_ip) {
-        boost::json::object data;
-        data[IP_S] = std::string(client_ip);
-        data[URI_S] = std::string(r.target());
-        data[METHOD_S] = std::string(r.method_string());
+    struct RequestInfo {
+        std::string ip;
+        std::string_view endpoint;  // из EndpointLabel, строки статические
+        http::verb method;
+    };
 
-        BOOST_LOG_TRIVIAL(info) << logging::add_value(additional_data, boost::json::value(data)) << "request received";
+    template <typename Body, typename Allocator>
+    void LogRequest(const http::request<Body, Allocator>& r, std::string_view client_ip) {
+        sink_.TryWrite(async_log::JsonLine()
+            .Field(IP_S, client_ip)
+            .Field(URI_S, std::string_view(r.target()))
+            .Field(METHOD_S, std::string_view(r.method_string()))
+            .Finish("request received"));
     }
 
-
     template <typename Body, typename Fields>
-    void LogResponse(const http::response<Body, Fields>& r, int time) {
-        boost::json::object data;
-        data[RESPONSE_TIME_S] = time;
-        data[CODE_S] = r.result_int();
+    void LogResponse(const http::response<Body, Fields>& r, std::chrono::microseconds time,
+        const std::optional<RequestInfo>& unlogged_request) {
+        async_log::JsonLine line;
+        line.Field(RESPONSE_TIME_S, static_cast<int64_t>(time.count() / 1000));
+        line.Field(CODE_S, static_cast<int64_t>(r.result_int()));
         if (auto it = r.find(http::field::content_type); it != r.end()) {
-            data[CONTENT_TYPE_S] = std::string(it->value());
+            line.Field(CONTENT_TYPE_S, std::string_view(it->value()));
         }
         else {
-            data[CONTENT_TYPE_S] = NULL_S;
+            line.NullField(CONTENT_TYPE_S);
         }
-        BOOST_LOG_TRIVIAL(info) << logging::add_value(additional_data, boost::json::value(data)) << "response sent";
+        if (unlogged_request) {
+            line.Field(IP_S, unlogged_request->ip)
+                .Field(ENDPOINT_S, unlogged_request->endpoint)
+                .Field(METHOD_S, std::string_view(http::to_string(unlogged_request->method)));
+        }
+        sink_.TryWrite(line.Finish("response sent"));
     }
 
 public:
-    LoggingRequestHandler(SomeRequestHandler& decorated) : decorated_(decorated) {}
+    LoggingRequestHandler(SomeRequestHandler& decorated, async_log::AsyncLogSink& sink, async_log::SamplingConfig sampling)
+        : decorated_(decorated), sink_(sink), sampling_(std::move(sampling)) {}
 
     template <typename Body, typename Allocator, typename Send>
     void operator()(http::request<Body, http::basic_fields<Allocator>>&& req, Send&& send, std::string ip) {
-        LogRequest(req, ip);
+        const std::string_view endpoint = EndpointLabel(req.target());
+        const bool sampled = sampling_.ShouldSample(endpoint);
+
+        std::optional<RequestInfo> unlogged_request;
+        if (sampled) {
+            LogRequest(req, ip);
+        }
+        else {
+            unlogged_request = RequestInfo{ ip, endpoint, req.method() };
+        }
 
         const auto started = std::chrono::steady_clock::now();
-        auto logging_send = [this, started, send = std::forward<Send>(send)](auto&& resp) mutable {
-            auto dur = std::chrono::duration_cast<std::chrono::milliseconds>(
+        auto logging_send = [this, started, sampled, unlogged_request = std::move(unlogged_request)
+            , send = std::forward<Send>(send)](auto&& resp) mutable {
+            auto dur = std::chrono::duration_cast<std::chrono::microseconds>(
                 std::chrono::steady_clock::now() - started);
-            LogResponse(resp, dur.count());
+            if (sampled || sampling_.MustKeep(resp.result_int(), dur)) {
+                LogResponse(resp, dur, unlogged_request);
+            }
             send(std::forward<decltype(resp)>(resp));
             };
 
@@ -76,6 +109,8 @@ public:
 
 private:
     SomeRequestHandler& decorated_;
+    async_log::AsyncLogSink& sink_;
+    async_log::SamplingConfig sampling_;
 };
 
 }
@@ -88,4 +123,18 @@ void LogNetError(int code, std::string_view text, std::string_view where);
 
 void InitLogger();
 
+/*
+ * Пока объект жив, записи Boost.Log (старт, остановка, сетевые ошибки) уходят в AsyncLogSink,
+ * а не прямо в std::cout: иначе сетевые потоки и поток sink'а пишут в один поток без общей блокировки
+ * и строки перемешиваются. Создавать после sink'а, чтобы отключиться до его остановки.
+ */
+class AsyncLogRedirect {
+public:
+    explicit AsyncLogRedirect(async_log::AsyncLogSink& sink);
+    ~AsyncLogRedirect();
+
+    AsyncLogRedirect(const AsyncLogRedirect&) = delete;
+    AsyncLogRedirect& operator=(const AsyncLogRedirect&) = delete;
+};
+
 void JsonFormatter(logging::record_view const& rec, logging::formatting_ostream& strm);
\ No newline at end of file
@@ -7,12 +7,14 @@
 #include "retire_repositoryImpl.h"
 
 #include "json_loader.h"
+#include "map_bundle.h"
 #include "request_handler.h"
 
 #include <boost/log/utility/setup/common_attributes.hpp>
 #include <boost/program_options.hpp>
 
 #include <vector>
+#include <algorithm>
 #include <csignal>
 #include <filesystem>  
 #include "loot_generator.h"
@@ -20,6 +22,12 @@
 #include "logger.h"
 #include "ticker.h"
 #include "infrastructure.h"
+#include "tracing.h"
+#include "http_metrics.h"
+#include "io_context_pool.h"
+#include "command_stream.h"
+
+#include <fstream>
 
 using namespace std::literals;
 using namespace json_loader;
@@ -48,10 +56,38 @@ void RunWorkers(unsigned n, const Fn& fn) {
 struct Args {
     int tick_period_ms = -1;    // чтобы не мудрить с optional, так как парсинг с ней не работает
     std::string config_filepath;
+    std::string map_bundle_path;  // используется, пока не старше config_filepath
     std::string static_files_root;
     bool random_position = false;
     std::string state_file_path;
     int save_state_period = 0;
+    double interest_radius = 0;   // 0 - отдаём состояние всей сессии
+    bool trace = false;
+    int slow_tick_budget_ms = 0;  // 0 - равен периоду тика
+    std::string admin_token;      // пустой - дампы трассировки не отдаются
+    std::vector<std::string> log_sample_rules;
+    double log_sample_default = 1.0;
+    int log_slow_ms = 100;
+    size_t log_queue_size = 65536;
+    unsigned reactors = 0;        // 0 - один общий io_context на все потоки
+    bool pin_threads = false;
+    size_t max_connections = 0;
+    int64_t idle_timeout_sec = 30;
+    int64_t read_timeout_sec = 30;
+    size_t pipeline_depth = 8;    // 1 - следующий запрос читается только после ответа на предыдущий
+    double rate_limit = 0;        // запросов в секунду на токен/IP, 0 - без ограничения
+    double rate_burst = 20;
+    size_t max_strand_queue = 0;  // 0 - без ограничения
+    int64_t session_idle_timeout_sec = 300;  // 0 - пустые сессии не удаляются
+    int compression_level = 6;    // 0 - ответы API не сжимаются
+    size_t compression_min_size = 1024;
+    bool headless = false;
+    bool has_seed = false;        // без --seed генераторы засеваются случайно (кроме --headless)
+    uint64_t seed = 0;
+    std::string record_commands_path;
+    std::string replay_commands_path;
+    size_t headless_players = 100;
+    size_t headless_ticks = 10000;
 };
 
 [[nodiscard]] std::optional<Args> ParseCommandLine(int argc, const char* const argv[]) {
@@ -64,10 +100,37 @@ struct Args {
         ("help,h", "Show help")
         ("tick-period,t", po::value(&args.tick_period_ms)->value_name("time in ms"), "tick period in ms")
         ("config-file,c", po::value(&args.config_filepath)->value_name("filepath"), "config file path")
+        ("map-bundle", po::value(&args.map_bundle_path)->value_name("filepath"), "prebuilt map bundle (tool map_bundle), used while it is not older than config file")
         ("www-root,w", po::value(&args.static_files_root)->value_name("filepath"), "static files path")
         ("randomize-spawn-points", po::bool_switch(&args.random_position), "randomize spawn points")
         ("state-file", po::value(&args.state_file_path)->value_name("file path"), "file with saves")
-        ("save-state-period", po::value(&args.save_state_period)->default_value(0)->value_name("time in ms"), "save period time");
+        ("save-state-period", po::value(&args.save_state_period)->default_value(0)->value_name("time in ms"), "save period time")
+        ("interest-radius", po::value(&args.interest_radius)->default_value(0)->value_name("radius"), "send only objects within radius around player's dog")
+        ("trace", po::bool_switch(&args.trace), "enable tick and API tracing, dump at /api/v1/admin/trace (needs --admin-token)")
+        ("admin-token", po::value(&args.admin_token)->value_name("secret"), "secret for X-Admin-Token header of /api/v1/admin/* dumps")
+        ("slow-tick-budget", po::value(&args.slow_tick_budget_ms)->default_value(0)->value_name("time in ms"), "keep traces of ticks longer than budget")
+        ("log-sample", po::value(&args.log_sample_rules)->composing()->value_name("endpoint=rate"), "share of requests to log for endpoint, e.g. /api/v1/game/state=0.01")
+        ("log-sample-default", po::value(&args.log_sample_default)->default_value(1.0)->value_name("rate"), "share of requests to log for other endpoints")
+        ("log-slow-ms", po::value(&args.log_slow_ms)->default_value(100)->value_name("time in ms"), "always log responses slower than this")
+        ("log-queue-size", po::value(&args.log_queue_size)->default_value(65536)->value_name("lines"), "async log queue size, extra lines are dropped")
+        ("reactors", po::value(&args.reactors)->default_value(0)->value_name("count"), "thread-per-core networking: N io_contexts with own SO_REUSEPORT acceptors")
+        ("pin-threads", po::bool_switch(&args.pin_threads), "pin reactor threads to CPUs")
+        ("max-connections", po::value(&args.max_connections)->default_value(0)->value_name("count"), "max open HTTP connections, 0 - unlimited")
+        ("idle-timeout", po::value(&args.idle_timeout_sec)->default_value(30)->value_name("seconds"), "close keep-alive connection waiting for a request longer than this")
+        ("read-timeout", po::value(&args.read_timeout_sec)->default_value(30)->value_name("seconds"), "close connection that does not finish a request/response exchange in time")
+        ("pipeline-depth", po::value(&args.pipeline_depth)->default_value(8)->value_name("count"), "HTTP/1.1 requests per connection read and handled ahead of their responses")
+        ("rate-limit", po::value(&args.rate_limit)->default_value(0)->value_name("rps"), "API requests per second per player token (or client IP), 0 - unlimited; all tokens of one IP share 8x this")
+        ("rate-burst", po::value(&args.rate_burst)->default_value(20)->value_name("count"), "API requests allowed in a burst above --rate-limit")
+        ("max-strand-queue", po::value(&args.max_strand_queue)->default_value(0)->value_name("count"), "reply 503 when this many API requests wait for the game strand, 0 - unlimited")
+        ("compression-level", po::value(&args.compression_level)->default_value(6)->value_name("0-9"), "gzip/deflate level for API responses, 0 - no compression")
+        ("compression-min-size", po::value(&args.compression_min_size)->default_value(1024)->value_name("bytes"), "compress only API responses at least this large")
+        ("session-idle-timeout", po::value(&args.session_idle_timeout_sec)->default_value(300)->value_name("seconds"), "drop game session that has no players longer than this, 0 - never")
+        ("seed", po::value(&args.seed)->value_name("seed"), "seed random generators of game sessions")
+        ("record-commands", po::value(&args.record_commands_path)->value_name("file path"), "record joins, moves and ticks for --headless replay")
+        ("headless", po::bool_switch(&args.headless), "run the simulation without HTTP as fast as possible and report ticks per second")
+        ("replay-commands", po::value(&args.replay_commands_path)->value_name("file path"), "--headless: replay recorded commands instead of synthetic players")
+        ("players", po::value(&args.headless_players)->default_value(100)->value_name("count"), "--headless: synthetic players")
+        ("ticks", po::value(&args.headless_ticks)->default_value(10000)->value_name("count"), "--headless: synthetic ticks");
 
     po::variables_map vm;
     po::store(po::parse_command_line(argc, argv, desc), vm);    
@@ -79,7 +142,7 @@ struct Args {
     if (!vm.contains("config-file")) {
         throw std::runtime_error("Config files have not been specified");
     }
-    if (!vm.contains("www-root")) {
+    if (!vm.contains("www-root") && !vm["headless"].as<bool>()) {
         throw std::runtime_error("Static files root has not been specified");
     }
     
@@ -88,9 +151,84 @@ struct Args {
     }
 
     po::notify(vm);
+    args.has_seed = vm.contains("seed");
     return args;
 }
 
+namespace {
+
+// в headless-режиме базы нет, ушедшие на покой просто забываются
+class DiscardingRepository final : public RetiredPlayersRepository {
+public:
+    void EnsureSchema() override {
+    }
+
+    void Add(const RetiredRecord&) override {
+    }
+
+    std::vector<RetiredRecord> Get(int, int) override {
+        return {};
+    }
+};
+
+// Карты из бандла, если он свежее конфига, иначе из JSON. Битый бандл не мешает старту
+LoadedData LoadGameData(const Args& args) {
+    if (!args.map_bundle_path.empty()) {
+        if (map_bundle::IsBundleFresh(args.map_bundle_path, args.config_filepath)) {
+            try {
+                return map_bundle::LoadBundle(args.map_bundle_path);
+            }
+            catch (const std::exception& ex) {
+                std::cerr << "Map bundle ignored: "sv << ex.what() << std::endl;
+            }
+        }
+        else {
+            std::cerr << "Map bundle is missing or older than config, loading JSON"sv << std::endl;
+        }
+    }
+    return json_loader::LoadGame(args.config_filepath);
+}
+
+// Прогоняет игру без сети: записанные команды или синтетических игроков, тики подряд без ожидания
+void RunHeadless(const Args& args) {
+    LoadedData loaded_data = LoadGameData(args);
+    loot_gen::LootGenerator loot_gen(loaded_data.gen_config.period, loaded_data.gen_config.probability);
+    DiscardingRepository repo;
+    app::GameSessionManager manager(loaded_data.game, loaded_data.loot_type_by_map_id,
+        loot_gen, args.random_position, loaded_data.dog_retirement_time_sec, repo);
+    manager.SetInterestRadius(args.interest_radius);
+    manager.SetSessionIdleTimeout(std::chrono::seconds(args.session_idle_timeout_sec));
+    manager.SetRandomSeed(args.seed);
+
+    std::vector<app::Command> commands;
+    if (!args.replay_commands_path.empty()) {
+        std::ifstream in(args.replay_commands_path);
+        if (!in) {
+            throw std::runtime_error("Failed to open "s + args.replay_commands_path);
+        }
+        commands = app::ReadCommands(in);
+    }
+    else {
+        const int64_t tick_ms = args.tick_period_ms > 0 ? args.tick_period_ms : 50;
+        commands = app::MakeSyntheticCommands(loaded_data.game, args.headless_players, args.headless_ticks,
+            tick_ms, args.seed);
+    }
+
+    const auto start = std::chrono::steady_clock::now();
+    const app::ReplayStats stats = app::ReplayCommands(manager, commands);
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    const auto tick_us = metrics::Registry::Instance().GetHistogram("game_tick_duration_us",
+        "Game tick processing time, microseconds").TakeSnapshot();
+    std::cout << "ticks: " << stats.ticks << ", joins: " << stats.joins
+        << ", moves: " << stats.moves << " (skipped " << stats.skipped_moves << ")" << std::endl
+        << "elapsed: " << elapsed.count() << " s, " << static_cast<double>(stats.ticks) / elapsed.count() << " ticks/s" << std::endl
+        << "tick us: p50 " << tick_us.ValueAtQuantile(0.5) << ", p99 " << tick_us.ValueAtQuantile(0.99)
+        << ", max " << tick_us.ValueAtQuantile(1.0) << std::endl;
+}
+
+}  // namespace
+
 int main(int argc, const char* argv[]) {
     boost::log::add_common_attributes();
     InitLogger();
@@ -107,7 +245,7 @@ int main(int argc, const char* argv[]) {
             if (!std::filesystem::exists(args->config_filepath)) {
                 throw std::runtime_error{ "Failed to open "s + args->config_filepath };
             }
-            if (!std::filesystem::is_directory(args->static_files_root)) {
+            if (!args->headless && !std::filesystem::is_directory(args->static_files_root)) {
                 throw std::runtime_error{ "Failed to open "s + args->static_files_root };
             }
         } else {
@@ -122,17 +260,36 @@ int main(int argc, const char* argv[]) {
     }
 
     
+    if (args->headless) {
+        try {
+            RunHeadless(*args);
+        }
+        catch (const std::exception& ex) {
+            std::cerr << ex.what() << std::endl;
+            LogStop(EXIT_FAILURE, ex);
+            return EXIT_FAILURE;
+        }
+        LogStop(EXIT_SUCCESS);
+        return EXIT_SUCCESS;
+    }
+
     try {
         
         // 1. Загружаем карту из файла и построить модель игры, а так же извлечём и проверим путь к static
-        LoadedData loaded_data = json_loader::LoadGame(args->config_filepath);     
+        LoadedData loaded_data = LoadGameData(*args);
         loot_gen::LootGenerator loot_gen(loaded_data.gen_config.period, loaded_data.gen_config.probability);        
               
         std::filesystem::path root(args->static_files_root);
 
         // 2. Инициализируем io_context
-        const unsigned num_threads = std::max(1u, std::thread::hardware_concurrency());
+        // В режиме reactors ioc обслуживает только игру (api_strand, тикер) одним потоком,
+        // а соединения живут в отдельных однопоточных io_context по числу reactors
+        const unsigned num_threads = args->reactors > 0 ? 1u : std::max(1u, std::thread::hardware_concurrency());
         net::io_context ioc(num_threads);
+        std::optional<http_server::IoContextPool> reactors;
+        if (args->reactors > 0) {
+            reactors.emplace(args->reactors);
+        }
 
         // база данных
 
@@ -147,9 +304,12 @@ int main(int argc, const char* argv[]) {
 
         // 3. Добавляем асинхронный обработчик сигналов SIGINT и SIGTERM
         net::signal_set signals(ioc, SIGINT, SIGTERM);
-        signals.async_wait([&ioc](const sys::error_code& ec, [[maybe_unused]] int signal_number) {
+        signals.async_wait([&ioc, &reactors](const sys::error_code& ec, [[maybe_unused]] int signal_number) {
             if (!ec) {
                 ioc.stop();
+                if (reactors) {
+                    reactors->Stop();
+                }
             }
             });
         
@@ -157,11 +317,51 @@ int main(int argc, const char* argv[]) {
         infrastructure::SerializingListener listener(args->save_state_period, args->state_file_path);
         app::GameSessionManager manager(loaded_data.game, loaded_data.loot_type_by_map_id,
             loot_gen, args->random_position, loaded_data.dog_retirement_time_sec, repo);
+        manager.SetInterestRadius(args->interest_radius);
+        manager.SetSessionIdleTimeout(std::chrono::seconds(args->session_idle_timeout_sec));
+        if (args->has_seed) {
+            manager.SetRandomSeed(args->seed);
+        }
+        std::ofstream record_file;
+        std::optional<app::CommandRecorder> recorder;
+        if (!args->record_commands_path.empty()) {
+            record_file.open(args->record_commands_path);
+            if (!record_file) {
+                throw std::runtime_error("Failed to open "s + args->record_commands_path);
+            }
+            recorder.emplace(record_file);
+            manager.SetRecorder(&*recorder);
+        }
+
+        if (args->trace) {
+            auto& tracer = tracing::Tracer::Instance();
+            const int budget_ms = args->slow_tick_budget_ms > 0 ? args->slow_tick_budget_ms : args->tick_period_ms;
+            tracer.SetSlowTickBudget(std::chrono::milliseconds(std::max(budget_ms, 0)), /*max_ticks=*/16);
+            tracer.SetEnabled(true);
+        }
         listener.SetManager(&manager);
         manager.SetListener(&listener);
         listener.TryLoadFromFile();
         auto handler = std::make_shared<http_handler::RequestHandler>(loaded_data.game, root, api_strand, manager, args->tick_period_ms);
-        http_handler::LoggingRequestHandler<http_handler::RequestHandler> log_handler(*handler);        
+        handler->SetRateLimit(args->rate_limit, args->rate_burst);
+        handler->SetMaxStrandQueue(args->max_strand_queue);
+        handler->SetCompression(http_server::CompressionSettings{
+            .level = std::clamp(args->compression_level, 0, 9),
+            .min_size = args->compression_min_size });
+        handler->SetMapResponses(std::move(loaded_data.map_responses));
+        // лог запросов пишет отдельный поток, при переполнении очереди строки теряются (видно в /metrics)
+        async_log::AsyncLogSink log_sink(std::cout, args->log_queue_size);
+        // остальной лог на время работы sink'а идёт через него же, чтобы строки в std::cout не перемешивались
+        AsyncLogRedirect log_redirect(log_sink);
+        // колбэки /metrics захватывают sink и тикер, а реестр статический - снимаем их раньше, чем умрут
+        // захваченные объекты и ioc (объявлены после них, значит и разрушатся раньше)
+        std::vector<metrics::CallbackRegistration> metric_callbacks;
+        metric_callbacks.push_back(metrics::Registry::Instance().AddCallbackCounter("log_lines_dropped_total",
+            "Log lines dropped on queue overflow",
+            [&log_sink] { return static_cast<double>(log_sink.GetDropped()); }));
+        http_handler::LoggingRequestHandler<http_handler::RequestHandler> log_handler(*handler, log_sink,
+            async_log::SamplingConfig::Parse(args->log_sample_rules, args->log_sample_default,
+                std::chrono::milliseconds(args->log_slow_ms)));        
 
         if (args->tick_period_ms > 0) {
             auto ticker = std::make_shared<Ticker>(
@@ -170,22 +370,71 @@ int main(int argc, const char* argv[]) {
                 // что делать на каждый тик:
                 [&manager](std::chrono::milliseconds delta) {
                     manager.ProcessTick(delta.count());
+                },
+                // тикер продолжит работу, но ошибку видно в логе
+                [](std::exception_ptr error) {
+                    try {
+                        std::rethrow_exception(error);
+                    }
+                    catch (const std::exception& ex) {
+                        LogNetError(0, ex.what(), "tick");
+                    }
+                    catch (...) {
+                        LogNetError(0, "unknown exception", "tick");
+                    }
                 });
             ticker->Start();
+
+            // счётчики тикера атомарные, читать их при выгрузке можно из любого потока
+            auto& registry = metrics::Registry::Instance();
+            metric_callbacks.push_back(registry.AddCallbackCounter("ticker_overruns_total", "Ticks longer than the tick period",
+                [ticker] { return static_cast<double>(ticker->GetStats().overruns.load()); }));
+            metric_callbacks.push_back(registry.AddCallbackCounter("ticker_skipped_ticks_total", "Ticks dropped because the ticker fell behind",
+                [ticker] { return static_cast<double>(ticker->GetStats().skipped_ticks.load()); }));
+            metric_callbacks.push_back(registry.AddCallbackGauge("ticker_lag_us", "Last timer wake-up lag behind the deadline, microseconds",
+                [ticker] { return static_cast<double>(ticker->GetStats().last_lag_us.load()); }));
         }
 
         // 5. Запустить обработчик HTTP-запросов, делегируя их обработчику запросов
         
-        http_server::ServeHttp(ioc, { address, port }, [&log_handler](auto&& req, auto&& send, auto&& client_ip) {
-            log_handler(std::forward<decltype(req)>(req),
+        // /metrics отвечает сам декоратор, мимо логов и api_strand
+        http_handler::MetricsRequestHandler<decltype(log_handler)> metrics_handler(log_handler);
+        metrics_handler.SetAdminToken(args->admin_token);
+        auto serve = [&metrics_handler](auto&& req, auto&& send, auto&& client_ip) {
+            metrics_handler(std::forward<decltype(req)>(req),
                 std::forward<decltype(send)>(send),
                 std::forward<decltype(client_ip)>(client_ip));
-            });
+            };
+
+        http_server::ConnectionLimits limits;
+        limits.max_connections = args->max_connections;
+        limits.idle_timeout = std::chrono::seconds(args->idle_timeout_sec);
+        limits.read_timeout = std::chrono::seconds(args->read_timeout_sec);
+        limits.pipeline_depth = std::max<size_t>(args->pipeline_depth, 1);
+
+        if (reactors) {
+            // у каждого reactor'а свой Listener, ядро раздаёт соединения примерно поровну
+            if (limits.max_connections) {
+                limits.max_connections = (limits.max_connections + reactors->Size() - 1) / reactors->Size();
+            }
+            for (size_t i = 0; i < reactors->Size(); ++i) {
+                http_server::ServeHttp(reactors->Get(i), { address, port }, serve, limits, /*reuse_port=*/true);
+            }
+            // ядро 0 оставляем потоку игры
+            reactors->Start(args->pin_threads, /*first_cpu=*/1);
+        }
+        else {
+            http_server::ServeHttp(ioc, { address, port }, serve, limits);
+        }
 
         // 6. Запускаем обработку асинхронных операций
         RunWorkers(std::max(1u, num_threads), [&ioc] {
             ioc.run();
         });
+        if (reactors) {
+            reactors->Stop();
+            reactors->Join();
+        }
         // вся асинхронщина завершена, можно сохраняться
         listener.TrySaveToFile();
     } catch (const std::exception& ex) {
@@ -0,0 +1,372 @@
+#include "map_bundle.h"
+
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <span>
+#include <stdexcept>
+#include <string_view>
+#include <type_traits>
+
+namespace map_bundle {
+
+namespace fs = std::filesystem;
+namespace ipc = boost::interprocess;
+using namespace std::literals;
+
+namespace {
+
+constexpr std::array<char, 8> MAGIC = { 'M', 'A', 'P', 'B', 'N', 'D', 'L', '\0' };
+// читатель с другим порядком байт увидит 0x04030201
+constexpr uint32_t BYTE_ORDER_MARK = 0x01020304;
+// растёт при любом изменении формата, старый бандл тогда просто пересобирается
+constexpr uint32_t VERSION = 1;
+
+struct Header {
+    std::array<char, 8> magic;
+    uint32_t byte_order;
+    uint32_t version;
+    uint64_t payload_size;
+    uint64_t checksum;
+};
+
+// FNV-1a 64: ловит обрезанный или испорченный файл, от подделки не защищает
+uint64_t Checksum(std::string_view data) {
+    uint64_t hash = 14695981039346656037ull;
+    for (const char c : data) {
+        hash ^= static_cast<unsigned char>(c);
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+class Writer {
+public:
+    template <typename T>
+    void Put(const T& value) {
+        static_assert(std::is_trivially_copyable_v<T>);
+        out_.append(reinterpret_cast<const char*>(&value), sizeof(T));
+    }
+
+    template <typename T>
+    void PutArray(std::span<const T> values) {
+        static_assert(std::is_trivially_copyable_v<T>);
+        PutSize(values.size());
+        out_.append(reinterpret_cast<const char*>(values.data()), values.size_bytes());
+    }
+
+    void PutString(std::string_view text) {
+        PutSize(text.size());
+        out_.append(text);
+    }
+
+    std::string& Data() {
+        return out_;
+    }
+
+private:
+    void PutSize(size_t size) {
+        if (size > std::numeric_limits<uint32_t>::max()) {
+            throw std::invalid_argument("Map bundle section is too large");
+        }
+        Put(static_cast<uint32_t>(size));
+    }
+
+    std::string out_;
+};
+
+// читает прямо из отображённой памяти; выход за границу - битый бандл
+class Reader {
+public:
+    explicit Reader(std::string_view data)
+        : data_(data) {
+    }
+
+    template <typename T>
+    T Get() {
+        static_assert(std::is_trivially_copyable_v<T>);
+        T value;
+        std::memcpy(&value, Take(sizeof(T)).data(), sizeof(T));
+        return value;
+    }
+
+    template <typename T>
+    std::vector<T> GetArray() {
+        static_assert(std::is_trivially_copyable_v<T>);
+        const size_t size = Get<uint32_t>();
+        // размер проверяется до выделения памяти
+        const std::string_view bytes = Take(size * sizeof(T));
+        std::vector<T> values(size);
+        std::memcpy(values.data(), bytes.data(), bytes.size());
+        return values;
+    }
+
+    std::string_view GetString() {
+        return Take(Get<uint32_t>());
+    }
+
+    bool AtEnd() const {
+        return pos_ == data_.size();
+    }
+
+private:
+    std::string_view Take(size_t size) {
+        if (size > data_.size() - pos_) {
+            throw std::runtime_error("Map bundle is truncated");
+        }
+        const std::string_view bytes = data_.substr(pos_, size);
+        pos_ += size;
+        return bytes;
+    }
+
+    std::string_view data_;
+    size_t pos_ = 0;
+};
+
+// в бандле дорога - четыре координаты; горизонтальная, если y совпадают (как Road::IsHorizontal)
+struct RawRoad {
+    model::Coord x0, y0, x1, y1;
+};
+
+struct RawOffice {
+    model::Coord x, y;
+    model::Dimension dx, dy;
+};
+
+bool IsOnRoad(const model::RoadIndex& index, model::Point point) {
+    auto contains = [](std::span<const model::RoadInterval> intervals, double value) {
+        return std::any_of(intervals.begin(), intervals.end(), [value](const model::RoadInterval& interval) {
+            return interval.a <= value && value <= interval.b;
+            });
+    };
+    return contains(index.GetHorizontal(point.y), point.x) || contains(index.GetVertical(point.x), point.y);
+}
+
+void PutLines(Writer& writer, const model::RoadIndex::Lines& lines) {
+    writer.PutArray(std::span<const model::Coord>(lines.keys));
+    writer.PutArray(std::span<const uint32_t>(lines.offsets));
+    writer.PutArray(std::span<const model::RoadInterval>(lines.intervals));
+}
+
+model::RoadIndex::Lines GetLines(Reader& reader) {
+    model::RoadIndex::Lines lines;
+    lines.keys = reader.GetArray<model::Coord>();
+    lines.offsets = reader.GetArray<uint32_t>();
+    lines.intervals = reader.GetArray<model::RoadInterval>();
+    return lines;
+}
+
+void PutMap(Writer& writer, const model::Map& map, const json_loader::LoadedData& data) {
+    writer.PutString(*map.GetId());
+    writer.PutString(map.GetName());
+    writer.Put(map.GetDogSpeed());
+    writer.Put(static_cast<int32_t>(map.GetBagCapacity()));
+
+    std::vector<RawRoad> roads;
+    roads.reserve(map.GetRoads().size());
+    for (const model::Road& road : map.GetRoads()) {
+        roads.push_back({ road.GetStart().x, road.GetStart().y, road.GetEnd().x, road.GetEnd().y });
+    }
+    writer.PutArray(std::span<const RawRoad>(roads));
+
+    std::vector<model::Rectangle> buildings;
+    buildings.reserve(map.GetBuildings().size());
+    for (const model::Building& building : map.GetBuildings()) {
+        buildings.push_back(building.GetBounds());
+    }
+    writer.PutArray(std::span<const model::Rectangle>(buildings));
+
+    // id офисов - строки, поэтому офисы пишутся по одному
+    writer.Put(static_cast<uint32_t>(map.GetOffices().size()));
+    for (const model::Office& office : map.GetOffices()) {
+        writer.PutString(*office.GetId());
+        writer.Put(RawOffice{ office.GetPosition().x, office.GetPosition().y,
+            office.GetOffset().dx, office.GetOffset().dy });
+    }
+
+    // типы лута - короткие объекты для клиента, остаются JSON-текстом
+    const auto& loot_types = data.loot_type_by_map_id.at(map.GetId());
+    writer.Put(static_cast<uint32_t>(loot_types.size()));
+    for (const extra_data::LootType& loot_type : loot_types) {
+        writer.PutString(boost::json::serialize(loot_type.GetAsJsonObject()));
+    }
+
+    const auto road_index = map.GetRoadIndex();
+    PutLines(writer, road_index->GetHorizontalLines());
+    PutLines(writer, road_index->GetVerticalLines());
+
+    const auto response = data.map_responses.find(map.GetId());
+    writer.PutString(response != data.map_responses.end() ? std::string_view(response->second) : std::string_view{});
+}
+
+void GetMap(Reader& reader, json_loader::LoadedData& data) {
+    // порядок вычисления аргументов не задан, поэтому id и имя читаются отдельно
+    model::Map::Id id(std::string(reader.GetString()));
+    model::Map map(std::move(id), std::string(reader.GetString()));
+    map.SetDogSpeed(reader.Get<double>());
+    map.SetBagCapacity(reader.Get<int32_t>());
+
+    for (const RawRoad& road : reader.GetArray<RawRoad>()) {
+        if (road.y0 == road.y1) {
+            map.AddRoad(model::Road(model::Road::HORIZONTAL, model::Point{ road.x0, road.y0 }, road.x1));
+        }
+        else {
+            map.AddRoad(model::Road(model::Road::VERTICAL, model::Point{ road.x0, road.y0 }, road.y1));
+        }
+    }
+    for (const model::Rectangle& bounds : reader.GetArray<model::Rectangle>()) {
+        map.AddBuilding(model::Building(bounds));
+    }
+
+    const uint32_t office_count = reader.Get<uint32_t>();
+    for (uint32_t i = 0; i < office_count; ++i) {
+        model::Office::Id id(std::string(reader.GetString()));
+        const auto office = reader.Get<RawOffice>();
+        map.AddOffice(model::Office(std::move(id), model::Point{ office.x, office.y },
+            model::Offset{ office.dx, office.dy }));
+    }
+
+    auto& loot_types = data.loot_type_by_map_id[map.GetId()];
+    const uint32_t loot_type_count = reader.Get<uint32_t>();
+    loot_types.reserve(loot_type_count);
+    for (uint32_t i = 0; i < loot_type_count; ++i) {
+        loot_types.emplace_back(boost::json::parse(reader.GetString()).as_object());
+    }
+
+    auto horizontal = GetLines(reader);
+    auto vertical = GetLines(reader);
+    map.SetRoadIndex(std::make_shared<const model::RoadIndex>(std::move(horizontal), std::move(vertical)));
+
+    if (const std::string_view response = reader.GetString(); !response.empty()) {
+        data.map_responses.emplace(map.GetId(), std::string(response));
+    }
+    data.game.AddMap(std::move(map));
+}
+
+}  // namespace
+
+void ValidateGame(const json_loader::LoadedData& data) {
+    if (data.game.GetMaps().empty()) {
+        throw std::invalid_argument("No maps");
+    }
+    if (data.gen_config.period.count() <= 0 || data.gen_config.probability < 0 || data.gen_config.probability > 1) {
+        throw std::invalid_argument("Bad loot generator config");
+    }
+    if (data.dog_retirement_time_sec <= 0) {
+        throw std::invalid_argument("Bad dog retirement time");
+    }
+
+    for (const model::Map& map : data.game.GetMaps()) {
+        auto fail = [&map](std::string_view what) {
+            throw std::invalid_argument("Map "s + *map.GetId() + ": "s + std::string(what));
+        };
+        if (map.GetRoads().empty()) {
+            fail("no roads");
+        }
+        if (map.GetDogSpeed() <= 0) {
+            fail("dog speed must be positive");
+        }
+        if (map.GetBagCapacity() <= 0) {
+            fail("bag capacity must be positive");
+        }
+        // без типов лута генератору нечего раскладывать
+        if (auto it = data.loot_type_by_map_id.find(map.GetId()); it == data.loot_type_by_map_id.end() || it->second.empty()) {
+            fail("no loot types");
+        }
+        for (const model::Building& building : map.GetBuildings()) {
+            if (building.GetBounds().size.width <= 0 || building.GetBounds().size.height <= 0) {
+                fail("empty building");
+            }
+        }
+        const auto road_index = map.GetRoadIndex();
+        for (const model::Office& office : map.GetOffices()) {
+            if (!IsOnRoad(*road_index, office.GetPosition())) {
+                fail("office "s + *office.GetId() + " is off the roads"s);
+            }
+        }
+    }
+}
+
+void WriteBundle(const json_loader::LoadedData& data, const fs::path& path) {
+    ValidateGame(data);
+
+    Writer writer;
+    writer.Put(static_cast<int64_t>(data.gen_config.period.count()));
+    writer.Put(data.gen_config.probability);
+    writer.Put(data.dog_retirement_time_sec);
+    writer.Put(static_cast<uint32_t>(data.game.GetMaps().size()));
+    for (const model::Map& map : data.game.GetMaps()) {
+        PutMap(writer, map, data);
+    }
+
+    const std::string& payload = writer.Data();
+    const Header header{ MAGIC, BYTE_ORDER_MARK, VERSION, payload.size(), Checksum(payload) };
+
+    // сервер, читающий бандл прямо сейчас, не должен увидеть файл наполовину
+    fs::path tmp_path = path;
+    tmp_path += ".tmp";
+    {
+        std::ofstream out(tmp_path, std::ios::binary | std::ios::trunc);
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        out.write(payload.data(), static_cast<std::streamsize>(payload.size()));
+        if (!out.flush()) {
+            throw std::runtime_error("Failed to write "s + tmp_path.string());
+        }
+    }
+    fs::rename(tmp_path, path);
+}
+
+json_loader::LoadedData LoadBundle(const fs::path& path) {
+    if (!fs::is_regular_file(path) || fs::file_size(path) < sizeof(Header)) {
+        throw std::runtime_error("Not a map bundle: "s + path.string());
+    }
+
+    const ipc::file_mapping file(path.c_str(), ipc::read_only);
+    const ipc::mapped_region region(file, ipc::read_only);
+    const std::string_view bytes(static_cast<const char*>(region.get_address()), region.get_size());
+
+    Header header;
+    std::memcpy(&header, bytes.data(), sizeof(header));
+    if (header.magic != MAGIC || header.byte_order != BYTE_ORDER_MARK) {
+        throw std::runtime_error("Not a map bundle: "s + path.string());
+    }
+    if (header.version != VERSION) {
+        throw std::runtime_error("Map bundle version "s + std::to_string(header.version)
+            + ", expected "s + std::to_string(VERSION));
+    }
+    const std::string_view payload = bytes.substr(sizeof(Header));
+    if (header.payload_size != payload.size() || header.checksum != Checksum(payload)) {
+        throw std::runtime_error("Map bundle is corrupted: "s + path.string());
+    }
+
+    Reader reader(payload);
+    json_loader::LoadedData data;
+    data.gen_config.period = loot_gen::LootGenerator::TimeInterval(reader.Get<int64_t>());
+    data.gen_config.probability = reader.Get<double>();
+    data.dog_retirement_time_sec = reader.Get<double>();
+    const uint32_t map_count = reader.Get<uint32_t>();
+    for (uint32_t i = 0; i < map_count; ++i) {
+        GetMap(reader, data);
+    }
+    if (!reader.AtEnd()) {
+        throw std::runtime_error("Map bundle has trailing data: "s + path.string());
+    }
+    return data;
+}
+
+bool IsBundleFresh(const fs::path& bundle_path, const fs::path& config_path) {
+    std::error_code ec;
+    const auto bundle_time = fs::last_write_time(bundle_path, ec);
+    if (ec) {
+        return false;
+    }
+    const auto config_time = fs::last_write_time(config_path, ec);
+    return !ec && bundle_time >= config_time;
+}
+
+}  // namespace map_bundle
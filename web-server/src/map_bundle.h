@@ -0,0 +1,32 @@
+#pragma once
+
+#include "json_loader.h"
+
+#include <filesystem>
+
+namespace map_bundle {
+
+/*
+ * Бандл карт - config.json, разобранный и проверенный заранее (утилита map_bundle).
+ * Внутри всё, что LoadGame достаёт из JSON, плюс построенные индексы дорог и готовые
+ * тела ответов GET /api/v1/maps/{id}. Файл читается через mmap, без разбора JSON на старте.
+ *
+ * Формат (порядок байт и выравнивание - как у машины, собравшей бандл):
+ *   заголовок: magic, маркер порядка байт, версия, размер и FNV-1a 64 полезной нагрузки;
+ *   нагрузка: настройки генератора лута и времени отдыха, затем карты подряд -
+ *   строки как длина u32 + байты, массивы как длина u32 + элементы.
+ */
+
+// бросает std::invalid_argument с id карты, если на карте нельзя играть
+void ValidateGame(const json_loader::LoadedData& data);
+
+// проверяет данные и пишет бандл атомарно (через временный файл рядом)
+void WriteBundle(const json_loader::LoadedData& data, const std::filesystem::path& path);
+
+// битый, обрезанный или чужой версии бандл - std::runtime_error
+json_loader::LoadedData LoadBundle(const std::filesystem::path& path);
+
+// бандл есть и записан не раньше конфига
+bool IsBundleFresh(const std::filesystem::path& bundle_path, const std::filesystem::path& config_path);
+
+}  // namespace map_bundle
@@ -0,0 +1,267 @@
+#include "metrics.h"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <sstream>
+#include <stdexcept>
+
+namespace metrics {
+
+size_t ThisThreadShard() {
+    static std::atomic<size_t> next_shard{ 0 };
+    thread_local const size_t shard = next_shard.fetch_add(1, std::memory_order_relaxed) % SHARDS;
+    return shard;
+}
+
+uint64_t Counter::Value() const {
+    uint64_t total = 0;
+    for (const Shard& shard : shards_) {
+        total += shard.value.load(std::memory_order_relaxed);
+    }
+    return total;
+}
+
+// ------------------------- Histogram --------------------------------
+
+size_t Histogram::BucketIndex(uint64_t value) {
+    if (value < SUB_BUCKETS) {
+        return static_cast<size_t>(value);
+    }
+    const int exponent = std::bit_width(value) - 1;   // старший бит, не меньше SUB_BUCKET_BITS
+    const uint64_t sub = (value >> (exponent - SUB_BUCKET_BITS)) & (SUB_BUCKETS - 1);
+    return static_cast<size_t>((exponent - SUB_BUCKET_BITS + 1) * SUB_BUCKETS + sub);
+}
+
+uint64_t Histogram::BucketUpperBound(size_t index) {
+    if (index < SUB_BUCKETS) {
+        return index;
+    }
+    const int exponent = static_cast<int>(index / SUB_BUCKETS) + SUB_BUCKET_BITS - 1;
+    const uint64_t sub = index % SUB_BUCKETS;
+    const int shift = exponent - SUB_BUCKET_BITS;
+    const uint64_t lower = (SUB_BUCKETS + sub) << shift;
+    return lower + ((uint64_t{ 1 } << shift) - 1);
+}
+
+Histogram::Snapshot Histogram::TakeSnapshot() const {
+    Snapshot snapshot;
+    snapshot.counts.assign(BUCKETS, 0);
+    for (const Shard& shard : shards_) {
+        for (size_t i = 0; i < BUCKETS; ++i) {
+            snapshot.counts[i] += shard.counts[i].load(std::memory_order_relaxed);
+        }
+        snapshot.sum += shard.sum.load(std::memory_order_relaxed);
+    }
+    for (uint64_t count : snapshot.counts) {
+        snapshot.count += count;
+    }
+    return snapshot;
+}
+
+uint64_t Histogram::Snapshot::ValueAtQuantile(double q) const {
+    if (count == 0) {
+        return 0;
+    }
+    q = std::clamp(q, 0.0, 1.0);
+    // номер элемента (с единицы), который нужно найти
+    const uint64_t rank = std::max<uint64_t>(1, static_cast<uint64_t>(std::ceil(q * static_cast<double>(count))));
+    uint64_t seen = 0;
+    for (size_t i = 0; i < counts.size(); ++i) {
+        seen += counts[i];
+        if (seen >= rank) {
+            return BucketUpperBound(i);
+        }
+    }
+    return BucketUpperBound(counts.size() - 1);
+}
+
+// ------------------------- Registry --------------------------------
+
+std::string Label(std::string_view name, std::string_view value) {
+    std::string result(name);
+    result += "=\"";
+    for (char c : value) {
+        switch (c) {
+        case '\\': result += "\\\\"; break;
+        case '"': result += "\\\""; break;
+        case '\n': result += "\\n"; break;
+        default: result += c;
+        }
+    }
+    result += '"';
+    return result;
+}
+
+Registry& Registry::Instance() {
+    static Registry registry;
+    return registry;
+}
+
+Registry::Family& Registry::GetFamily(std::string_view name, std::string_view help, Type type) {
+    auto it = families_.find(name);
+    if (it == families_.end()) {
+        it = families_.emplace(std::string(name), Family{ .help = std::string(help), .type = type }).first;
+    }
+    else if (it->second.type != type) {
+        throw std::logic_error("metric " + std::string(name) + " registered with another type");
+    }
+    return it->second;
+}
+
+Counter& Registry::GetCounter(std::string_view name, std::string_view help, const std::string& labels) {
+    std::lock_guard lock(mutex_);
+    auto& slot = GetFamily(name, help, Type::COUNTER).counters[labels];
+    if (!slot) {
+        slot = std::make_unique<Counter>();
+    }
+    return *slot;
+}
+
+Gauge& Registry::GetGauge(std::string_view name, std::string_view help, const std::string& labels) {
+    std::lock_guard lock(mutex_);
+    auto& slot = GetFamily(name, help, Type::GAUGE).gauges[labels];
+    if (!slot) {
+        slot = std::make_unique<Gauge>();
+    }
+    return *slot;
+}
+
+Histogram& Registry::GetHistogram(std::string_view name, std::string_view help, const std::string& labels) {
+    std::lock_guard lock(mutex_);
+    auto& slot = GetFamily(name, help, Type::HISTOGRAM).histograms[labels];
+    if (!slot) {
+        slot = std::make_unique<Histogram>();
+    }
+    return *slot;
+}
+
+CallbackRegistration Registry::AddCallback(std::string_view name, std::string_view help, Type type,
+    std::function<double()> callback, const std::string& labels) {
+    std::lock_guard lock(mutex_);
+    GetFamily(name, help, type).callbacks[labels] = std::move(callback);
+    return CallbackRegistration(std::string(name), labels);
+}
+
+CallbackRegistration Registry::AddCallbackGauge(std::string_view name, std::string_view help,
+    std::function<double()> callback, const std::string& labels) {
+    return AddCallback(name, help, Type::GAUGE, std::move(callback), labels);
+}
+
+CallbackRegistration Registry::AddCallbackCounter(std::string_view name, std::string_view help,
+    std::function<double()> callback, const std::string& labels) {
+    return AddCallback(name, help, Type::COUNTER, std::move(callback), labels);
+}
+
+void Registry::RemoveCallback(std::string_view name, const std::string& labels) {
+    // колбэк вызывается при выгрузке под этим же мьютексом, так что после выхода он точно не работает
+    std::lock_guard lock(mutex_);
+    if (auto it = families_.find(name); it != families_.end()) {
+        it->second.callbacks.erase(labels);
+    }
+}
+
+CallbackRegistration& CallbackRegistration::operator=(CallbackRegistration&& other) noexcept {
+    if (this != &other) {
+        Reset();
+        name_ = std::move(other.name_);
+        labels_ = std::move(other.labels_);
+        active_ = std::exchange(other.active_, false);
+    }
+    return *this;
+}
+
+CallbackRegistration::~CallbackRegistration() {
+    Reset();
+}
+
+void CallbackRegistration::Reset() {
+    if (active_) {
+        active_ = false;
+        Registry::Instance().RemoveCallback(name_, labels_);
+    }
+}
+
+static void WriteSample(std::ostream& out, std::string_view name, std::string_view suffix,
+    const std::string& labels, const std::string& extra_label) {
+    out << name << suffix;
+    if (!labels.empty() || !extra_label.empty()) {
+        out << '{' << labels;
+        if (!labels.empty() && !extra_label.empty()) {
+            out << ',';
+        }
+        out << extra_label << '}';
+    }
+    out << ' ';
+}
+
+std::string Registry::RenderPrometheus() const {
+    std::ostringstream out;
+    std::lock_guard lock(mutex_);
+
+    for (const auto& [name, family] : families_) {
+        out << "# HELP " << name << ' ' << family.help << '\n';
+        switch (family.type) {
+        case Type::COUNTER:
+            out << "# TYPE " << name << " counter\n";
+            for (const auto& [labels, counter] : family.counters) {
+                WriteSample(out, name, "", labels, "");
+                out << counter->Value() << '\n';
+            }
+            for (const auto& [labels, callback] : family.callbacks) {
+                WriteSample(out, name, "", labels, "");
+                out << callback() << '\n';
+            }
+            break;
+
+        case Type::GAUGE:
+            out << "# TYPE " << name << " gauge\n";
+            for (const auto& [labels, gauge] : family.gauges) {
+                WriteSample(out, name, "", labels, "");
+                out << gauge->Value() << '\n';
+            }
+            for (const auto& [labels, callback] : family.callbacks) {
+                WriteSample(out, name, "", labels, "");
+                out << callback() << '\n';
+            }
+            break;
+
+        case Type::HISTOGRAM:
+            out << "# TYPE " << name << " histogram\n";
+            for (const auto& [labels, histogram] : family.histograms) {
+                const Histogram::Snapshot snapshot = histogram->TakeSnapshot();
+
+                // границы - концы степеней двойки, внутри них корзины не дробим, чтобы не раздувать вывод
+                size_t last_used = 0;
+                for (size_t i = 0; i < snapshot.counts.size(); ++i) {
+                    if (snapshot.counts[i] != 0) {
+                        last_used = i;
+                    }
+                }
+                uint64_t cumulative = 0;
+                for (size_t i = 0; i < snapshot.counts.size(); ++i) {
+                    cumulative += snapshot.counts[i];
+                    const bool octave_end = (i + 1) % Histogram::SUB_BUCKETS == 0;
+                    if (octave_end) {
+                        WriteSample(out, name, "_bucket", labels,
+                            Label("le", std::to_string(Histogram::BucketUpperBound(i))));
+                        out << cumulative << '\n';
+                        if (i >= last_used) {
+                            break;
+                        }
+                    }
+                }
+                WriteSample(out, name, "_bucket", labels, Label("le", "+Inf"));
+                out << snapshot.count << '\n';
+                WriteSample(out, name, "_sum", labels, "");
+                out << snapshot.sum << '\n';
+                WriteSample(out, name, "_count", labels, "");
+                out << snapshot.count << '\n';
+            }
+            break;
+        }
+    }
+    return out.str();
+}
+
+}  // namespace metrics
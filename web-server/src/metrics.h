@@ -0,0 +1,171 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace metrics {
+
+// счётчики разбиты на шарды по потокам, чтобы потоки не дрались за одну кэш-линию
+inline constexpr size_t SHARDS = 8;
+size_t ThisThreadShard();
+
+class Counter {
+public:
+    void Add(uint64_t value = 1) {
+        shards_[ThisThreadShard()].value.fetch_add(value, std::memory_order_relaxed);
+    }
+
+    uint64_t Value() const;
+
+private:
+    struct alignas(64) Shard {
+        std::atomic<uint64_t> value{ 0 };
+    };
+    std::array<Shard, SHARDS> shards_;
+};
+
+class Gauge {
+public:
+    void Set(int64_t value) {
+        value_.store(value, std::memory_order_relaxed);
+    }
+
+    void Add(int64_t value) {
+        value_.fetch_add(value, std::memory_order_relaxed);
+    }
+
+    int64_t Value() const {
+        return value_.load(std::memory_order_relaxed);
+    }
+
+private:
+    std::atomic<int64_t> value_{ 0 };
+};
+
+/*
+ * Гистограмма в духе HdrHistogram: каждая степень двойки делится на SUB_BUCKETS равных частей,
+ * так что относительная ошибка не больше 1/SUB_BUCKETS при любом масштабе значений.
+ * Значения меньше SUB_BUCKETS хранятся точно.
+ */
+class Histogram {
+public:
+    static constexpr int SUB_BUCKET_BITS = 3;
+    static constexpr uint64_t SUB_BUCKETS = 1 << SUB_BUCKET_BITS;
+    static constexpr size_t BUCKETS = (64 - SUB_BUCKET_BITS + 1) * SUB_BUCKETS;
+
+    struct Snapshot {
+        std::vector<uint64_t> counts;
+        uint64_t count = 0;
+        uint64_t sum = 0;
+
+        // оценка сверху для квантиля q из [0, 1]
+        uint64_t ValueAtQuantile(double q) const;
+    };
+
+    void Record(uint64_t value) {
+        Shard& shard = shards_[ThisThreadShard()];
+        shard.counts[BucketIndex(value)].fetch_add(1, std::memory_order_relaxed);
+        shard.sum.fetch_add(value, std::memory_order_relaxed);
+    }
+
+    Snapshot TakeSnapshot() const;
+
+    static size_t BucketIndex(uint64_t value);
+    // наибольшее значение, которое попадает в корзину
+    static uint64_t BucketUpperBound(size_t index);
+
+private:
+    struct alignas(64) Shard {
+        std::array<std::atomic<uint64_t>, BUCKETS> counts{};
+        std::atomic<uint64_t> sum{ 0 };
+    };
+    std::array<Shard, SHARDS> shards_;
+};
+
+// name="value" с экранированием для текстового формата Prometheus
+std::string Label(std::string_view name, std::string_view value);
+
+class Registry;
+
+/*
+ * Владение метрикой-колбэком: пока объект жив, колбэк выгружается, в деструкторе он убирается
+ * из реестра. Реестр статический и живёт дольше main, поэтому колбэк, захвативший что-то
+ * из main, должен уйти из реестра раньше захваченного.
+ */
+class CallbackRegistration {
+public:
+    CallbackRegistration() = default;
+    CallbackRegistration(std::string name, std::string labels)
+        : name_(std::move(name)), labels_(std::move(labels)), active_(true) {}
+    CallbackRegistration(CallbackRegistration&& other) noexcept
+        : name_(std::move(other.name_)), labels_(std::move(other.labels_)), active_(std::exchange(other.active_, false)) {}
+    CallbackRegistration& operator=(CallbackRegistration&& other) noexcept;
+    ~CallbackRegistration();
+
+    CallbackRegistration(const CallbackRegistration&) = delete;
+    CallbackRegistration& operator=(const CallbackRegistration&) = delete;
+
+    void Reset();
+
+private:
+    std::string name_;
+    std::string labels_;
+    bool active_ = false;
+};
+
+/*
+ * Реестр метрик процесса.
+ * Получение метрики по имени идёт под мьютексом, поэтому ссылку надо получить один раз
+ * и сохранить: сами метрики обновляются без блокировок, адреса у них не меняются.
+ */
+class Registry {
+public:
+    static Registry& Instance();
+
+    // labels - готовая строка вида a="x",b="y" (см. Label)
+    Counter& GetCounter(std::string_view name, std::string_view help, const std::string& labels = {});
+    Gauge& GetGauge(std::string_view name, std::string_view help, const std::string& labels = {});
+    Histogram& GetHistogram(std::string_view name, std::string_view help, const std::string& labels = {});
+    // значение считается в момент выгрузки, пока жив возвращённый объект
+    [[nodiscard]] CallbackRegistration AddCallbackGauge(std::string_view name, std::string_view help,
+        std::function<double()> callback, const std::string& labels = {});
+    // то же для монотонно растущего значения (имя с _total), выгружается с типом counter
+    [[nodiscard]] CallbackRegistration AddCallbackCounter(std::string_view name, std::string_view help,
+        std::function<double()> callback, const std::string& labels = {});
+    void RemoveCallback(std::string_view name, const std::string& labels = {});
+
+    // текстовый формат Prometheus 0.0.4
+    std::string RenderPrometheus() const;
+
+private:
+    Registry() = default;
+
+    enum class Type { COUNTER, GAUGE, HISTOGRAM };
+
+    struct Family {
+        std::string help;
+        Type type;
+        std::map<std::string, std::unique_ptr<Counter>> counters;
+        std::map<std::string, std::unique_ptr<Gauge>> gauges;
+        std::map<std::string, std::unique_ptr<Histogram>> histograms;
+        std::map<std::string, std::function<double()>> callbacks;
+    };
+
+    Family& GetFamily(std::string_view name, std::string_view help, Type type);
+    CallbackRegistration AddCallback(std::string_view name, std::string_view help, Type type,
+        std::function<double()> callback, const std::string& labels);
+
+    mutable std::mutex mutex_;
+    std::map<std::string, Family, std::less<>> families_;
+};
+
+}  // namespace metrics
@@ -1,10 +1,93 @@
 ﻿#include "model.h"
 
+#include <algorithm>
+#include <functional>
+#include <map>
 #include <stdexcept>
 
 namespace model {
 using namespace std::literals;
 
+namespace {
+
+// сортирует интервалы и сливает пересекающиеся/касающиеся
+void NormalizeIntervals(std::vector<RoadInterval>& intervals) {
+    std::sort(intervals.begin(), intervals.end(),
+        [](const RoadInterval& lhs, const RoadInterval& rhs) {
+            if (lhs.a != rhs.a) return lhs.a < rhs.a;
+            return lhs.b < rhs.b;
+        });
+
+    std::vector<RoadInterval> merged;
+    for (const auto& seg : intervals) {
+        if (merged.empty() || seg.a > merged.back().b) {
+            merged.push_back(seg);
+        } else if (seg.b > merged.back().b) {
+            merged.back().b = seg.b;
+        }
+    }
+    intervals.swap(merged);
+}
+
+}  // namespace
+
+RoadIndex::RoadIndex(const std::vector<Road>& roads) {
+    // std::map сразу даёт линии по возрастанию координаты
+    std::map<Coord, std::vector<RoadInterval>> horizontal;
+    std::map<Coord, std::vector<RoadInterval>> vertical;
+    for (const Road& road : roads) {
+        const Point start = road.GetStart();
+        const Point end = road.GetEnd();
+        if (road.IsHorizontal()) {
+            horizontal[start.y].emplace_back(std::min(start.x, end.x) - ROAD_HALF_WIDTH,
+                std::max(start.x, end.x) + ROAD_HALF_WIDTH);
+        } else {
+            vertical[start.x].emplace_back(std::min(start.y, end.y) - ROAD_HALF_WIDTH,
+                std::max(start.y, end.y) + ROAD_HALF_WIDTH);
+        }
+    }
+
+    auto flatten = [](std::map<Coord, std::vector<RoadInterval>>& by_line, Lines& lines) {
+        lines.keys.reserve(by_line.size());
+        lines.offsets.reserve(by_line.size() + 1);
+        for (auto& [key, intervals] : by_line) {
+            NormalizeIntervals(intervals);
+            lines.keys.push_back(key);
+            lines.offsets.push_back(static_cast<uint32_t>(lines.intervals.size()));
+            lines.intervals.insert(lines.intervals.end(), intervals.begin(), intervals.end());
+        }
+        lines.offsets.push_back(static_cast<uint32_t>(lines.intervals.size()));
+        lines.intervals.shrink_to_fit();
+    };
+    flatten(horizontal, horizontal_);
+    flatten(vertical, vertical_);
+}
+
+RoadIndex::RoadIndex(Lines horizontal, Lines vertical)
+    : horizontal_(std::move(horizontal))
+    , vertical_(std::move(vertical)) {
+    // Find полагается на отсортированные ключи и монотонные смещения в пределах intervals
+    for (const Lines* lines : { &horizontal_, &vertical_ }) {
+        const bool ok = lines->offsets.size() == lines->keys.size() + 1
+            && lines->offsets.front() == 0
+            && lines->offsets.back() == lines->intervals.size()
+            && std::is_sorted(lines->offsets.begin(), lines->offsets.end())
+            && std::adjacent_find(lines->keys.begin(), lines->keys.end(), std::greater_equal<>{}) == lines->keys.end();
+        if (!ok) {
+            throw std::invalid_argument("Inconsistent road index");
+        }
+    }
+}
+
+std::span<const RoadInterval> RoadIndex::Lines::Find(Coord key) const {
+    const auto it = std::lower_bound(keys.begin(), keys.end(), key);
+    if (it == keys.end() || *it != key) {
+        return {};
+    }
+    const size_t line = static_cast<size_t>(it - keys.begin());
+    return std::span<const RoadInterval>(intervals).subspan(offsets[line], offsets[line + 1] - offsets[line]);
+}
+
 void Map::AddOffice(Office office) {
     if (warehouse_id_to_index_.contains(office.GetId())) {
         throw std::invalid_argument("Duplicate warehouse");
@@ -27,6 +110,9 @@ void Game::AddMap(Map map) {
         throw std::invalid_argument("Map with id "s + *map.GetId() + " already exists"s);
     } else {
         try {
+            if (!map.HasRoadIndex()) {
+                map.BuildRoadIndex();
+            }
             maps_.emplace_back(std::move(map));
         } catch (...) {
             map_id_to_index_.erase(it);
@@ -142,22 +228,32 @@ int Dog::GetScore() const {
     return score_;
 }
 
-void Dog::AddPlayTime(std::chrono::milliseconds dt) { play_time_ += dt; }
+bool Dog::IsMoving() const {
+    return speed_.GetX() != 0 || speed_.GetY() != 0;
+}
+
+void Dog::SetJoinTime(std::chrono::milliseconds time) {
+    join_time_ = time;
+}
+
+std::chrono::milliseconds Dog::GetPlayTime(std::chrono::milliseconds now) const {
+    return now - join_time_;
+}
 
-void Dog::AddAfkTime(std::chrono::milliseconds dt) { 
-    afk_time_ += dt; 
+double Dog::GetPlayTimeSec(std::chrono::milliseconds now) const { 
+    return GetPlayTime(now).count() / 1000.0; 
 }
 
-void Dog::ResetAfkTime() { 
-    afk_time_ = std::chrono::milliseconds{ 0 }; 
+void Dog::SetIdleSince(std::optional<std::chrono::milliseconds> time) {
+    idle_since_ = time;
 }
 
-double Dog::GetPlayTimeSec() const { 
-    return play_time_.count() / 1000.0; 
+std::optional<std::chrono::milliseconds> Dog::GetIdleSince() const {
+    return idle_since_;
 }
 
-std::chrono::milliseconds Dog::GetAfkTime() const { 
-    return afk_time_; 
+std::chrono::milliseconds Dog::GetAfkTime(std::chrono::milliseconds now) const { 
+    return idle_since_ ? now - *idle_since_ : std::chrono::milliseconds{ 0 }; 
 }
 
 // ------------------- RealCoord ------------------------
@@ -7,6 +7,8 @@
 #include "tagged.h"
 #include <optional>
 #include <chrono>
+#include <cstdint>
+#include <span>
 
 
 namespace model {
@@ -17,8 +19,8 @@ namespace model {
 namespace infrastructure {
     struct SerDog;
 
-    SerDog ToSerDog(const model::Dog& dog);
-    model::Dog FromSerDog(const SerDog& s);
+    SerDog ToSerDog(const model::Dog& dog, std::chrono::milliseconds now);
+    model::Dog FromSerDog(const SerDog& s, std::chrono::milliseconds now);
 }
 
 namespace model {
@@ -129,6 +131,59 @@ private:
     Offset offset_;
 };
 
+// на сколько собака может отойти от оси дороги
+constexpr double ROAD_HALF_WIDTH = 0.4;
+
+struct RoadInterval {
+    RoadInterval() = default;
+    RoadInterval(double a, double b) : a(a), b(b) {}
+    double a = 0;
+    double b = 0;
+};
+
+/*
+ * Индекс дорог карты: для каждой горизонтальной линии y - отсортированные непересекающиеся
+ * интервалы по x (с учётом ширины дороги), для вертикальной линии x - интервалы по y.
+ * Зависит только от дорог, поэтому строится один раз на карту и делится всеми сессиями.
+ * Хранится плоско: отсортированные координаты линий, смещения и один общий массив интервалов.
+ */
+class RoadIndex {
+public:
+    struct Lines {
+        std::vector<Coord> keys;
+        // интервалы линии keys[i] лежат в [offsets[i], offsets[i + 1])
+        std::vector<uint32_t> offsets;
+        std::vector<RoadInterval> intervals;
+
+        std::span<const RoadInterval> Find(Coord key) const;
+    };
+
+    explicit RoadIndex(const std::vector<Road>& roads);
+    // уже построенные линии (из бандла карт); несогласованные бросают std::invalid_argument
+    RoadIndex(Lines horizontal, Lines vertical);
+
+    const Lines& GetHorizontalLines() const noexcept {
+        return horizontal_;
+    }
+
+    const Lines& GetVerticalLines() const noexcept {
+        return vertical_;
+    }
+
+    // пусто, если на линии нет дорог
+    std::span<const RoadInterval> GetHorizontal(Coord y) const {
+        return horizontal_.Find(y);
+    }
+
+    std::span<const RoadInterval> GetVertical(Coord x) const {
+        return vertical_.Find(x);
+    }
+
+private:
+    Lines horizontal_;
+    Lines vertical_;
+};
+
 class Map {
 public:
     using Id = util::Tagged<std::string, Map>;
@@ -163,6 +218,27 @@ public:
 
     void AddRoad(const Road& road) {
         roads_.emplace_back(road);
+        // индекс устарел, пересоберётся в BuildRoadIndex
+        road_index_.reset();
+    }
+
+    // вызывается из Game::AddMap, когда дороги карты уже известны
+    void BuildRoadIndex() {
+        road_index_ = std::make_shared<const RoadIndex>(roads_);
+    }
+
+    // готовый индекс, например из бандла; Game::AddMap тогда его не перестраивает
+    void SetRoadIndex(std::shared_ptr<const RoadIndex> road_index) {
+        road_index_ = std::move(road_index);
+    }
+
+    bool HasRoadIndex() const noexcept {
+        return road_index_ != nullptr;
+    }
+
+    // общий для всех копий карты индекс; для карты вне Game строится заново
+    std::shared_ptr<const RoadIndex> GetRoadIndex() const {
+        return road_index_ ? road_index_ : std::make_shared<const RoadIndex>(roads_);
     }
 
     void AddBuilding(const Building& building) {
@@ -193,6 +269,7 @@ private:
     Id id_;
     std::string name_;
     Roads roads_;
+    std::shared_ptr<const RoadIndex> road_index_;
     Buildings buildings_;
 
     OfficeIdToIndex warehouse_id_to_index_;
@@ -241,8 +318,8 @@ public:
     }
     
 private:
-    friend infrastructure::SerDog infrastructure::ToSerDog(const model::Dog& dog);
-    friend model::Dog infrastructure::FromSerDog(const infrastructure::SerDog& s);
+    friend infrastructure::SerDog infrastructure::ToSerDog(const model::Dog& dog, std::chrono::milliseconds now);
+    friend model::Dog infrastructure::FromSerDog(const infrastructure::SerDog& s, std::chrono::milliseconds now);
 
     double x_ = 0;
     double y_ = 0;
@@ -291,18 +368,23 @@ public:
     void AddScore(int points);
     int GetScore() const;
 
-    void AddPlayTime(std::chrono::milliseconds dt);
+    bool IsMoving() const;
 
-    void AddAfkTime(std::chrono::milliseconds dt);
-    void ResetAfkTime();
+    // время считаем от часов сессии: храним только момент входа и момент остановки,
+    // а не накапливаем каждый тик
+    void SetJoinTime(std::chrono::milliseconds time);
+    std::chrono::milliseconds GetPlayTime(std::chrono::milliseconds now) const;
+    double GetPlayTimeSec(std::chrono::milliseconds now) const;
 
-    double GetPlayTimeSec() const;
-    std::chrono::milliseconds GetAfkTime() const;
+    // nullopt - собака двигается
+    void SetIdleSince(std::optional<std::chrono::milliseconds> time);
+    std::optional<std::chrono::milliseconds> GetIdleSince() const;
+    std::chrono::milliseconds GetAfkTime(std::chrono::milliseconds now) const;
 
 private:
     
-    friend infrastructure::SerDog infrastructure::ToSerDog(const model::Dog& dog);
-    friend model::Dog infrastructure::FromSerDog(const infrastructure::SerDog& s);
+    friend infrastructure::SerDog infrastructure::ToSerDog(const model::Dog& dog, std::chrono::milliseconds now);
+    friend model::Dog infrastructure::FromSerDog(const infrastructure::SerDog& s, std::chrono::milliseconds now);
 
     std::string name_;
     uint64_t id_ = UINT64_MAX;  // это значит ещё не назначен id
@@ -314,8 +396,8 @@ private:
     std::vector<BagItem> bag_with_loot_;
 
     int score_ = 0;
-    std::chrono::milliseconds play_time_{ 0 };
-    std::chrono::milliseconds afk_time_{ 0 };
+    std::chrono::milliseconds join_time_{ 0 };
+    std::optional<std::chrono::milliseconds> idle_since_;
 };
 
 }  // namespace model
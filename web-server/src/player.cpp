@@ -1,4 +1,7 @@
 #include "player.h"
+#include "command_stream.h"
+#include "tracing.h"
+#include "metrics.h"
 #include <sstream>
 #include <iomanip>
 #include <algorithm>
@@ -9,12 +12,12 @@ using namespace model;
 using namespace collision_detector;
 using namespace postgres;
 
-const double DELTA = 0.4;
+const double DELTA = model::ROAD_HALF_WIDTH;
 
 // -------------------------- Player ------------------------------
 
-Player::Player(GameSession* game_session_ptr, model::Dog* dog_ptr)
-	: game_session_ptr_(game_session_ptr), dog_ptr_(dog_ptr) {
+Player::Player(GameSession* game_session_ptr, model::Dog* dog_ptr, DogHandle dog_handle)
+	: game_session_ptr_(game_session_ptr), dog_ptr_(dog_ptr), dog_handle_(dog_handle) {
 }
 
 GameSession* Player::GetSessionPtr() {
@@ -29,6 +32,10 @@ model::Dog* Player::GetDogPtr() {
 	return dog_ptr_;
 }
 
+DogHandle Player::GetDogHandle() const {
+	return dog_handle_;
+}
+
 void Player::SetToken(const Token& token) {
 	token_ = token;
 }
@@ -76,66 +83,11 @@ void PlayerTokens::DeletePlayer(const Token& token) {
 
 // ------------------- GameSession -------------------
 
-static void NormalizeIntervals(std::vector<RoadInterval>& intervals) {
-	// 1.     a ( ,   b)
-	std::sort(intervals.begin(), intervals.end(),
-		[](const RoadInterval& lhs, const RoadInterval& rhs) {
-			if (lhs.a != rhs.a) return lhs.a < rhs.a;
-			return lhs.b < rhs.b;
-		}
-	);
-
-	// 2.  /
-	std::vector<RoadInterval> merged;
-	for (const auto& seg : intervals) {
-		if (merged.empty() || seg.a > merged.back().b) {
-			//   
-			merged.push_back(seg);
-		}
-		else {
-			//   :  
-			if (seg.b > merged.back().b) {
-				merged.back().b = seg.b;
-			}
-		}
-	}
-	intervals.swap(merged);
-}
-
 GameSession::GameSession(const model::Map* map_ptr, bool is_random_dog_position) : 
-	map_ptr_(map_ptr), is_random_dog_position_(is_random_dog_position){
-	//  
-	for (const Road& road : map_ptr->GetRoads()) {
-		auto road_start = road.GetStart();
-		auto road_end = road.GetEnd();
-		if (road.IsHorizontal()) {	//  y 
-			if (road_start.x <= road_end.x) {
-				horizontal_intervals_[road_start.y].emplace_back(road_start.x - DELTA, road_end.x + DELTA);
-			}
-			else {
-				horizontal_intervals_[road_start.y].emplace_back(road_end.x - DELTA, road_start.x + DELTA);
-			}
-		}
-		else {	// vertical
-			if (road_start.y <= road_end.y) {
-				vertical_intervals_[road_start.x].emplace_back(road_start.y - DELTA, road_end.y + DELTA);
-			}
-			else {
-				vertical_intervals_[road_start.x].emplace_back(road_end.y - DELTA, road_start.y + DELTA);
-			}
-		}
-	}
-
-	// 
-	for (auto& [y, intervals] : horizontal_intervals_) {
-		NormalizeIntervals(intervals);
-	}
-	for (auto& [x, intervals] : vertical_intervals_) {
-		NormalizeIntervals(intervals);
-	}
+	map_ptr_(map_ptr), is_random_dog_position_(is_random_dog_position), road_index_(map_ptr->GetRoadIndex()) {
 }
 
-Dog* GameSession::AddDogToMap(model::Dog dog) {
+DogHandle GameSession::AddDogToMap(model::Dog dog) {
 	dog.SetId(local_id++);
 
 	if (!is_random_dog_position_) {
@@ -145,9 +97,20 @@ Dog* GameSession::AddDogToMap(model::Dog dog) {
 	else {
 		dog.SetPosition(GenerateRandomPosition());	//  
 	}
+	dog.SetJoinTime(time_);
+	last_occupied_ = time_;
+
+	DogHandle handle = dogs_.Insert(std::move(dog));
+	if (dog_grid_) {
+		dog_grid_->Insert(handle, dogs_.Get(handle)->GetPosition());
+	}
+	//   ,      
+	MarkIdle(handle, *dogs_.Get(handle));
+	return handle;
+}
 
-	dogs_.push_back(std::move(dog));
-	return &dogs_.back();
+model::Dog* GameSession::FindDog(DogHandle handle) {
+	return dogs_.Get(handle);
 }
 
 const model::Map* GameSession::GetMapPtr() const {
@@ -156,9 +119,14 @@ const model::Map* GameSession::GetMapPtr() const {
 
 void GameSession::SetMapPtr(model::Map* map_ptr) {
 	map_ptr_ = map_ptr;
+	road_index_ = map_ptr->GetRoadIndex();
 }
 
-std::deque<Dog>& GameSession::GetDogs() {
+size_t GameSession::GetDogsCount() const {
+	return dogs_.size();
+}
+
+DogStorage& GameSession::GetDogs() {
 	return dogs_;
 }
 
@@ -173,8 +141,7 @@ model::RealCoord GameSession::GenerateRandomPosition() const {
 		return model::RealCoord{ 0.0, 0.0 };
 	}
 
-	// thread_local,    std::random_device  
-	static thread_local std::mt19937_64 rng{ std::random_device{}() };
+	std::mt19937_64& rng = random_engine_;
 
 	//   
 	std::uniform_int_distribution<size_t> pick_road(0, roads.size() - 1);
@@ -216,28 +183,114 @@ model::RealCoord GameSession::GenerateRandomPosition() const {
 	return model::RealCoord{ spawn_x, spawn_y };
 }
 
-void GameSession::DeleteDog(const Dog* dog_ptr) {
-	auto it = std::find_if(dogs_.begin(), dogs_.end(), [dog_ptr](const Dog& d) {
-		return &d == dog_ptr;
-		});
-	dogs_.erase(it);
+void GameSession::SeedRandom(uint64_t seed) {
+	random_engine_.seed(seed);
+}
+
+std::mt19937_64& GameSession::GetRandomEngine() {
+	return random_engine_;
+}
+
+void GameSession::DeleteDog(DogHandle handle) {
+	//   idle_queue_   : handle    
+	if (const Dog* dog = dogs_.Get(handle); dog && dog_grid_) {
+		dog_grid_->Erase(handle, dog->GetPosition());
+	}
+	dogs_.Erase(handle);
+}
+
+void GameSession::SetDogMove(DogHandle handle, model::Direction dir) {
+	Dog* dog = dogs_.Get(handle);
+	if (!dog) {
+		return;
+	}
+	const bool was_moving = dog->IsMoving();
+	dog->SetMoveDog(dir, map_ptr_->GetDogSpeed());
+
+	if (dog->IsMoving()) {
+		dog->SetIdleSince(std::nullopt);
+	}
+	else if (was_moving) {
+		MarkIdle(handle, *dog);
+	}
+	//      -  
+}
+
+void GameSession::MarkIdle(DogHandle handle, Dog& dog) {
+	dog.SetIdleSince(time_);
+	idle_queue_.push(IdleEntry{ time_, handle });
+
+	//    ,   ,   
+	//    .      -  
+	if (idle_queue_.size() > 2 * dogs_.size() + 64) {
+		RebuildIdleQueue();
+	}
+}
+
+void GameSession::RebuildIdleQueue() {
+	std::vector<IdleEntry> entries;
+	entries.reserve(dogs_.size());
+	for (auto it = dogs_.begin(); it != dogs_.end(); ++it) {
+		if (auto since = it->GetIdleSince()) {
+			entries.push_back(IdleEntry{ *since, it.GetHandle() });
+		}
+	}
+	idle_queue_ = decltype(idle_queue_)(IdleEntryLater{}, std::move(entries));
+}
+
+std::vector<DogHandle> GameSession::TakeIdleDogs(std::chrono::milliseconds retirement_time) {
+	std::vector<DogHandle> result;
+	while (!idle_queue_.empty() && idle_queue_.top().since + retirement_time <= time_) {
+		const IdleEntry entry = idle_queue_.top();
+		idle_queue_.pop();
+
+		const Dog* dog = dogs_.Get(entry.dog);
+		//       -  
+		if (!dog || dog->GetIdleSince() != entry.since) {
+			continue;
+		}
+		result.push_back(entry.dog);
+	}
+	return result;
+}
+
+std::chrono::milliseconds GameSession::GetTime() const {
+	return time_;
+}
+
+std::chrono::milliseconds GameSession::GetEmptyFor() const {
+	return dogs_.empty() ? time_ - last_occupied_ : std::chrono::milliseconds{ 0 };
+}
+
+uint64_t GameSession::GetStateVersion() const {
+	return state_version_;
+}
+
+void GameSession::SetStateVersion(uint64_t version) {
+	state_version_ = version;
+}
+
+void GameSession::Compact() {
+	dogs_.shrink_to_fit();
+	lost_objects_.shrink_to_fit();
+	//         
+	RebuildIdleQueue();
 }
 
 RoadInterval GameSession::GetHorizontalInterval(const Dog& dog) const {
 	RealCoord dog_pos = dog.GetPosition();
 	RoadInterval alowed_interval;
 	int rounded_y = std::lround(dog_pos.GetY());
-	auto buckets_it = horizontal_intervals_.find(rounded_y);
+	const auto intervals = road_index_->GetHorizontal(rounded_y);
 	double difference = std::abs(dog_pos.GetY() - rounded_y);
 
-	if (buckets_it == horizontal_intervals_.end() || difference > DELTA) {
+	if (intervals.empty() || difference > DELTA) {
 		int rounded_x = std::lround(dog_pos.GetX());
 		alowed_interval.a = rounded_x - DELTA;
 		alowed_interval.b = rounded_x + DELTA;
 		return alowed_interval;
 	}
 
-	const auto& intervals = buckets_it->second;
 	auto it = std::upper_bound(
 		intervals.begin(), intervals.end(), dog_pos.GetX(),
 		[](double x, const RoadInterval& interval) {
@@ -264,17 +317,16 @@ RoadInterval GameSession::GetVerticalInterval(const Dog& dog) const {
 	RealCoord dog_pos = dog.GetPosition();
 	RoadInterval alowed_interval;
 	int rounded_x = std::lround(dog_pos.GetX());
-	auto buckets_it = vertical_intervals_.find(rounded_x);
+	const auto intervals = road_index_->GetVertical(rounded_x);
 	double difference = std::abs(dog_pos.GetX() - rounded_x);
 
-	if (buckets_it == vertical_intervals_.end() || difference > DELTA) {		
+	if (intervals.empty() || difference > DELTA) {		
 		int rounded_y = std::lround(dog_pos.GetY());
 		alowed_interval.a = rounded_y - DELTA;
 		alowed_interval.b = rounded_y + DELTA;
 		return alowed_interval;
 	}
 
-	const auto& intervals = buckets_it->second;
 	auto it = std::upper_bound(
 		intervals.begin(), intervals.end(), dog_pos.GetY(),
 		[](double y, const RoadInterval& interval) {
@@ -355,48 +407,150 @@ std::pair<RealCoord, RealCoord> GameSession::CalculatePosition(Dog& dog, int mil
 
 std::vector<std::pair<RealCoord, RealCoord>> GameSession::ProcessTickMove(int milliseconds) {
 	std::vector<std::pair<RealCoord, RealCoord>> result;
-	for (Dog& dog : dogs_) {
+	for (auto it = dogs_.begin(); it != dogs_.end(); ++it) {
+		Dog& dog = *it;
+		const bool was_moving = dog.IsMoving();
 		std::pair<RealCoord, RealCoord> current_move = CalculatePosition(dog, milliseconds);
 		result.push_back(current_move);
+		if (dog_grid_) {
+			dog_grid_->Move(it.GetHandle(), current_move.first, current_move.second);
+		}
+
+		//     -     
+		if (was_moving && !dog.IsMoving()) {
+			MarkIdle(it.GetHandle(), dog);
+		}
+	}
+	time_ += std::chrono::milliseconds{ milliseconds };
+	if (!dogs_.empty()) {
+		last_occupied_ = time_;
 	}
 	return result;
 }
 
 void GameSession::AddLostObject(model::LostObject lost_object) {
-	lost_objects_.push_back(std::move(lost_object));
+	const model::RealCoord pos = lost_object.pos;
+	const LootHandle handle = lost_objects_.Insert(std::move(lost_object));
+	if (loot_grid_) {
+		loot_grid_->Insert(handle, pos);
+	}
 }
 
-std::vector<model::LostObject>& GameSession::GetLostObjects() {
+LootStorage& GameSession::GetLostObjects() {
 	return lost_objects_;
 }
 
+void GameSession::RemoveCollectedLostObjects() {
+	// handle  :      
+	std::vector<std::pair<LootHandle, model::RealCoord>> collected;
+	for (auto it = lost_objects_.begin(); it != lost_objects_.end(); ++it) {
+		if (it->is_collected) {
+			collected.emplace_back(it.GetHandle(), it->pos);
+		}
+	}
+	for (const auto& [handle, pos] : collected) {
+		if (loot_grid_) {
+			loot_grid_->Erase(handle, pos);
+		}
+		lost_objects_.Erase(handle);
+	}
+}
+
+void GameSession::SetInterestRadius(double radius) {
+	if (radius <= 0) {
+		interest_radius_.reset();
+		dog_grid_.reset();
+		loot_grid_.reset();
+		return;
+	}
+	interest_radius_ = radius;
+	RebuildInterestGrids();
+}
+
+std::optional<double> GameSession::GetInterestRadius() const {
+	return interest_radius_;
+}
+
+void GameSession::RebuildInterestGrids() {
+	if (!interest_radius_) {
+		return;
+	}
+	//    :     3x3 
+	dog_grid_.emplace(*interest_radius_);
+	for (auto it = dogs_.begin(); it != dogs_.end(); ++it) {
+		dog_grid_->Insert(it.GetHandle(), it->GetPosition());
+	}
+	loot_grid_.emplace(*interest_radius_);
+	for (auto it = lost_objects_.begin(); it != lost_objects_.end(); ++it) {
+		loot_grid_->Insert(it.GetHandle(), it->pos);
+	}
+}
+
+static bool IsInRadius(RealCoord center, RealCoord pos, double radius) {
+	const double dx = pos.GetX() - center.GetX();
+	const double dy = pos.GetY() - center.GetY();
+	return dx * dx + dy * dy <= radius * radius;
+}
+
+std::vector<const model::Dog*> GameSession::FindDogsNear(model::RealCoord center) const {
+	std::vector<const Dog*> result;
+	if (!dog_grid_) {
+		return result;
+	}
+	dog_grid_->ForEachCandidate(center, *interest_radius_, [&](DogHandle handle) {
+		const Dog* dog = dogs_.Get(handle);
+		if (dog && IsInRadius(center, dog->GetPosition(), *interest_radius_)) {
+			result.push_back(dog);
+		}
+		});
+	return result;
+}
+
+std::vector<LootHandle> GameSession::FindLostObjectsNear(model::RealCoord center) const {
+	std::vector<LootHandle> result;
+	if (!loot_grid_) {
+		return result;
+	}
+	loot_grid_->ForEachCandidate(center, *interest_radius_, [&](LootHandle handle) {
+		const LostObject* item = lost_objects_.Get(handle);
+		if (item && IsInRadius(center, item->pos, *interest_radius_)) {
+			result.push_back(handle);
+		}
+		});
+	//        
+	std::sort(result.begin(), result.end(), [](LootHandle lhs, LootHandle rhs) {
+		return lhs.index < rhs.index;
+		});
+	return result;
+}
+
 // ---------------------- Players ----------------------------------
 
 Player& Players::AddDogToSession(std::string dog_name, GameSession& session) {
 	Dog dog(std::move(dog_name));
-	model::Dog* dog_ptr = session.AddDogToMap(std::move(dog));
+	DogHandle dog_handle = session.AddDogToMap(std::move(dog));
+	model::Dog* dog_ptr = session.FindDog(dog_handle);
 	//      
 	PlayerKey pk{ .map_id = session.GetMapPtr()->GetId(), .dog_id = dog_ptr->GetId() };
-	storage_.emplace_back(&session, dog_ptr);
-	Player& added_player = storage_.back();
-	player_ptr_by_key_[std::move(pk)] = &added_player;
-	return added_player;
+	PlayerHandle player_handle = storage_.Emplace(&session, dog_ptr, dog_handle);
+	player_handle_by_key_[std::move(pk)] = player_handle;
+	return *storage_.Get(player_handle);
 }
 
-Player* Players::FindByDogIdAndMapId(uint64_t dog_id, model::Map::Id id) const {
-	if (auto it = player_ptr_by_key_.find(PlayerKey{ id, dog_id }); it != player_ptr_by_key_.end()) {
-		return it->second;
+Player* Players::FindByDogIdAndMapId(uint64_t dog_id, model::Map::Id id) {
+	if (auto it = player_handle_by_key_.find(PlayerKey{ id, dog_id }); it != player_handle_by_key_.end()) {
+		return storage_.Get(it->second);
 	}
 	return nullptr;
 }
 
 void Players::DeletePlayer(uint64_t dog_id, model::Map::Id id) {
-	Player* player_to_delete_ptr = FindByDogIdAndMapId(dog_id, id);
-	player_ptr_by_key_.erase(PlayerKey{ .map_id = id, .dog_id = dog_id });
-	auto it = std::find_if(storage_.begin(), storage_.end(), [player_to_delete_ptr] (const Player& p) {
-		return &p == player_to_delete_ptr;
-	});
-	storage_.erase(it);
+	auto it = player_handle_by_key_.find(PlayerKey{ .map_id = id, .dog_id = dog_id });
+	if (it == player_handle_by_key_.end()) {
+		return;
+	}
+	storage_.Erase(it->second);
+	player_handle_by_key_.erase(it);
 }
 
 // --------------------------- GameSessionManager -------------------------------
@@ -418,6 +572,10 @@ GameSession* GameSessionManager::SelectSession(const Map::Id& map_id) {
 			throw std::runtime_error("eternal error. Map not found");
 		}
 		GameSession new_session(map_ptr, is_random_dog_position_);
+		new_session.SetInterestRadius(interest_radius_);
+		if (random_seed_) {
+			new_session.SeedRandom(*random_seed_ ^ std::hash<std::string>{}(*map_id));
+		}
 
 		// 
 		sessions_.push_back(std::move(new_session));
@@ -434,9 +592,13 @@ std::pair<Token, uint64_t> GameSessionManager::AddDogToMap(std::string name, mod
 	GameSession* session = SelectSession(map_id);
 
 	Player& player = players_.AddDogToSession(std::move(name), *session);
+	session->SetStateVersion(++state_version_);
 
 	Token token = player_tokens_.AddPlayer(player);
 	player.SetToken(token);
+	if (recorder_) {
+		recorder_->OnJoin(token, map_id, player.GetDogPtr()->GetName());
+	}
 
 	return { token, player.GetDogId() };
 }
@@ -456,9 +618,12 @@ Direction GameSessionManager::GetConvertedDirection(std::string_view dir) {
 
 void GameSessionManager::SetMoveDog(Player* dog_owner, std::string_view command) {
 	Direction dir = GetConvertedDirection(command);
-	//      
-	double speed = dog_owner->GetSessionPtr()->GetMapPtr()->GetDogSpeed();
-	dog_owner->GetDogPtr()->SetMoveDog(dir, speed);
+	dog_owner->GetSessionPtr()->SetStateVersion(++state_version_);
+	if (recorder_) {
+		recorder_->OnMove(dog_owner->GetToken(), command);
+	}
+	//       
+	dog_owner->GetSessionPtr()->SetDogMove(dog_owner->GetDogHandle(), dir);
 }
 
 void GameSessionManager::GenerateLoot(GameSession& session, int ms) {
@@ -481,7 +646,7 @@ void GameSessionManager::GenerateLoot(GameSession& session, int ms) {
 		static_cast<unsigned>(looter_count)
 	);
 
-	static thread_local std::mt19937_64 rng{ std::random_device{}() };
+	std::mt19937_64& rng = session.GetRandomEngine();
 	std::uniform_int_distribution<size_t> pick_type(0, loot_types_count - 1);
 
 	for (unsigned i = 0; i < generates; ++i) {
@@ -501,24 +666,25 @@ const double ITEM_RADIUS = 0;
 const double BASE_RADIUS = 0.5 / 2;
 
 void GameSessionManager::ProcessGatherEvent(GameSession& session, const std::vector<std::pair<model::RealCoord, model::RealCoord>>& all_moves) {
-	ItemGatherer item_gatherer;
-	// gatherer_id    -   gatherer  .
+	gatherer_batch_.Clear();
+	item_batch_.Clear();
+	// gatherer_id    -   gatherer  .
 	// ,         .
 	for (const auto& [start_pos, end_pos] : all_moves) {
-		item_gatherer.AddGatherer(Gatherer{ start_pos, end_pos, PLAYER_RADIUS });
+		gatherer_batch_.Add(Gatherer{ start_pos, end_pos, PLAYER_RADIUS });
 	}
 	//      ,            size
 	for (const auto& item : session.GetLostObjects()) {
-		item_gatherer.AddItem(Item{ item.pos, ITEM_RADIUS });
+		item_batch_.Add(Item{ item.pos, ITEM_RADIUS });
 	}
 	//       
 	for (const auto& office : session.GetMapPtr()->GetOffices()) {
-		item_gatherer.AddItem(Item{
+		item_batch_.Add(Item{
 			RealCoord(office.GetPosition().x, office.GetPosition().y),
 			BASE_RADIUS
 			});
 	}
-	std::vector<GatheringEvent> gathering_events = FindGatherEvents(item_gatherer);
+	std::vector<GatheringEvent> gathering_events = FindGatherEvents(gatherer_batch_, item_batch_);
 	//  
 	for (const auto& gathering_event : gathering_events) {
 
@@ -553,64 +719,116 @@ void GameSessionManager::ProcessGatherEvent(GameSession& session, const std::vec
 		}
 
 		//     ,        
-		current_dog.AddLootToBag(model::BagItem{gathering_event.item_id, lo.type});
+		current_dog.AddLootToBag(model::BagItem{ session.GetLostObjects().HandleAt(gathering_event.item_id).index, lo.type });
 		//      
 		lo.is_collected = true;
 	}
 	//      
-	auto& lost_objects = session.GetLostObjects();
-	lost_objects.erase(
-		std::remove_if(lost_objects.begin(), lost_objects.end(), [](const LostObject l) {
-			return l.is_collected == true;
-			}),
-		lost_objects.end()
-	);
+	session.RemoveCollectedLostObjects();
 } 
 
 void GameSessionManager::SetListener(ApplicationListener* listener) {
 	listener_ = listener;
 }
 
+void GameSessionManager::UpdateGauges() const {
+	static metrics::Gauge& sessions_gauge = metrics::Registry::Instance().GetGauge("game_sessions", "Game sessions");
+	static metrics::Gauge& dogs_gauge = metrics::Registry::Instance().GetGauge("game_dogs", "Dogs in all sessions");
+
+	size_t dogs = 0;
+	for (const GameSession& session : sessions_) {
+		dogs += session.GetDogsCount();
+	}
+	sessions_gauge.Set(static_cast<int64_t>(sessions_.size()));
+	dogs_gauge.Set(static_cast<int64_t>(dogs));
+}
+
+void GameSessionManager::SetRandomSeed(uint64_t seed) {
+	random_seed_ = seed;
+	for (GameSession& session : sessions_) {
+		session.SeedRandom(seed ^ std::hash<std::string>{}(*session.GetMapPtr()->GetId()));
+	}
+}
+
+void GameSessionManager::SetRecorder(CommandRecorder* recorder) {
+	recorder_ = recorder;
+}
+
+void GameSessionManager::SetSessionIdleTimeout(std::chrono::milliseconds timeout) {
+	session_idle_timeout_ = timeout;
+}
+
+//        
+static constexpr std::chrono::milliseconds COMPACT_PERIOD{ 60'000 };
+
+void GameSessionManager::ReclaimSessions(int ms) {
+	static metrics::Counter& reclaimed = metrics::Registry::Instance().GetCounter(
+		"game_sessions_reclaimed_total", "Game sessions removed after staying empty");
+
+	if (session_idle_timeout_.count() > 0) {
+		//     ,       .
+		//      ,      
+		for (auto it = sessions_.begin(); it != sessions_.end();) {
+			if (it->GetDogsCount() == 0 && it->GetEmptyFor() >= session_idle_timeout_) {
+				map_id_to_session_.erase(it->GetMapPtr()->GetId());
+				it = sessions_.erase(it);
+				reclaimed.Add();
+			}
+			else {
+				++it;
+			}
+		}
+	}
+
+	since_compact_ += std::chrono::milliseconds{ ms };
+	if (since_compact_ >= COMPACT_PERIOD) {
+		since_compact_ = std::chrono::milliseconds{ 0 };
+		for (GameSession& session : sessions_) {
+			session.Compact();
+		}
+	}
+}
+
+void GameSessionManager::SetInterestRadius(double radius) {
+	interest_radius_ = radius;
+	for (GameSession& session : sessions_) {
+		session.SetInterestRadius(radius);
+	}
+}
+
 std::vector<RetiredRecord> GameSessionManager::GetRecords(std::size_t start,
 	std::size_t max_items) const {	
 	return repo_.Get(static_cast<int>(start), static_cast<int>(max_items));
 }
 
 
-void GameSessionManager::CheckAfk(GameSession& session, int time_in_ms) {
-	const auto dt = std::chrono::milliseconds{ time_in_ms };
+void GameSessionManager::CheckAfk(GameSession& session) {
+	//      ,    ,   
+	const std::vector<DogHandle> idle_dogs = session.TakeIdleDogs(retirement_time_);
+	if (idle_dogs.empty()) {
+		return;
+	}
 
 	struct RetireInfo {
 		uint64_t dog_id;
 		model::Map::Id map_id;
 	};
 	std::vector<RetireInfo> to_retire;
-	
-	for (model::Dog& dog : session.GetDogs()) {
-		dog.AddPlayTime(dt);
-
-		if (dog.GetSpeed() == model::RealCoord{ 0, 0 }) {
-			dog.AddAfkTime(dt);
-
-			if (dog.GetAfkTime() >= retirement_time_) {
-				to_retire.push_back({ dog.GetId(), session.GetMapPtr()->GetId() });
-			}
-		}
-		else {
-			dog.ResetAfkTime();
-		}
+	to_retire.reserve(idle_dogs.size());
+	for (DogHandle handle : idle_dogs) {
+		to_retire.push_back({ session.FindDog(handle)->GetId(), session.GetMapPtr()->GetId() });
 	}
 
-	
 	for (const auto& [dog_id, map_id] : to_retire) {
 		Player* p = players_.FindByDogIdAndMapId(dog_id, map_id);
 		if (!p) continue;
 
 		//     
 		model::Dog* dog_ptr = p->GetDogPtr();
+		const DogHandle dog_handle = p->GetDogHandle();
 
 		// play_time   double
-		const double play_time = dog_ptr->GetPlayTimeSec();
+		const double play_time = dog_ptr->GetPlayTimeSec(session.GetTime());
 		const int score = dog_ptr->GetScore();
 		std::string name(dog_ptr->GetName());
 
@@ -627,20 +845,50 @@ void GameSessionManager::CheckAfk(GameSession& session, int time_in_ms) {
 
 		//   players_   session
 		players_.DeletePlayer(dog_id, map_id);
-		session.DeleteDog(dog_ptr);
+		session.DeleteDog(dog_handle);
 	}
 }
 
 void GameSessionManager::ProcessTick(int ms) {
+	static metrics::Histogram& tick_duration_us = metrics::Registry::Instance().GetHistogram(
+		"game_tick_duration_us", "Game tick processing time, microseconds");
+	const auto tick_started = std::chrono::steady_clock::now();
+	tracing::TickTrace tick_trace;
+	tick_state_version_ = ++state_version_;
+	if (recorder_) {
+		recorder_->OnTick(ms);
+	}
 	for (GameSession& session : sessions_) {		
-		GenerateLoot(session, ms);
-		std::vector<std::pair<RealCoord, RealCoord>> all_moves = session.ProcessTickMove(ms);
-		ProcessGatherEvent(session, all_moves);
-		CheckAfk(session, ms);
+		session.SetStateVersion(tick_state_version_);
+		{
+			tracing::ScopedTrace trace("GenerateLoot");
+			GenerateLoot(session, ms);
+		}
+		std::vector<std::pair<RealCoord, RealCoord>> all_moves;
+		{
+			tracing::ScopedTrace trace("ProcessTickMove");
+			all_moves = session.ProcessTickMove(ms);
+		}
+		{
+			tracing::ScopedTrace trace("ProcessGatherEvent");
+			ProcessGatherEvent(session, all_moves);
+		}
+		{
+			tracing::ScopedTrace trace("CheckAfk");
+			CheckAfk(session);
+		}
+	}
+	{
+		tracing::ScopedTrace trace("ReclaimSessions");
+		ReclaimSessions(ms);
 	}
+	UpdateGauges();
 	if (listener_) {
+		tracing::ScopedTrace trace("ApplicationListener::OnTick");
 		listener_->OnTick(std::chrono::milliseconds(ms));
 	}
+	tick_duration_us.Record(static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(
+		std::chrono::steady_clock::now() - tick_started).count()));
 }
 
 boost::json::array GameSessionManager::GetSerializedLostObjectByMapId(model::Map::Id map_id) const {
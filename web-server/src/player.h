@@ -8,6 +8,9 @@
 #include <random>
 #include <functional>
 #include <deque>
+#include <list>
+#include <queue>
+#include <chrono>
 #include <utility>
 #include <unordered_map>
 #include <optional>
@@ -15,11 +18,14 @@
 #include <boost/json.hpp>
 #include "retire_repository.h"
 #include "collision_detector.h"
+#include "slot_map.h"
+#include "spatial_grid.h"
 
 namespace app {
 	class GameSession;
 	class Player;
 	class GameSessionManager;
+	class CommandRecorder;
 	namespace detail {
 		struct TokenTag {};
 	}
@@ -50,31 +56,65 @@ struct DogHasher {
 	}
 };
 
-struct RoadInterval {
-	RoadInterval() = default;
-	RoadInterval(double a, double b) : a(a), b(b) {}
-	double a = 0;
-	double b = 0;
-};
+using DogStorage = util::SlotMap<model::Dog>;
+using DogHandle = DogStorage::Handle;
+// id предмета для клиента - номер его слота (LootHandle::index), он не меняется, пока предмет лежит
+using LootStorage = util::SlotMap<model::LostObject>;
+using LootHandle = LootStorage::Handle;
+
+using model::RoadInterval;
 
 class GameSession {
 public:
 
 	GameSession(const model::Map* map_ptr, bool is_random_dog_position);
-	model::Dog* AddDogToMap(model::Dog dog);
+	DogHandle AddDogToMap(model::Dog dog);
+	model::Dog* FindDog(DogHandle handle);
 	
 	const model::Map* GetMapPtr() const;
 	void SetMapPtr(model::Map* map_ptr);
 
-	std::deque<model::Dog>& GetDogs();
+	DogStorage& GetDogs();
+	size_t GetDogsCount() const;
+
+	// меняет направление и отмечает, начала собака стоять или двигаться
+	void SetDogMove(DogHandle handle, model::Direction dir);
 
+	// двигает собак и продвигает часы сессии на milliseconds
 	std::vector<std::pair<model::RealCoord, model::RealCoord>> ProcessTickMove(int milliseconds);
 
+	// собаки, которые стоят не меньше retirement_time на текущий момент часов сессии.
+	// Достаются из очереди, поэтому повторно не вернутся
+	std::vector<DogHandle> TakeIdleDogs(std::chrono::milliseconds retirement_time);
+	std::chrono::milliseconds GetTime() const;
+	// сколько времени по часам сессии в ней нет собак; 0, пока собаки есть
+	std::chrono::milliseconds GetEmptyFor() const;
+	// версия видимого состояния сессии: вход, смена направления, тик. Значения выдаёт менеджер
+	// из общего растущего счётчика, так что у разных сессий и разных состояний они не повторяются
+	uint64_t GetStateVersion() const;
+	void SetStateVersion(uint64_t version);
+	// отдаёт память, оставшуюся от пиков: хвосты контейнеров и устаревшие записи очереди.
+	// Пустые ячейки сеток удаляются сразу, как из них уходит последний объект
+	void Compact();
+
 	void AddLostObject(model::LostObject lost_object);
-	std::vector<model::LostObject>& GetLostObjects();
+	LootStorage& GetLostObjects();
+	// удаляет предметы с флагом is_collected
+	void RemoveCollectedLostObjects();
 	model::RealCoord GenerateRandomPosition() const;
+	// у каждой сессии свой генератор: при заданном seed сессия воспроизводима независимо от потоков и других карт
+	void SeedRandom(uint64_t seed);
+	std::mt19937_64& GetRandomEngine();
+
+	// область видимости: в состояние попадают только объекты в радиусе от собаки игрока.
+	// radius <= 0 выключает фильтрацию
+	void SetInterestRadius(double radius);
+	std::optional<double> GetInterestRadius() const;
+	// работают только при включённой области видимости
+	std::vector<const model::Dog*> FindDogsNear(model::RealCoord center) const;
+	std::vector<LootHandle> FindLostObjectsNear(model::RealCoord center) const;
 	
-	void DeleteDog(const model::Dog* dog_ptr);
+	void DeleteDog(DogHandle handle);
 
 private:
 
@@ -82,18 +122,51 @@ private:
 	RoadInterval GetVerticalInterval(const model::Dog& dog) const;
 	std::pair<model::RealCoord, model::RealCoord> CalculatePosition(model::Dog& dog, int milliseconds);
 
-	// y : разброс по x, либо x : разброс по y
-	std::unordered_map<int, std::vector<RoadInterval>> horizontal_intervals_;
-	std::unordered_map<int, std::vector<RoadInterval>> vertical_intervals_;
-
-	std::deque<model::Dog> dogs_;
+	void MarkIdle(DogHandle handle, model::Dog& dog);
+	void RebuildIdleQueue();
+	void RebuildInterestGrids();
+
+	// адреса собак стабильны, Player хранит указатель и handle
+	DogStorage dogs_;
+
+	// очередь простаивающих собак по моменту остановки. Время ретайра у всех одинаковое,
+	// поэтому порядок по моменту остановки совпадает с порядком по дедлайну.
+	// Когда собака снова пошла, запись не ищем: она отбросится при извлечении,
+	// так как у собаки уже другой idle_since (или его нет)
+	struct IdleEntry {
+		std::chrono::milliseconds since;
+		DogHandle dog;
+	};
+	struct IdleEntryLater {
+		bool operator()(const IdleEntry& lhs, const IdleEntry& rhs) const {
+			return lhs.since > rhs.since;
+		}
+	};
+	std::priority_queue<IdleEntry, std::vector<IdleEntry>, IdleEntryLater> idle_queue_;
+
+	// часы сессии, идут только тиками
+	std::chrono::milliseconds time_{ 0 };
+	// последний момент, когда в сессии были собаки
+	std::chrono::milliseconds last_occupied_{ 0 };
+	uint64_t state_version_ = 0;
 
 	uint64_t local_id = 0;
 	const model::Map* map_ptr_;
 	bool is_random_dog_position_;
+	// интервалы дорог общие для всех сессий карты
+	std::shared_ptr<const model::RoadIndex> road_index_;
+
+	// лут, как и собаки, по стабильным handle: удаление подобранного не сдвигает остальные
+	LootStorage lost_objects_;
 
-	// лут
-	std::vector<model::LostObject> lost_objects_;
+	// GenerateRandomPosition константный, но сдвигает генератор
+	mutable std::mt19937_64 random_engine_{ std::random_device{}() };
+
+	// сетки для области видимости. Собак переносим между ячейками прямо в тике,
+	// подобранные предметы убираем из сетки поштучно
+	std::optional<double> interest_radius_;
+	std::optional<util::SpatialGrid<DogHandle>> dog_grid_;
+	std::optional<util::SpatialGrid<LootHandle>> loot_grid_;
 
 	
 
@@ -114,11 +187,12 @@ using Token = util::Tagged<std::string, detail::TokenTag>;
 
 class Player {
 public:
-	Player(GameSession* game_session_ptr, model::Dog* dog_ptr);
+	Player(GameSession* game_session_ptr, model::Dog* dog_ptr, DogHandle dog_handle);
 
 	GameSession* GetSessionPtr();
 	uint64_t GetDogId() const;
 	model::Dog* GetDogPtr();	
+	DogHandle GetDogHandle() const;
 	void SetToken(const Token& token);
 	Token GetToken() const;
 
@@ -128,6 +202,7 @@ private:
 
 	GameSession* game_session_ptr_;
 	model::Dog* dog_ptr_;
+	DogHandle dog_handle_;
 	std::optional<Token> token_;
 };
 
@@ -183,9 +258,12 @@ struct PlayerKeyHash {
 
 class Players {
 public:
+	using Storage = util::SlotMap<Player>;
+	using PlayerHandle = Storage::Handle;
+
 	Players() = default;
 	Player& AddDogToSession(std::string dog_name, GameSession& session);
-	Player* FindByDogIdAndMapId(uint64_t dog_id, model::Map::Id id) const;
+	Player* FindByDogIdAndMapId(uint64_t dog_id, model::Map::Id id);
 	void DeletePlayer(uint64_t dog_id, model::Map::Id id);
 
 private:
@@ -194,8 +272,8 @@ private:
 	friend void infrastructure::FromSerState
 	(app::GameSessionManager& manager, const infrastructure::SerState& ser_state);
 
-	std::deque<Player> storage_;
-	std::unordered_map<PlayerKey, Player*, PlayerKeyHash> player_ptr_by_key_;
+	Storage storage_;
+	std::unordered_map<PlayerKey, PlayerHandle, PlayerKeyHash> player_handle_by_key_;
 };
 
 struct MapIdHaher {
@@ -211,7 +289,7 @@ public:
 	}
 
 	collision_detector::Item GetItem(size_t idx) const override {
-		return items_.at(idx);
+		return items_[idx];
 	}
 
 	size_t GatherersCount() const override {
@@ -219,7 +297,7 @@ public:
 	}
 
 	collision_detector::Gatherer GetGatherer(size_t idx) const override {
-		return gatherers_.at(idx);
+		return gatherers_[idx];
 	}
 
 	void AddItem(const collision_detector::Item& item) {
@@ -275,6 +353,22 @@ public:
 	void ProcessGatherEvent(GameSession& session, const std::vector<std::pair<model::RealCoord, model::RealCoord>>& all_moves);
 	void SetListener(ApplicationListener* listener);
 
+	// радиус области видимости для всех сессий, <= 0 - отдаём всё состояние
+	void SetInterestRadius(double radius);
+
+	// генераторы всех сессий, и текущих, и будущих, засеваются от seed и id карты
+	void SetRandomSeed(uint64_t seed);
+	// входы, смены направления и тики пишутся в recorder; nullptr - не писать
+	void SetRecorder(CommandRecorder* recorder);
+	// сессия без собак дольше timeout удаляется вместе с лутом; 0 - сессии живут вечно
+	void SetSessionIdleTimeout(std::chrono::milliseconds timeout);
+
+	// версия, которую получили все сессии на последнем тике. Тик меняет все сессии разом,
+	// вход и смена направления - только версию своей сессии
+	uint64_t GetTickStateVersion() const {
+		return tick_state_version_;
+	}
+
 	std::vector<postgres::RetiredRecord> GetRecords(std::size_t start, std::size_t max_items) const;
 	
 private:
@@ -284,11 +378,16 @@ private:
 
 	GameSession* SelectSession(const model::Map::Id& map_id);
 
-	void CheckAfk(GameSession& session, int time_in_ms);
+	void CheckAfk(GameSession& session);
+	// удаляет пустые сессии и периодически ужимает оставшиеся
+	void ReclaimSessions(int ms);
+	// число сессий и собак для /metrics, обновляется раз в тик
+	void UpdateGauges() const;
 
 	Players players_;
 	PlayerTokens player_tokens_;
-	std::deque<GameSession> sessions_;
+	// list: пустые сессии удаляются из середины, а адреса остальных держат Player и map_id_to_session_
+	std::list<GameSession> sessions_;
 	model::Game& game_;
 	bool is_random_dog_position_;
 
@@ -298,7 +397,19 @@ private:
 	loot_gen::LootGenerator& loot_gen_;
 
 	ApplicationListener* listener_ = nullptr;
+	CommandRecorder* recorder_ = nullptr;
 	std::chrono::milliseconds retirement_time_;
+	double interest_radius_ = 0;
+	std::optional<uint64_t> random_seed_;
+	std::chrono::milliseconds session_idle_timeout_{ 0 };
+	std::chrono::milliseconds since_compact_{ 0 };
+	// счётчик версий состояния сессий, см. GameSession::GetStateVersion
+	uint64_t state_version_ = 0;
+	uint64_t tick_state_version_ = 0;
+
+	// пачки для поиска коллизий, память переиспользуется между тиками
+	collision_detector::GathererBatch gatherer_batch_;
+	collision_detector::ItemBatch item_batch_;
 
 	postgres::RetiredPlayersRepository& repo_;
 };
@@ -0,0 +1,60 @@
+#include "rate_limiter.h"
+
+#include <algorithm>
+
+namespace http_server {
+
+TokenBucketLimiter::TokenBucketLimiter(double rate_per_second, double burst, size_t max_keys)
+    : rate_(rate_per_second)
+    , burst_(std::max(burst, 1.0))
+    , max_keys_per_shard_(std::max<size_t>(max_keys / SHARDS, 1)) {
+}
+
+bool TokenBucketLimiter::TryAcquire(std::string_view key, Clock::time_point now) {
+    Shard& shard = shards_[KeyHash{}(key) % SHARDS];
+    std::lock_guard lock(shard.mutex);
+
+    if (auto it = shard.buckets.find(key); it != shard.buckets.end()) {
+        Bucket& bucket = it->second;
+        bucket.tokens = Refill(bucket, now);
+        bucket.updated = now;
+        if (bucket.tokens < 1.0) {
+            return false;
+        }
+        bucket.tokens -= 1.0;
+        return true;
+    }
+
+    if (shard.buckets.size() >= max_keys_per_shard_) {
+        Evict(shard, now);
+    }
+    shard.buckets.emplace(std::string(key), Bucket{ burst_ - 1.0, now });
+    return true;
+}
+
+size_t TokenBucketLimiter::Size() const {
+    size_t size = 0;
+    for (const Shard& shard : shards_) {
+        std::lock_guard lock(shard.mutex);
+        size += shard.buckets.size();
+    }
+    return size;
+}
+
+double TokenBucketLimiter::Refill(const Bucket& bucket, Clock::time_point now) const {
+    const std::chrono::duration<double> elapsed = now - bucket.updated;
+    return std::min(burst_, bucket.tokens + std::max(elapsed.count(), 0.0) * rate_);
+}
+
+void TokenBucketLimiter::Evict(Shard& shard, Clock::time_point now) {
+    std::erase_if(shard.buckets, [this, now](const auto& item) {
+        return Refill(item.second, now) >= burst_;
+        });
+    // все ключи активны - освобождаем сразу восьмую часть, чтобы не пробегать кусок на каждом новом ключе
+    const size_t target = max_keys_per_shard_ - std::max<size_t>(max_keys_per_shard_ / 8, 1);
+    while (shard.buckets.size() > target) {
+        shard.buckets.erase(shard.buckets.begin());
+    }
+}
+
+}  // namespace http_server
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+namespace http_server {
+
+/*
+ * Ограничитель частоты запросов: по token bucket на каждый ключ (токен игрока или IP клиента).
+ * Ведро вмещает burst запросов и пополняется со скоростью rate в секунду.
+ * Ключи разложены по SHARDS независимым кускам со своим mutex, чтобы потоки сети не толкались на одной блокировке.
+ * Число ключей ограничено: когда кусок переполнен, из него выкидываются сначала полные вёдра
+ * (их состояние не отличить от нового ключа), потом, если не хватило, произвольные.
+ */
+class TokenBucketLimiter {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    static constexpr size_t SHARDS = 16;
+
+    TokenBucketLimiter(double rate_per_second, double burst, size_t max_keys = 100'000);
+
+    TokenBucketLimiter(const TokenBucketLimiter&) = delete;
+    TokenBucketLimiter& operator=(const TokenBucketLimiter&) = delete;
+
+    // true - запрос пропускаем и списываем из ведра один токен
+    bool TryAcquire(std::string_view key, Clock::time_point now = Clock::now());
+
+    size_t Size() const;
+
+private:
+    struct Bucket {
+        double tokens;
+        Clock::time_point updated;
+    };
+
+    // поиск по string_view без создания std::string
+    struct KeyHash {
+        using is_transparent = void;
+        size_t operator()(std::string_view key) const noexcept {
+            return std::hash<std::string_view>{}(key);
+        }
+    };
+
+    struct alignas(64) Shard {
+        mutable std::mutex mutex;
+        std::unordered_map<std::string, Bucket, KeyHash, std::equal_to<>> buckets;
+    };
+
+    double Refill(const Bucket& bucket, Clock::time_point now) const;
+    void Evict(Shard& shard, Clock::time_point now);
+
+    double rate_;
+    double burst_;
+    size_t max_keys_per_shard_;
+    std::array<Shard, SHARDS> shards_;
+};
+
+}  // namespace http_server
@@ -10,6 +10,8 @@ namespace http_handler {
 
 	static constexpr std::string_view INVALID_TOKEN_S = "invalidToken";
 	static constexpr std::string_view UNKNOWN_TOKEN_S = "unknownToken";
+	static constexpr std::string_view TOO_MANY_REQUESTS_S = "tooManyRequests";
+	static constexpr std::string_view SERVER_BUSY_S = "serverBusy";
 	static constexpr std::string_view POS_S = "pos";	
 
 	static constexpr std::string_view PLAYERS_S = "players";
@@ -66,6 +68,18 @@ json::value ErrorInvalidAction() {
 	return MakeError(INVALID_ARGUMENT_S, "Failed to parse action");
 }
 
+json::value ErrorTooManyRequests() {
+	return MakeError(TOO_MANY_REQUESTS_S, "Request rate limit exceeded");
+}
+
+json::value ErrorServerBusy() {
+	return MakeError(SERVER_BUSY_S, "Server is overloaded, try again later");
+}
+
+json::value ErrorInvalidAdminToken() {
+	return MakeError(INVALID_TOKEN_S, "Admin token is missing or wrong");
+}
+
 // ---------------------- ответы ---------------------
 
 json::value GetPlayersInSameSession(app::Player* player) {
@@ -82,63 +96,85 @@ json::value GetPlayersInSameSession(app::Player* player) {
 
 // ------------ вспомогательные для State -----------------
 
-void AddPlayersToState(json::object& state_obj, app::GameSession* current_session_ptr) {
-	json::object player_id_to_data;
+json::object MakeDogState(const model::Dog& dog) {
+	json::object data;		
 
-	for (const model::Dog& dog : current_session_ptr->GetDogs()) {
-		json::object data;		
-
-		const RealCoord coordinates = dog.GetPosition();
-		const RealCoord speed = dog.GetSpeed();
-		std::string direction(1, dog.GetConvertedDirection());
-		const uint64_t local_id = dog.GetId();
-
-		json::array pos_arr;
-		pos_arr.push_back(coordinates.GetX());
-		pos_arr.push_back(coordinates.GetY());
-		data[POS_S] = pos_arr;
-
-		json::array speed_arr;
-		speed_arr.push_back(speed.GetX());
-		speed_arr.push_back(speed.GetY());
-		data[SPEED_S] = speed_arr;
-
-		data[DIR_S] = direction;
-
-		// вывод данных по сумке
-		json::array id_and_types;
-		for (const model::BagItem item : dog.GetLootInBag()) {
-			json::object bag_items;
-			bag_items[ID_S] = item.id;
-			bag_items[TYPE_S] = item.type;
-			id_and_types.emplace_back(std::move(bag_items));
-		}
-		data[BAG_S] = std::move(id_and_types);
+	const RealCoord coordinates = dog.GetPosition();
+	const RealCoord speed = dog.GetSpeed();
+	std::string direction(1, dog.GetConvertedDirection());
+
+	json::array pos_arr;
+	pos_arr.push_back(coordinates.GetX());
+	pos_arr.push_back(coordinates.GetY());
+	data[POS_S] = pos_arr;
 
-		// теперь добавим очки
-		data[SCORE_S] = dog.GetScore();
+	json::array speed_arr;
+	speed_arr.push_back(speed.GetX());
+	speed_arr.push_back(speed.GetY());
+	data[SPEED_S] = speed_arr;
 
-		player_id_to_data.emplace(std::to_string(local_id), data);
+	data[DIR_S] = direction;
+
+	// вывод данных по сумке
+	json::array id_and_types;
+	for (const model::BagItem item : dog.GetLootInBag()) {
+		json::object bag_items;
+		bag_items[ID_S] = item.id;
+		bag_items[TYPE_S] = item.type;
+		id_and_types.emplace_back(std::move(bag_items));
 	}
-	state_obj[PLAYERS_S] = std::move(player_id_to_data);
+	data[BAG_S] = std::move(id_and_types);
+
+	// теперь добавим очки
+	data[SCORE_S] = dog.GetScore();
+	return data;
 }
 
-void AddLostObjectToState(json::object& state_obj, app::GameSession* current_session_ptr) {
-	json::object lost_id_to_data;
+json::object MakeLostObjectState(const model::LostObject& current_object) {
+	json::object disc;
+	disc[TYPE_S] = current_object.type;
+
+	// создаём массив с координатами
+	json::array coordinates;
+	coordinates.push_back(current_object.pos.GetX());
+	coordinates.push_back(current_object.pos.GetY());
+	disc[POS_S] = coordinates;
+	return disc;
+}
+
+void AddPlayersToState(json::object& state_obj, app::Player* player) {
+	app::GameSession* current_session_ptr = player->GetSessionPtr();
+	json::object player_id_to_data;
 
-	const std::vector<model::LostObject> lost_objects = current_session_ptr->GetLostObjects();
-	for (int i = 0; i < lost_objects.size(); ++i) {
-		const model::LostObject& current_object = lost_objects[i];
+	if (current_session_ptr->GetInterestRadius()) {
+		// только собаки рядом с нашей (наша тоже сюда попадает)
+		for (const model::Dog* dog : current_session_ptr->FindDogsNear(player->GetDogPtr()->GetPosition())) {
+			player_id_to_data.emplace(std::to_string(dog->GetId()), MakeDogState(*dog));
+		}
+	}
+	else {
+		for (const model::Dog& dog : current_session_ptr->GetDogs()) {
+			player_id_to_data.emplace(std::to_string(dog.GetId()), MakeDogState(dog));
+		}
+	}
+	state_obj[PLAYERS_S] = std::move(player_id_to_data);
+}
 
-		json::object disc;
-		disc[TYPE_S] = current_object.type;
+void AddLostObjectToState(json::object& state_obj, app::Player* player) {
+	app::GameSession* current_session_ptr = player->GetSessionPtr();
+	json::object lost_id_to_data;
 
-		// создаём массив с координатами
-		json::array coordinates;
-		coordinates.push_back(current_object.pos.GetX());
-		coordinates.push_back(current_object.pos.GetY());
-		disc[POS_S] = coordinates;
-		lost_id_to_data[std::to_string(i)] = disc;
+	// id предмета - номер его слота в сессии, при фильтрации и удалении других он не меняется
+	const app::LootStorage& lost_objects = current_session_ptr->GetLostObjects();
+	if (current_session_ptr->GetInterestRadius()) {
+		for (app::LootHandle handle : current_session_ptr->FindLostObjectsNear(player->GetDogPtr()->GetPosition())) {
+			lost_id_to_data[std::to_string(handle.index)] = MakeLostObjectState(*lost_objects.Get(handle));
+		}
+	}
+	else {
+		for (auto it = lost_objects.begin(); it != lost_objects.end(); ++it) {
+			lost_id_to_data[std::to_string(it.GetHandle().index)] = MakeLostObjectState(*it);
+		}
 	}
 	state_obj[LOST_OBJECTS_S] = std::move(lost_id_to_data);
 }
@@ -146,14 +182,13 @@ void AddLostObjectToState(json::object& state_obj, app::GameSession* current_ses
 // -------------------------------------------------------
 
 json::value GetStateInSameSession(app::Player* player) {	
-	auto current_session_ptr = player->GetSessionPtr();
 	json::object state_obj;	// главный корень
 
 	// 1. сначала игроки
-	AddPlayersToState(state_obj, current_session_ptr);
+	AddPlayersToState(state_obj, player);
 
 	// 2. Потерянные объекты
-	AddLostObjectToState(state_obj, current_session_ptr);
+	AddLostObjectToState(state_obj, player);
 
 	return state_obj;
 }
@@ -263,7 +298,7 @@ json::value ApiRequestHandler::GetMaps() const {
 	return root;
 }
 
-void ApiRequestHandler::AddRoadsToMap(json::object& map_dict, const model::Map* map_ptr) const {
+void ApiRequestHandler::AddRoadsToMap(json::object& map_dict, const model::Map* map_ptr) {
 	json::array array_of_roads_json;
 	const auto& roads_array = map_ptr->GetRoads();
 	for (const auto& road : roads_array) {
@@ -281,7 +316,7 @@ void ApiRequestHandler::AddRoadsToMap(json::object& map_dict, const model::Map*
 	map_dict[ROADS_S] = std::move(array_of_roads_json);
 }
 
-void ApiRequestHandler::AddBuildingsMap(json::object& map_dict, const model::Map* map_ptr) const {
+void ApiRequestHandler::AddBuildingsMap(json::object& map_dict, const model::Map* map_ptr) {
 	json::array array_of_buildings_json;
 	const auto& buildings_array = map_ptr->GetBuildings();
 	for (const auto& building : buildings_array) {
@@ -295,7 +330,7 @@ void ApiRequestHandler::AddBuildingsMap(json::object& map_dict, const model::Map
 	map_dict[BUILDINGS_S] = std::move(array_of_buildings_json);
 }
 
-void ApiRequestHandler::AddOfficesMap(json::object& map_dict, const model::Map* map_ptr) const {
+void ApiRequestHandler::AddOfficesMap(json::object& map_dict, const model::Map* map_ptr) {
 	json::array array_of_offices_json;
 	const auto& offices_array = map_ptr->GetOffices();
 	for (const auto& office : offices_array) {
@@ -319,15 +354,20 @@ std::optional<json::value> ApiRequestHandler::GetMap(const std::string_view map_
 		return std::nullopt;
 	}
 
+	return SerializeMap(*map_ptr, manager_.GetSerializedLostObjectByMapId(id));
+}
+
+json::value ApiRequestHandler::SerializeMap(const model::Map& map, json::array loot_types) {
 	json::value root;
 	auto& map_dict = root.emplace_object();
 
-	map_dict[ID_S] = *map_ptr->GetId();
-	map_dict[NAME_S] = map_ptr->GetName();
+	map_dict[ID_S] = *map.GetId();
+	map_dict[NAME_S] = map.GetName();
 
-	AddRoadsToMap(map_dict, map_ptr);
-	AddBuildingsMap(map_dict, map_ptr);
-	AddOfficesMap(map_dict, map_ptr);
+	AddRoadsToMap(map_dict, &map);
+	AddBuildingsMap(map_dict, &map);
+	AddOfficesMap(map_dict, &map);
+	map_dict[LOOT_TYPE_S] = std::move(loot_types);
 
 	return root;
 }
@@ -344,15 +384,100 @@ StringResponse ApiRequestHandler::HandleGetMaps(StringResponse res) const {
 }
 
 // GET /api/v1/maps/{id}
+StringResponse ApiRequestHandler::Encode(StringResponse res, http_server::ContentCoding coding) const {
+	static metrics::Counter& input_bytes = metrics::Registry::Instance().GetCounter("api_compression_input_bytes_total",
+		"API response bytes before compression");
+	static metrics::Counter& output_bytes = metrics::Registry::Instance().GetCounter("api_compression_output_bytes_total",
+		"API response bytes after compression");
+
+	if (!compression_.IsEnabled()) {
+		return res;
+	}
+	// ответ зависит от Accept-Encoding, промежуточные кэши должны это учитывать.
+	// Уже сжатое тело (из кэша состояния) сравнивать с порогом нельзя - он про несжатый размер
+	if (res.count(http::field::content_encoding)) {
+		res.set(http::field::vary, ACCEPT_ENCODING_S);
+		return res;
+	}
+	if (res.body().size() < compression_.min_size) {
+		return res;
+	}
+	res.set(http::field::vary, ACCEPT_ENCODING_S);
+	// клиент сжатие не принимает
+	if (coding == http_server::ContentCoding::IDENTITY) {
+		return res;
+	}
+	input_bytes.Add(res.body().size());
+	res.body() = http_server::Compress(res.body(), coding, compression_.level);
+	output_bytes.Add(res.body().size());
+	res.set(http::field::content_encoding, http_server::ToString(coding));
+	res.content_length(res.body().size());
+	return res;
+}
+
+const std::string& ApiRequestHandler::CachedBody::Get(http_server::ContentCoding coding, int level) {
+	using http_server::ContentCoding;
+	if (coding == ContentCoding::IDENTITY) {
+		return identity;
+	}
+	std::string& encoded = coding == ContentCoding::GZIP ? gzip : deflate;
+	if (encoded.empty()) {
+		encoded = http_server::Compress(identity, coding, level);
+	}
+	return encoded;
+}
+
+void ApiRequestHandler::WriteState(StringResponse& res, app::Player* player, http_server::ContentCoding coding) {
+	static metrics::Counter& cache_hits = metrics::Registry::Instance().GetCounter("api_state_cache_total",
+		"Game state requests by state cache result", metrics::Label("result", "hit"));
+	static metrics::Counter& cache_misses = metrics::Registry::Instance().GetCounter("api_state_cache_total",
+		"Game state requests by state cache result", metrics::Label("result", "miss"));
+
+	const app::GameSession* session = player->GetSessionPtr();
+	// с областью видимости у каждого игрока своё состояние
+	if (session->GetInterestRadius()) {
+		res.body() = boost::json::serialize(GetStateInSameSession(player));
+		return;
+	}
+
+	// тик меняет все сессии сразу - тогда выкидываем всё, заодно и тела удалённых сессий
+	if (state_cache_tick_version_ != manager_.GetTickStateVersion()) {
+		state_cache_.clear();
+		state_cache_tick_version_ = manager_.GetTickStateVersion();
+	}
+	// вход и смена направления меняют версию только своей сессии
+	auto [it, inserted] = state_cache_.try_emplace(session);
+	CachedBody& cached = it->second;
+	if (inserted || cached.version != session->GetStateVersion()) {
+		cached = CachedBody{ .version = session->GetStateVersion(),
+			.identity = boost::json::serialize(GetStateInSameSession(player)) };
+		cache_misses.Add();
+	}
+	else {
+		cache_hits.Add();
+	}
+
+	if (compression_.IsEnabled() && coding != http_server::ContentCoding::IDENTITY
+		&& cached.identity.size() >= compression_.min_size) {
+		res.body() = cached.Get(coding, compression_.level);
+		res.set(http::field::content_encoding, http_server::ToString(coding));
+		res.set(http::field::vary, ACCEPT_ENCODING_S);
+		return;
+	}
+	res.body() = cached.identity;
+}
+
 StringResponse ApiRequestHandler::HandleGetMap(StringResponse res, std::string_view map_id) const {
 	res.set(http::field::cache_control, NO_CACHE_S);
 	if (map_id.empty()) {
 		res.result(http::status::not_found);
 		res.body() = boost::json::serialize(ErrorMapNotFound());
 	}
+	else if (auto it = map_responses_.find(model::Map::Id(std::string(map_id))); it != map_responses_.end()) {
+		res.result(http::status::ok);
+		res.body() = it->second;
+	}
 	else if (auto m = GetMap(map_id)) {
-		m->as_object()[LOOT_TYPE_S] = manager_.GetSerializedLostObjectByMapId(model::Map::Id(std::string(map_id)));
-
 		res.result(http::status::ok);
 		res.body() = boost::json::serialize(*m);
 	}
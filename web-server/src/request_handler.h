@@ -2,9 +2,16 @@
 #include "http_server.h"
 #include "model.h"
 #include "player.h"
+#include "tracing.h"
+#include "metrics.h"
+#include "rate_limiter.h"
+#include "compression.h"
 #include <boost/json.hpp>
+#include <algorithm>
 #include <optional>
 #include <filesystem>
+#include <memory>
+#include <unordered_map>
 
 #include <chrono>
 #include <string>
@@ -32,6 +39,7 @@ static constexpr std::string_view API_V1_GAME_JOIN_S = "/api/v1/game/join";
 static constexpr std::string_view USERNAME_S = "userName";
 static constexpr std::string_view MAPID_S = "mapId";
 static constexpr std::string_view NO_CACHE_S = "no-cache";
+static constexpr std::string_view ACCEPT_ENCODING_S = "Accept-Encoding";
 static constexpr std::string_view POST_S = "POST";
 static constexpr std::string_view API_V1_GAME_PLAYERS_S = "/api/v1/game/players";
 static constexpr std::string_view API_V1_GAME_STATE_S = "/api/v1/game/state";
@@ -113,6 +121,9 @@ boost::json::value ErrorMissedToken();
 boost::json::value ErrorUnknownToken();
 boost::json::value ErrorInvalidAction();
 boost::json::value ErrorInvalidContentType();
+boost::json::value ErrorTooManyRequests();
+boost::json::value ErrorServerBusy();
+boost::json::value ErrorInvalidAdminToken();
 
 boost::json::value TokenAndPlayerId(app::Token token, uint64_t player_id);
 boost::json::value GetPlayersInSameSession(app::Player* player);
@@ -127,9 +138,34 @@ public:
     ApiRequestHandler(const ApiRequestHandler&) = delete;
     ApiRequestHandler& operator=(const ApiRequestHandler&) = delete;
 
+    // настраивается до запуска сервера
+    void SetCompression(http_server::CompressionSettings settings) {
+        compression_ = settings;
+    }
+
+    using MapResponses = std::unordered_map<model::Map::Id, std::string, util::TaggedHasher<model::Map::Id>>;
+
+    // готовые тела GET /api/v1/maps/{id} (из бандла карт), тоже до запуска сервера
+    void SetMapResponses(MapResponses responses) {
+        map_responses_ = std::move(responses);
+    }
+
+    // тело GET /api/v1/maps/{id}; им же пользуется сборщик бандла карт
+    static boost::json::value SerializeMap(const model::Map& map, boost::json::array loot_types);
+
     template <typename Body, typename Allocator, typename Send>
     void operator()(http::request<Body, http::basic_fields<Allocator>>&& req, Send&& send) {
         using http::status;
+        // кодирование ответа выбирается один раз на запрос и передаётся тем, кому нужно
+        http_server::ContentCoding coding = http_server::ContentCoding::IDENTITY;
+        if (compression_.IsEnabled()) {
+            if (auto it = req.find(http::field::accept_encoding); it != req.end()) {
+                coding = http_server::SelectContentCoding(it->value());
+            }
+        }
+        auto reply = [this, &send, coding](StringResponse&& response) {
+            send(Encode(std::move(response), coding));
+            };
         StringResponse res;
         res.version(req.version());
         res.keep_alive(req.keep_alive());
@@ -149,10 +185,11 @@ public:
                 res.set(http::field::cache_control, NO_CACHE_S);
                 res.body() = boost::json::serialize(ErrorInvalidMethod());
                 res.content_length(res.body().size());
-                send(std::move(res));
+                reply(std::move(res));
                 return;
             }
-            send(HandleGetMaps(std::move(res)));
+            tracing::ScopedTrace trace("HandleGetMaps");
+            reply(HandleGetMaps(std::move(res)));
             return;
         }
         if (path.starts_with(MAP_ID_PREFIX)) {                    // /api/v1/maps/{id}
@@ -162,31 +199,36 @@ public:
                 res.set(http::field::cache_control, NO_CACHE_S);
                 res.body() = boost::json::serialize(ErrorInvalidMethod());
                 res.content_length(res.body().size());
-                send(std::move(res));
+                reply(std::move(res));
                 return;
             }
-            send(HandleGetMap(std::move(res), path.substr(MAP_ID_PREFIX.size())));
+            tracing::ScopedTrace trace("HandleGetMap");
+            reply(HandleGetMap(std::move(res), path.substr(MAP_ID_PREFIX.size())));
             return;
         }
         if (path == API_V1_GAME_JOIN_S) {                         // /api/v1/game/join
-            send(HandleJoin(std::move(res), req));
+            tracing::ScopedTrace trace("HandleJoin");
+            reply(HandleJoin(std::move(res), req));
             return;
         }
         if (path == API_V1_GAME_PLAYERS_S) {                      // /api/v1/game/players
-            send(HandleGetPlayers(std::move(res), req));
+            tracing::ScopedTrace trace("HandleGetPlayers");
+            reply(HandleGetPlayers(std::move(res), req));
             return;
         }
         if (path == API_V1_GAME_STATE_S) {                        // /api/v1/game/state
-            send(HandleGameState(std::move(res), req));
+            tracing::ScopedTrace trace("HandleGameState");
+            reply(HandleGameState(std::move(res), req, coding));
             return;
         }
         if (path == API_V1_GAME_PLAYER_ACTION_S) {                // /api/v1/game/player/action
-            send(HandlePlayerAction(std::move(res), req));
+            tracing::ScopedTrace trace("HandlePlayerAction");
+            reply(HandlePlayerAction(std::move(res), req));
             return;
         }
         if (path == API_V1_GAME_TICK_S) {                         // /api/v1/game/tick
             if (is_manual_tick_allowed_) {
-                send(HandleTick(std::move(res), req));
+                reply(HandleTick(std::move(res), req));
             }
             else {
                 // как на любой левый endpoint
@@ -194,13 +236,14 @@ public:
                 res.body() = boost::json::serialize(ErrorBadRequest());
                 res.set(http::field::cache_control, NO_CACHE_S);
                 res.content_length(res.body().size());
-                send(std::move(res));
+                reply(std::move(res));
             }
             return;
         }
 
         if (path == API_V1_GAME_RECORDS_S) {                         // /api/v1/game/records
-            send(HandleRecords(std::move(res), req, query));
+            tracing::ScopedTrace trace("HandleRecords");
+            reply(HandleRecords(std::move(res), req, query));
             return;
         }
 
@@ -208,7 +251,7 @@ public:
         res.result(status::bad_request);
         res.body() = boost::json::serialize(ErrorBadRequest());
         res.content_length(res.body().size());
-        send(std::move(res));
+        reply(std::move(res));
     }
 
 
@@ -220,10 +263,12 @@ private:
     std::optional<boost::json::value> GetMap(const std::string_view map_id_sv) const;
     bool is_manual_tick_allowed_;
 
-    // используются в GetMap
-    void AddRoadsToMap(boost::json::object& dict, const model::Map* map_ptr) const;
-    void AddBuildingsMap(boost::json::object& dict, const model::Map* map_ptr) const;
-    void AddOfficesMap(boost::json::object& dict, const model::Map* map_ptr) const;   
+    // используются в SerializeMap
+    static void AddRoadsToMap(boost::json::object& dict, const model::Map* map_ptr);
+    static void AddBuildingsMap(boost::json::object& dict, const model::Map* map_ptr);
+    static void AddOfficesMap(boost::json::object& dict, const model::Map* map_ptr);
+
+    MapResponses map_responses_;
 
     // обработка API запросов
     StringResponse HandleGetMaps(StringResponse res) const;
@@ -231,6 +276,29 @@ private:
 
     app::GameSessionManager& manager_;
 
+    // сжатие ответов API, настраивается до запуска сервера
+    http_server::CompressionSettings compression_;
+
+    // сжимает тело, если клиент это принимает и ответ не меньше порога
+    StringResponse Encode(StringResponse res, http_server::ContentCoding coding) const;
+
+    // тело /game/state одинаково для всех игроков сессии, пока состояние сессии не поменялось
+    // (без области видимости). Сериализуется и сжимается один раз на версию состояния сессии
+    struct CachedBody {
+        uint64_t version = 0;
+        std::string identity;
+        std::string gzip;
+        std::string deflate;
+
+        // сжатый вариант считается при первом запросе
+        const std::string& Get(http_server::ContentCoding coding, int level);
+    };
+    // кэш трогается только из api_strand, синхронизация не нужна
+    std::unordered_map<const app::GameSession*, CachedBody> state_cache_;
+    uint64_t state_cache_tick_version_ = 0;
+
+    void WriteState(StringResponse& res, app::Player* player, http_server::ContentCoding coding);
+
 // ---------- Объявление шаблонных методов ------------------------
 
     // POST /api/v1/game/join
@@ -249,7 +317,8 @@ private:
     template <typename Body, typename Allocator>
     http_handler::StringResponse HandleGameState(
         StringResponse res,
-        http::request<Body, http::basic_fields<Allocator>> const& req);
+        http::request<Body, http::basic_fields<Allocator>> const& req,
+        http_server::ContentCoding coding);
 
     template <typename Body, typename Allocator>
     http_handler::StringResponse HandlePlayerAction(
@@ -369,17 +438,64 @@ public:
 
     explicit RequestHandler(model::Game& game, const std::filesystem::path root, Strand api_strand, app::GameSessionManager& manager, 
         bool is_manual_tick_allowed)
-        : api_handler_(game, root, manager, is_manual_tick_allowed), static_handler_(game, root), api_strand_(std::move(api_strand)) {
+        : api_handler_(game, root, manager, is_manual_tick_allowed), static_handler_(game, root), api_strand_(std::move(api_strand))
+        , strand_queue_delay_us_(metrics::Registry::Instance().GetHistogram("api_strand_queue_delay_us",
+            "Time API request waits for api_strand, microseconds"))
+        , strand_queue_depth_(metrics::Registry::Instance().GetGauge("api_strand_queue_depth",
+            "API requests queued to api_strand"))
+        , rejected_rate_(metrics::Registry::Instance().GetCounter("api_requests_rejected_total",
+            "API requests rejected before api_strand", metrics::Label("reason", "rate_limit")))
+        , rejected_overload_(metrics::Registry::Instance().GetCounter("api_requests_rejected_total",
+            "API requests rejected before api_strand", metrics::Label("reason", "overload"))) {
+    }
+
+    // настраивается до запуска сервера; rate_per_second == 0 - без ограничения.
+    // Запросы с токеном списываются ещё и из общего ведра IP, в IP_RATE_FACTOR раз большего
+    void SetRateLimit(double rate_per_second, double burst) {
+        if (rate_per_second > 0) {
+            limiter_ = std::make_unique<http_server::TokenBucketLimiter>(rate_per_second, burst);
+            ip_limiter_ = std::make_unique<http_server::TokenBucketLimiter>(
+                rate_per_second * IP_RATE_FACTOR, burst * IP_RATE_FACTOR);
+        }
+        else {
+            limiter_.reset();
+            ip_limiter_.reset();
+        }
+    }
+
+    // сколько запросов может ждать api_strand, пока новые не получат 503; 0 - без ограничения
+    void SetMaxStrandQueue(size_t max_queue) {
+        max_strand_queue_ = max_queue;
+    }
+
+    void SetCompression(http_server::CompressionSettings settings) {
+        api_handler_.SetCompression(settings);
+    }
+
+    void SetMapResponses(ApiRequestHandler::MapResponses responses) {
+        api_handler_.SetMapResponses(std::move(responses));
     }
 
     template <typename Body, typename Allocator, typename Send>
     void operator()(http::request<Body, http::basic_fields<Allocator>>&& req, Send&& send, std::string client_ip) {
         if (std::string_view(req.target()).starts_with(API_S)) {
+            // отказ отдаём прямо из потока сети, strand игры такие запросы не видит
+            if (const auto rejection = Admit(req, client_ip)) {
+                send(MakeRejection(req, *rejection));
+                return;
+            }
             auto self = this->shared_from_this();
-            auto handle = [self, req = std::move(req), send = std::forward<Send>(send)]() mutable {
+            const auto allocator = req.get_allocator();
+            auto handle = [self, req = std::move(req), send = std::forward<Send>(send)
+                , queued = std::chrono::steady_clock::now()]() mutable {
+                self->strand_queue_depth_.Add(-1);
+                self->strand_queue_delay_us_.Record(static_cast<uint64_t>(
+                    std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - queued).count()));
                 self->api_handler_(std::move(req), std::forward<decltype(send)>(send));
                 };
-            boost::asio::dispatch(api_strand_, std::move(handle));
+            strand_queue_depth_.Add(1);
+            // операция strand'а выделяется аллокатором запроса, то есть из памяти соединения
+            boost::asio::dispatch(api_strand_, http_server::BindAllocator(allocator, std::move(handle)));
         }
         else {
             static_handler_(std::move(req), std::forward<Send>(send));
@@ -387,9 +503,79 @@ public:
     }
 
 private:
+    template <typename Request>
+    std::optional<http::status> Admit(const Request& req, std::string_view client_ip) {
+        if (max_strand_queue_ != 0 && strand_queue_depth_.Value() >= static_cast<int64_t>(max_strand_queue_)) {
+            rejected_overload_.Add();
+            return http::status::service_unavailable;
+        }
+        if (limiter_ && !AcquireRate(req, client_ip)) {
+            rejected_rate_.Add();
+            return http::status::too_many_requests;
+        }
+        return std::nullopt;
+    }
+
+    // У игрока своё ведро по токену, без токена (или с кривым) - общее на IP.
+    // Токен при этом не проверяется на существование (менеджер живёт в api_strand), поэтому
+    // запрос с токеном платит и из ведра IP: иначе новый поддельный токен на каждый запрос
+    // давал бы новое полное ведро, а заодно вытеснял бы вёдра настоящих игроков
+    template <typename Request>
+    bool AcquireRate(const Request& req, std::string_view client_ip) {
+        const std::string_view token = WellFormedToken(req);
+        if (token.empty()) {
+            return limiter_->TryAcquire(client_ip);
+        }
+        // IP первым: отказ по нему не заводит ведро под токен
+        return ip_limiter_->TryAcquire(client_ip) && limiter_->TryAcquire(token);
+    }
+
+    // токен из Authorization, если он такой же формы, как выдаёт сервер (32 hex), иначе пусто
+    template <typename Request>
+    static std::string_view WellFormedToken(const Request& req) {
+        constexpr size_t TOKEN_SIZE = 32;
+        const auto it = req.find(http::field::authorization);
+        if (it == req.end()) {
+            return {};
+        }
+        const std::string_view value = it->value();
+        if (!value.starts_with(K_BEARER_PREFIX) || value.size() != K_BEARER_PREFIX.size() + TOKEN_SIZE) {
+            return {};
+        }
+        const std::string_view token = value.substr(K_BEARER_PREFIX.size());
+        const bool is_hex = std::all_of(token.begin(), token.end(), [](char c) {
+            return std::isxdigit(static_cast<unsigned char>(c)) != 0;
+            });
+        return is_hex ? token : std::string_view{};
+    }
+
+    template <typename Request>
+    static StringResponse MakeRejection(const Request& req, http::status status) {
+        StringResponse res{ status, req.version() };
+        res.set(http::field::content_type, APPLICATION_JSON_S);
+        res.set(http::field::cache_control, NO_CACHE_S);
+        res.set(http::field::retry_after, "1");
+        res.keep_alive(req.keep_alive());
+        res.body() = boost::json::serialize(status == http::status::too_many_requests
+            ? ErrorTooManyRequests()
+            : ErrorServerBusy());
+        res.prepare_payload();
+        return res;
+    }
+
     ApiRequestHandler api_handler_;
     StaticRequestHandler static_handler_;
     Strand api_strand_;
+    metrics::Histogram& strand_queue_delay_us_;
+    metrics::Gauge& strand_queue_depth_;
+    metrics::Counter& rejected_rate_;
+    metrics::Counter& rejected_overload_;
+    // сколько игроков за одним IP (NAT) не упираются в общее ведро
+    static constexpr double IP_RATE_FACTOR = 8;
+
+    std::unique_ptr<http_server::TokenBucketLimiter> limiter_;
+    std::unique_ptr<http_server::TokenBucketLimiter> ip_limiter_;
+    size_t max_strand_queue_ = 0;
 };
 
 
@@ -518,7 +704,8 @@ inline http_handler::StringResponse http_handler::ApiRequestHandler::HandleGetPl
 template <typename Body, typename Allocator>
 inline http_handler::StringResponse http_handler::ApiRequestHandler::HandleGameState(
     StringResponse res,
-    http::request<Body, http::basic_fields<Allocator>> const& req
+    http::request<Body, http::basic_fields<Allocator>> const& req,
+    http_server::ContentCoding coding
 ) {
     namespace http = boost::beast::http;
     namespace json = boost::json;
@@ -536,14 +723,14 @@ inline http_handler::StringResponse http_handler::ApiRequestHandler::HandleGameS
     return ExecuteAuthorized(
         std::move(res),
         req,
-        [this](StringResponse r,
+        [this, coding](StringResponse r,
             auto const& inner_req,
             app::Player* player_ptr) -> StringResponse
         {
             r.result(http::status::ok);
 
             if (inner_req.method() == http::verb::get) {
-                r.body() = boost::json::serialize(GetStateInSameSession(player_ptr));
+                WriteState(r, player_ptr, coding);
             }            
 
             r.content_length(r.body().size());
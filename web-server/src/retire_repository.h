@@ -9,6 +9,9 @@
 #include <string>
 #include <cassert>
 #include <algorithm>
+#include <chrono>
+
+#include "metrics.h"
 
 namespace postgres {
 
@@ -61,6 +64,10 @@ public:
     }
 
     ConnectionWrapper GetConnection() {
+        static metrics::Histogram& wait_us = metrics::Registry::Instance().GetHistogram(
+            "db_pool_wait_us", "Time spent waiting for a free DB connection, microseconds");
+        const auto started = std::chrono::steady_clock::now();
+
         std::unique_lock lock{ mutex_ };
         // Блокируем текущий поток и ждём, пока cond_var_ не получит уведомление и не освободится
         // хотя бы одно соединение
@@ -68,6 +75,8 @@ public:
             return used_connections_ < pool_.size();
             });
         // После выхода из цикла ожидания мьютекс остаётся захваченным
+        wait_us.Record(static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - started).count()));
 
         return { std::move(pool_[used_connections_++]), *this };
     }
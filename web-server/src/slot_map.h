@@ -0,0 +1,208 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <deque>
+#include <iterator>
+#include <optional>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace util {
+
+/*
+ * Slot map с поколениями.
+ * Элементы лежат в слотах std::deque, поэтому адреса живых элементов не меняются
+ * ни при вставке, ни при удалении соседей. Освободившиеся слоты переиспользуются,
+ * а поколение слота увеличивается, чтобы старый Handle больше не находил новый элемент.
+ * Вставка, удаление и поиск по Handle работают за O(1).
+ *
+ * Плотный здесь только массив индексов живых слотов: обход идёт по нему и пропускает дыры,
+ * но сами значения лежат в слотах deque (вперемешку с пустыми) и читаются через индекс.
+ * Это сознательный размен: Player держит указатель на Dog, и перенос значений в плотный
+ * массив (с переездом последнего на место удалённого) эти указатели бы ломал.
+ * Порядок обхода после удаления не сохраняется (последний элемент встаёт на место удалённого).
+ */
+template <typename T>
+class SlotMap {
+    struct Slot {
+        std::optional<T> value;
+        uint32_t generation = 0;
+        uint32_t dense_pos = 0;   // позиция в dense_, пока слот занят
+    };
+
+public:
+    struct Handle {
+        uint32_t index = UINT32_MAX;
+        uint32_t generation = 0;
+
+        bool operator==(const Handle&) const = default;
+    };
+
+    template <bool IsConst>
+    class Iterator {
+        using Owner = std::conditional_t<IsConst, const SlotMap, SlotMap>;
+
+    public:
+        using iterator_category = std::random_access_iterator_tag;
+        using value_type = T;
+        using difference_type = std::ptrdiff_t;
+        using pointer = std::conditional_t<IsConst, const T*, T*>;
+        using reference = std::conditional_t<IsConst, const T&, T&>;
+
+        Iterator() = default;
+        Iterator(Owner* owner, size_t pos) : owner_(owner), pos_(pos) {}
+
+        reference operator*() const { return *owner_->slots_[owner_->dense_[pos_]].value; }
+        pointer operator->() const { return &**this; }
+        reference operator[](difference_type n) const { return *(*this + n); }
+
+        Iterator& operator++() { ++pos_; return *this; }
+        Iterator operator++(int) { auto tmp = *this; ++pos_; return tmp; }
+        Iterator& operator--() { --pos_; return *this; }
+        Iterator operator--(int) { auto tmp = *this; --pos_; return tmp; }
+        Iterator& operator+=(difference_type n) { pos_ += n; return *this; }
+        Iterator& operator-=(difference_type n) { pos_ -= n; return *this; }
+        Iterator operator+(difference_type n) const { return Iterator(owner_, pos_ + n); }
+        Iterator operator-(difference_type n) const { return Iterator(owner_, pos_ - n); }
+        difference_type operator-(const Iterator& other) const {
+            return static_cast<difference_type>(pos_) - static_cast<difference_type>(other.pos_);
+        }
+
+        bool operator==(const Iterator& other) const { return pos_ == other.pos_; }
+        auto operator<=>(const Iterator& other) const { return pos_ <=> other.pos_; }
+
+        // Handle элемента, на который указывает итератор
+        Handle GetHandle() const { return owner_->HandleAt(pos_); }
+
+    private:
+        Owner* owner_ = nullptr;
+        size_t pos_ = 0;
+    };
+
+    using iterator = Iterator<false>;
+    using const_iterator = Iterator<true>;
+
+    template <typename... Args>
+    Handle Emplace(Args&&... args) {
+        uint32_t index;
+        if (!free_slots_.empty()) {
+            index = free_slots_.back();
+            free_slots_.pop_back();
+        }
+        else {
+            index = static_cast<uint32_t>(slots_.size());
+            slots_.emplace_back().generation = next_generation_;
+        }
+        Slot& slot = slots_[index];
+        slot.value.emplace(std::forward<Args>(args)...);
+        slot.dense_pos = static_cast<uint32_t>(dense_.size());
+        dense_.push_back(index);
+        return Handle{ index, slot.generation };
+    }
+
+    Handle Insert(T value) {
+        return Emplace(std::move(value));
+    }
+
+    // возвращает false, если элемент по handle уже удалён
+    bool Erase(Handle handle) {
+        if (!Contains(handle)) {
+            return false;
+        }
+        Slot& slot = slots_[handle.index];
+        // на освободившееся место в плотном массиве ставим последний элемент
+        const uint32_t last_index = dense_.back();
+        dense_[slot.dense_pos] = last_index;
+        slots_[last_index].dense_pos = slot.dense_pos;
+        dense_.pop_back();
+
+        slot.value.reset();
+        ++slot.generation;
+        free_slots_.push_back(handle.index);
+        return true;
+    }
+
+    bool Contains(Handle handle) const noexcept {
+        return handle.index < slots_.size()
+            && slots_[handle.index].generation == handle.generation
+            && slots_[handle.index].value.has_value();
+    }
+
+    T* Get(Handle handle) noexcept {
+        return Contains(handle) ? &*slots_[handle.index].value : nullptr;
+    }
+
+    const T* Get(Handle handle) const noexcept {
+        return Contains(handle) ? &*slots_[handle.index].value : nullptr;
+    }
+
+    // Handle элемента на позиции pos в порядке обхода
+    Handle HandleAt(size_t pos) const {
+        const uint32_t index = dense_.at(pos);
+        return Handle{ index, slots_[index].generation };
+    }
+
+    // доступ по позиции в порядке обхода
+    T& at(size_t pos) {
+        return *slots_[dense_.at(pos)].value;
+    }
+
+    const T& at(size_t pos) const {
+        return *slots_[dense_.at(pos)].value;
+    }
+
+    T& operator[](size_t pos) {
+        return *slots_[dense_[pos]].value;
+    }
+
+    const T& operator[](size_t pos) const {
+        return *slots_[dense_[pos]].value;
+    }
+
+    size_t size() const noexcept {
+        return dense_.size();
+    }
+
+    bool empty() const noexcept {
+        return dense_.empty();
+    }
+
+    void clear() {
+        for (uint32_t index : dense_) {
+            slots_[index].value.reset();
+            ++slots_[index].generation;
+            free_slots_.push_back(index);
+        }
+        dense_.clear();
+    }
+
+    // отдаёт память свободных слотов в хвосте и лишнюю ёмкость массивов индексов.
+    // Адреса живых элементов не меняются. Слот, созданный потом на месте срезанного,
+    // начнёт с поколения, которого у срезанного не было, поэтому старые Handle не оживут
+    void shrink_to_fit() {
+        while (!slots_.empty() && !slots_.back().value) {
+            next_generation_ = std::max(next_generation_, slots_.back().generation);
+            slots_.pop_back();
+        }
+        const auto slots_count = slots_.size();
+        free_slots_.erase(std::remove_if(free_slots_.begin(), free_slots_.end(),
+            [slots_count](uint32_t index) { return index >= slots_count; }), free_slots_.end());
+        free_slots_.shrink_to_fit();
+        dense_.shrink_to_fit();
+    }
+
+    iterator begin() { return iterator(this, 0); }
+    iterator end() { return iterator(this, dense_.size()); }
+    const_iterator begin() const { return const_iterator(this, 0); }
+    const_iterator end() const { return const_iterator(this, dense_.size()); }
+
+private:
+    std::deque<Slot> slots_;            // значения, на своих местах
+    std::vector<uint32_t> dense_;       // индексы занятых слотов, по ним идёт обход
+    std::vector<uint32_t> free_slots_;  // индексы свободных слотов
+    uint32_t next_generation_ = 0;      // поколение для новых слотов, см. shrink_to_fit
+};
+
+}  // namespace util
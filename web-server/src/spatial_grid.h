@@ -0,0 +1,112 @@
+#pragma once
+
+#include "model.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+namespace util {
+
+/*
+ * Равномерная сетка для поиска объектов рядом с точкой.
+ * Объект лежит в ячейке, куда попадает его позиция. Перемещение внутри ячейки ничего не стоит,
+ * при переходе в другую ячейку объект переносится из одного списка в другой.
+ * Поиск отдаёт кандидатов из всех ячеек, задевающих квадрат вокруг центра,
+ * точную проверку расстояния делает вызывающий код.
+ */
+template <typename Id>
+class SpatialGrid {
+public:
+    explicit SpatialGrid(double cell_size) : cell_size_(cell_size) {}
+
+    double GetCellSize() const noexcept {
+        return cell_size_;
+    }
+
+    void Insert(Id id, model::RealCoord pos) {
+        cells_[KeyOf(pos)].push_back(id);
+        ++size_;
+    }
+
+    void Erase(Id id, model::RealCoord pos) {
+        auto it = cells_.find(KeyOf(pos));
+        if (it == cells_.end()) {
+            return;
+        }
+        auto& ids = it->second;
+        if (auto pos_it = std::find(ids.begin(), ids.end(), id); pos_it != ids.end()) {
+            *pos_it = ids.back();
+            ids.pop_back();
+            --size_;
+        }
+        // пустые ячейки не копятся: иначе поиск ходит по ним, а карта растёт со всеми ячейками, где кто-то был
+        if (ids.empty()) {
+            cells_.erase(it);
+        }
+    }
+
+    void Move(Id id, model::RealCoord from, model::RealCoord to) {
+        if (KeyOf(from) == KeyOf(to)) {
+            return;
+        }
+        Erase(id, from);
+        Insert(id, to);
+    }
+
+    void Clear() {
+        cells_.clear();
+        size_ = 0;
+    }
+
+    size_t Size() const noexcept {
+        return size_;
+    }
+
+    // сколько ячеек сейчас хранится
+    size_t CellCount() const noexcept {
+        return cells_.size();
+    }
+
+    // fn(id) вызывается для всех объектов из ячеек, задевающих квадрат [center - radius, center + radius]
+    template <typename Fn>
+    void ForEachCandidate(model::RealCoord center, double radius, Fn&& fn) const {
+        const int64_t min_x = CellOf(center.GetX() - radius);
+        const int64_t max_x = CellOf(center.GetX() + radius);
+        const int64_t min_y = CellOf(center.GetY() - radius);
+        const int64_t max_y = CellOf(center.GetY() + radius);
+
+        for (int64_t x = min_x; x <= max_x; ++x) {
+            for (int64_t y = min_y; y <= max_y; ++y) {
+                auto it = cells_.find(MakeKey(x, y));
+                if (it == cells_.end()) {
+                    continue;
+                }
+                for (const Id& id : it->second) {
+                    fn(id);
+                }
+            }
+        }
+    }
+
+private:
+    int64_t CellOf(double coord) const {
+        return static_cast<int64_t>(std::floor(coord / cell_size_));
+    }
+
+    static uint64_t MakeKey(int64_t x, int64_t y) {
+        return (static_cast<uint64_t>(static_cast<uint32_t>(x)) << 32) | static_cast<uint32_t>(y);
+    }
+
+    uint64_t KeyOf(model::RealCoord pos) const {
+        return MakeKey(CellOf(pos.GetX()), CellOf(pos.GetY()));
+    }
+
+    double cell_size_;
+    std::unordered_map<uint64_t, std::vector<Id>> cells_;
+    size_t size_ = 0;
+};
+
+}  // namespace util
@@ -5,7 +5,10 @@
 #include <boost/asio/strand.hpp>
 #include <boost/system/error_code.hpp>
 
+#include <algorithm>
+#include <atomic>
 #include <chrono>
+#include <exception>
 #include <functional>
 #include <memory>
 #include <cassert>
@@ -13,33 +16,73 @@
 namespace net = boost::asio;
 namespace sys = boost::system;
 
+// Счётчики тикера. Пишутся только из strand тикера, читать можно из любого потока
+// (распределение длительности тика - в game_tick_duration_us из GameSessionManager)
+struct TickerStats {
+    std::atomic<uint64_t> ticks{ 0 };           // сколько раз вызвали обработчик
+    std::atomic<uint64_t> overruns{ 0 };        // тик не уложился в период
+    std::atomic<uint64_t> catch_up_steps{ 0 };  // дополнительные шаги, чтобы догнать время
+    std::atomic<uint64_t> skipped_ticks{ 0 };   // шаги, которые выкинули, потому что догнать не успели
+    std::atomic<uint64_t> errors{ 0 };          // исключения из обработчика
+    std::atomic<int64_t> last_lag_us{ 0 };      // насколько проснулись позже дедлайна
+    std::atomic<int64_t> max_lag_us{ 0 };
+    std::atomic<int64_t> last_tick_us{ 0 };
+
+    void AddTickDuration(std::chrono::microseconds duration) {
+        last_tick_us.store(duration.count(), std::memory_order_relaxed);
+    }
+
+    void SetLag(std::chrono::microseconds lag) {
+        last_lag_us.store(lag.count(), std::memory_order_relaxed);
+        if (lag.count() > max_lag_us.load(std::memory_order_relaxed)) {
+            max_lag_us.store(lag.count(), std::memory_order_relaxed);
+        }
+    }
+};
+
+/*
+ * Тикер с фиксированным шагом.
+ * Дедлайны считаются от момента старта (expires_at), поэтому время работы обработчика
+ * не накапливается в дрейф. Обработчик всегда получает ровно period. Если проснулись поздно,
+ * делаем до max_catch_up_steps шагов подряд, а что не успели - выкидываем и
+ * привязываем расписание к текущему моменту, чтобы не уйти в бесконечную спираль догонялок.
+ */
 class Ticker : public std::enable_shared_from_this<Ticker> {
 public:
     using Strand = net::strand<net::io_context::executor_type>;
     using Handler = std::function<void(std::chrono::milliseconds)>;
+    using ErrorHandler = std::function<void(std::exception_ptr)>;
 
     Ticker(Strand strand,
         std::chrono::milliseconds period,
-        Handler handler)
+        Handler handler,
+        ErrorHandler error_handler = {},
+        int max_catch_up_steps = 5)
         : strand_(std::move(strand))
         , period_(period)
         , timer_(strand_)
-        , handler_(std::move(handler)) {
+        , handler_(std::move(handler))
+        , error_handler_(std::move(error_handler))
+        , max_catch_up_steps_(std::max(1, max_catch_up_steps)) {
     }
 
     void Start() {
-        last_tick_ = Clock::now();
         net::dispatch(strand_, [self = shared_from_this()] {
+            self->next_deadline_ = Clock::now() + self->period_;
             self->ScheduleTick();
             });
     }
 
+    const TickerStats& GetStats() const {
+        return stats_;
+    }
+
 private:
     using Clock = std::chrono::steady_clock;
 
     void ScheduleTick() {
         assert(strand_.running_in_this_thread());
-        timer_.expires_after(period_);
+        timer_.expires_at(next_deadline_);
         timer_.async_wait([self = shared_from_this()](sys::error_code ec) {
             self->OnTick(ec);
             });
@@ -48,16 +91,50 @@ private:
     void OnTick(sys::error_code ec) {
         using namespace std::chrono;
         assert(strand_.running_in_this_thread());
-        if (!ec) {
-            auto now = Clock::now();
-            auto delta = duration_cast<milliseconds>(now - last_tick_);
-            last_tick_ = now;
-            try {
-                handler_(delta);
-            }
-            catch (...) {
+        if (ec) {
+            return;
+        }
+
+        stats_.SetLag(duration_cast<microseconds>(Clock::now() - next_deadline_));
+
+        int steps = 0;
+        while (Clock::now() >= next_deadline_ && steps < max_catch_up_steps_) {
+            RunStep();
+            next_deadline_ += period_;
+            ++steps;
+        }
+        if (steps > 1) {
+            stats_.catch_up_steps.fetch_add(steps - 1, std::memory_order_relaxed);
+        }
+
+        // всё ещё отстаём - пропущенные шаги не навёрстываем
+        if (const auto now = Clock::now(); now >= next_deadline_) {
+            const auto behind = (now - next_deadline_) / period_ + 1;
+            stats_.skipped_ticks.fetch_add(static_cast<uint64_t>(behind), std::memory_order_relaxed);
+            next_deadline_ += behind * period_;
+        }
+        ScheduleTick();
+    }
+
+    void RunStep() {
+        using namespace std::chrono;
+        const auto started = Clock::now();
+        try {
+            handler_(period_);
+        }
+        catch (...) {
+            // тик не должен ронять сервер, но и молча терять ошибку нельзя
+            stats_.errors.fetch_add(1, std::memory_order_relaxed);
+            if (error_handler_) {
+                error_handler_(std::current_exception());
             }
-            ScheduleTick();
+        }
+        const auto duration = duration_cast<microseconds>(Clock::now() - started);
+
+        stats_.ticks.fetch_add(1, std::memory_order_relaxed);
+        stats_.AddTickDuration(duration);
+        if (duration > period_) {
+            stats_.overruns.fetch_add(1, std::memory_order_relaxed);
         }
     }
 
@@ -65,5 +142,8 @@ private:
     std::chrono::milliseconds period_;
     net::steady_timer timer_;
     Handler handler_;
-    Clock::time_point last_tick_;
+    ErrorHandler error_handler_;
+    int max_catch_up_steps_;
+    Clock::time_point next_deadline_;
+    TickerStats stats_;
 };
@@ -0,0 +1,78 @@
+#include "timer_wheel.h"
+
+#include <algorithm>
+#include <utility>
+
+namespace http_server {
+
+void TimerWheel::Schedule(Entry& entry, uint64_t expires) {
+    if (entry.scheduled_) {
+        Unlink(entry);
+    }
+    entry.expires_ = std::min(expires, current_ + MAX_DELAY);
+    // текущий тик уже обработан, просроченное срабатывает на следующем
+    Link(entry, current_ + 1);
+}
+
+void TimerWheel::Cancel(Entry& entry) noexcept {
+    if (entry.scheduled_) {
+        Unlink(entry);
+    }
+}
+
+void TimerWheel::Link(Entry& entry, uint64_t earliest) {
+    const uint64_t expires = std::max(entry.expires_, earliest);
+    const uint64_t delay = expires - current_;
+
+    int level = 0;
+    while (level + 1 < LEVELS && delay >= (uint64_t{ 1 } << (SLOT_BITS * (level + 1)))) {
+        ++level;
+    }
+    const size_t slot = (expires >> (SLOT_BITS * level)) & (SLOTS - 1);
+
+    Entry*& head = slots_[level][slot];
+    entry.level_ = static_cast<uint8_t>(level);
+    entry.slot_ = static_cast<uint8_t>(slot);
+    entry.prev_ = nullptr;
+    entry.next_ = head;
+    if (head) {
+        head->prev_ = &entry;
+    }
+    head = &entry;
+    entry.scheduled_ = true;
+    ++size_;
+}
+
+void TimerWheel::Unlink(Entry& entry) noexcept {
+    if (entry.prev_) {
+        entry.prev_->next_ = entry.next_;
+    }
+    else {
+        slots_[entry.level_][entry.slot_] = entry.next_;
+    }
+    if (entry.next_) {
+        entry.next_->prev_ = entry.prev_;
+    }
+    entry.prev_ = entry.next_ = nullptr;
+    entry.scheduled_ = false;
+    --size_;
+}
+
+bool TimerWheel::Cascade(int level) {
+    // нижние разряды текущего тика не обнулились - до этого уровня ещё не дошли
+    if ((current_ & ((uint64_t{ 1 } << (SLOT_BITS * level)) - 1)) != 0) {
+        return false;
+    }
+    const size_t slot = (current_ >> (SLOT_BITS * level)) & (SLOTS - 1);
+    Entry* entry = std::exchange(slots_[level][slot], nullptr);
+    while (entry) {
+        Entry* next = entry->next_;
+        --size_;
+        // ячейка уровня 0 для текущего тика ещё не разобрана, срок "сейчас" попадёт в неё
+        Link(*entry, current_);
+        entry = next;
+    }
+    return slot == 0;
+}
+
+}  // namespace http_server
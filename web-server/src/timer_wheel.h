@@ -0,0 +1,110 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+
+namespace http_server {
+
+/*
+ * Иерархическое колесо таймеров с грубым шагом (тиком).
+ * LEVELS уровней по SLOTS ячеек: уровень 0 покрывает ближайшие SLOTS тиков, каждый следующий - в SLOTS раз больше.
+ * Запись кладётся на уровень по тому, как далеко её срок, и спускается ниже, когда до неё доходит колесо.
+ * Поставить, переставить и снять запись - O(1), без выделения памяти: записи интрузивные, их хранит владелец.
+ * Потокобезопасности нет, синхронизирует вызывающий.
+ */
+class TimerWheel {
+public:
+    static constexpr int SLOT_BITS = 6;
+    static constexpr size_t SLOTS = size_t{ 1 } << SLOT_BITS;
+    static constexpr int LEVELS = 4;
+    // дальше этого срок обрезается
+    static constexpr uint64_t MAX_DELAY = (uint64_t{ 1 } << (SLOT_BITS * LEVELS)) - 1;
+
+    class Entry {
+    public:
+        Entry() = default;
+        Entry(const Entry&) = delete;
+        Entry& operator=(const Entry&) = delete;
+
+        bool IsScheduled() const {
+            return scheduled_;
+        }
+
+        uint64_t GetExpires() const {
+            return expires_;
+        }
+
+    private:
+        friend class TimerWheel;
+
+        Entry* prev_ = nullptr;
+        Entry* next_ = nullptr;
+        uint64_t expires_ = 0;
+        uint8_t level_ = 0;
+        uint8_t slot_ = 0;
+        bool scheduled_ = false;
+    };
+
+    explicit TimerWheel(uint64_t current_tick = 0)
+        : current_(current_tick) {
+    }
+
+    TimerWheel(const TimerWheel&) = delete;
+    TimerWheel& operator=(const TimerWheel&) = delete;
+
+    // срок - абсолютный номер тика; уже прошедший срок сработает на следующем Advance.
+    // Если запись уже стоит в колесе, она переставляется
+    void Schedule(Entry& entry, uint64_t expires);
+    void Cancel(Entry& entry) noexcept;
+
+    // прокручивает колесо до тика now включительно; истёкшие записи снимаются и отдаются on_expired.
+    // Внутри on_expired запись можно поставить заново
+    template <typename Fn>
+    void Advance(uint64_t now, Fn&& on_expired);
+
+    uint64_t GetCurrentTick() const {
+        return current_;
+    }
+
+    size_t Size() const {
+        return size_;
+    }
+
+private:
+    // earliest - самый ранний тик, в который запись ещё может сработать
+    void Link(Entry& entry, uint64_t earliest);
+    void Unlink(Entry& entry) noexcept;
+    // переносит записи ячейки уровня level на нижние уровни; true, если индекс ячейки 0 и надо спускаться с уровня выше
+    bool Cascade(int level);
+
+    std::array<std::array<Entry*, SLOTS>, LEVELS> slots_{};
+    uint64_t current_ = 0;
+    size_t size_ = 0;
+};
+
+template <typename Fn>
+void TimerWheel::Advance(uint64_t now, Fn&& on_expired) {
+    if (size_ == 0 && now > current_) {
+        current_ = now;
+        return;
+    }
+    while (current_ < now) {
+        ++current_;
+        for (int level = 1; level < LEVELS && Cascade(level); ++level) {
+        }
+
+        Entry* entry = std::exchange(slots_[0][current_ & (SLOTS - 1)], nullptr);
+        while (entry) {
+            Entry* next = entry->next_;
+            entry->prev_ = entry->next_ = nullptr;
+            entry->scheduled_ = false;
+            --size_;
+            on_expired(*entry);
+            entry = next;
+        }
+    }
+}
+
+}  // namespace http_server
@@ -0,0 +1,152 @@
+#include "tracing.h"
+
+#include <boost/json.hpp>
+
+#include <algorithm>
+
+namespace tracing {
+
+static constexpr std::string_view TRACE_EVENTS_S = "traceEvents";
+static constexpr std::string_view NAME_S = "name";
+static constexpr std::string_view PH_S = "ph";
+static constexpr std::string_view COMPLETE_EVENT_S = "X";
+static constexpr std::string_view TS_S = "ts";
+static constexpr std::string_view DUR_S = "dur";
+static constexpr std::string_view PID_S = "pid";
+static constexpr std::string_view TID_S = "tid";
+static constexpr std::string_view DISPLAY_TIME_UNIT_S = "displayTimeUnit";
+
+std::vector<TraceEvent> ThreadBuffer::Snapshot(uint64_t from) const {
+    const uint64_t head = Head();
+    uint64_t first = head > CAPACITY ? head - CAPACITY : 0;
+    first = std::max(first, from);
+
+    std::vector<TraceEvent> result;
+    result.reserve(head - first);
+    for (uint64_t i = first; i < head; ++i) {
+        const Slot& slot = slots_[i % CAPACITY];
+        if (slot.sequence.load(std::memory_order_acquire) != i) {
+            continue;
+        }
+        TraceEvent event{
+            .name = slot.name.load(std::memory_order_relaxed),
+            .start_us = slot.start_us.load(std::memory_order_relaxed),
+            .duration_us = slot.duration_us.load(std::memory_order_relaxed),
+            .tid = tid_
+        };
+        // поля читались, пока владелец мог уже писать следующее событие в этот слот:
+        // барьер не даёт повторной проверке номера обогнать чтение полей
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (slot.sequence.load(std::memory_order_relaxed) != i) {
+            continue;
+        }
+        result.push_back(event);
+    }
+    return result;
+}
+
+Tracer& Tracer::Instance() {
+    static Tracer tracer;
+    return tracer;
+}
+
+void Tracer::SetSlowTickBudget(std::chrono::microseconds budget, size_t max_ticks) {
+    std::lock_guard lock(slow_ticks_mutex_);
+    slow_tick_budget_ = budget;
+    max_slow_ticks_ = max_ticks;
+    while (slow_ticks_.size() > max_slow_ticks_) {
+        slow_ticks_.pop_front();
+    }
+}
+
+ThreadBuffer& Tracer::LocalBuffer() {
+    // буфер регистрируется один раз на поток, дальше запись идёт без блокировок.
+    // Трейсер держит shared_ptr, поэтому события переживают завершение потока
+    thread_local std::shared_ptr<ThreadBuffer> local = [this] {
+        std::lock_guard lock(buffers_mutex_);
+        auto buffer = std::make_shared<ThreadBuffer>(static_cast<uint32_t>(buffers_.size() + 1));
+        buffers_.push_back(buffer);
+        return buffer;
+    }();
+    return *local;
+}
+
+int64_t Tracer::ToMicroseconds(Clock::time_point time) const {
+    return std::chrono::duration_cast<std::chrono::microseconds>(time - epoch_).count();
+}
+
+void Tracer::Record(const char* name, Clock::time_point start, Clock::time_point end) {
+    LocalBuffer().Push(name, ToMicroseconds(start), ToMicroseconds(end) - ToMicroseconds(start));
+}
+
+uint64_t Tracer::BeginTick() {
+    return LocalBuffer().Head();
+}
+
+void Tracer::EndTick(uint64_t begin, Clock::time_point start, Clock::time_point end) {
+    Record("tick", start, end);
+
+    std::lock_guard lock(slow_ticks_mutex_);
+    if (slow_tick_budget_.count() <= 0 || max_slow_ticks_ == 0 || end - start <= slow_tick_budget_) {
+        return;
+    }
+    // все фазы тика выполнялись в этом же потоке, поэтому лежат в его буфере подряд
+    slow_ticks_.push_back(LocalBuffer().Snapshot(begin));
+    if (slow_ticks_.size() > max_slow_ticks_) {
+        slow_ticks_.pop_front();
+    }
+}
+
+static boost::json::object ToChromeEvent(const TraceEvent& event) {
+    boost::json::object obj;
+    obj[NAME_S] = event.name;
+    obj[PH_S] = COMPLETE_EVENT_S;
+    obj[TS_S] = event.start_us;
+    obj[DUR_S] = event.duration_us;
+    obj[PID_S] = 1;
+    obj[TID_S] = event.tid;
+    return obj;
+}
+
+std::string Tracer::DumpChromeTrace() const {
+    std::vector<std::shared_ptr<ThreadBuffer>> buffers;
+    {
+        std::lock_guard lock(buffers_mutex_);
+        buffers = buffers_;
+    }
+
+    boost::json::array events;
+    for (const auto& buffer : buffers) {
+        for (const TraceEvent& event : buffer->Snapshot()) {
+            events.push_back(ToChromeEvent(event));
+        }
+    }
+
+    boost::json::object root;
+    root[TRACE_EVENTS_S] = std::move(events);
+    root[DISPLAY_TIME_UNIT_S] = "ms";
+    return boost::json::serialize(root);
+}
+
+std::string Tracer::DumpSlowTicks() const {
+    // под мьютексом только копия: его же берёт поток игры в конце медленного тика
+    decltype(slow_ticks_) ticks;
+    {
+        std::lock_guard lock(slow_ticks_mutex_);
+        ticks = slow_ticks_;
+    }
+
+    boost::json::array events;
+    for (const auto& tick : ticks) {
+        for (const TraceEvent& event : tick) {
+            events.push_back(ToChromeEvent(event));
+        }
+    }
+
+    boost::json::object root;
+    root[TRACE_EVENTS_S] = std::move(events);
+    root[DISPLAY_TIME_UNIT_S] = "ms";
+    return boost::json::serialize(root);
+}
+
+}  // namespace tracing
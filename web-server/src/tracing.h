@@ -0,0 +1,168 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace tracing {
+
+using Clock = std::chrono::steady_clock;
+
+// name - только строковые литералы, указатель хранится как есть
+struct TraceEvent {
+    const char* name = nullptr;
+    int64_t start_us = 0;
+    int64_t duration_us = 0;
+    uint32_t tid = 0;
+};
+
+/*
+ * Кольцевой буфер событий одного потока.
+ * Пишет только поток-владелец, без блокировок. Читать можно из любого потока:
+ * у каждого слота свой номер события (seqlock на слот) - на время записи он сбрасывается,
+ * и читатель отбрасывает слот, если номер до и после копирования не тот, что он ждал.
+ */
+class ThreadBuffer {
+public:
+    static constexpr size_t CAPACITY = 4096;
+
+    explicit ThreadBuffer(uint32_t tid) : tid_(tid) {}
+
+    void Push(const char* name, int64_t start_us, int64_t duration_us) {
+        const uint64_t head = head_.load(std::memory_order_relaxed);
+        Slot& slot = slots_[head % CAPACITY];
+        // сначала слот помечается занятым, и только потом (после барьера) меняются поля
+        slot.sequence.store(NO_EVENT, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        slot.name.store(name, std::memory_order_relaxed);
+        slot.start_us.store(start_us, std::memory_order_relaxed);
+        slot.duration_us.store(duration_us, std::memory_order_relaxed);
+        slot.sequence.store(head, std::memory_order_release);
+        head_.store(head + 1, std::memory_order_release);
+    }
+
+    uint64_t Head() const {
+        return head_.load(std::memory_order_acquire);
+    }
+
+    uint32_t GetTid() const {
+        return tid_;
+    }
+
+    // события с номерами [from, Head()), которые ещё лежат в буфере
+    std::vector<TraceEvent> Snapshot(uint64_t from = 0) const;
+
+private:
+    static constexpr uint64_t NO_EVENT = UINT64_MAX;
+
+    struct Slot {
+        std::atomic<uint64_t> sequence{ NO_EVENT };     // номер события в слоте, NO_EVENT - пуст или пишется
+        std::atomic<const char*> name{ nullptr };
+        std::atomic<int64_t> start_us{ 0 };
+        std::atomic<int64_t> duration_us{ 0 };
+    };
+
+    uint32_t tid_;
+    std::array<Slot, CAPACITY> slots_;
+    std::atomic<uint64_t> head_{ 0 };
+};
+
+class Tracer {
+public:
+    static Tracer& Instance();
+
+    void SetEnabled(bool enabled) {
+        enabled_.store(enabled, std::memory_order_relaxed);
+    }
+
+    bool IsEnabled() const {
+        return enabled_.load(std::memory_order_relaxed);
+    }
+
+    // тики дольше budget попадают в "бортовой самописец", хранится не больше max_ticks последних
+    void SetSlowTickBudget(std::chrono::microseconds budget, size_t max_ticks);
+
+    void Record(const char* name, Clock::time_point start, Clock::time_point end);
+
+    // номер первого события тика в буфере текущего потока
+    uint64_t BeginTick();
+    void EndTick(uint64_t begin, Clock::time_point start, Clock::time_point end);
+
+    // JSON в формате Chrome trace_event (открывается в chrome://tracing и Perfetto)
+    std::string DumpChromeTrace() const;
+    std::string DumpSlowTicks() const;
+
+private:
+    Tracer() = default;
+
+    ThreadBuffer& LocalBuffer();
+    int64_t ToMicroseconds(Clock::time_point time) const;
+
+    std::atomic<bool> enabled_{ false };
+    const Clock::time_point epoch_ = Clock::now();
+
+    mutable std::mutex buffers_mutex_;
+    std::vector<std::shared_ptr<ThreadBuffer>> buffers_;
+
+    mutable std::mutex slow_ticks_mutex_;
+    std::chrono::microseconds slow_tick_budget_{ 0 };
+    size_t max_slow_ticks_ = 16;
+    std::deque<std::vector<TraceEvent>> slow_ticks_;
+};
+
+// замер участка кода: при выключенной трассировке стоит одну проверку флага
+class ScopedTrace {
+public:
+    explicit ScopedTrace(const char* name)
+        : name_(Tracer::Instance().IsEnabled() ? name : nullptr) {
+        if (name_) {
+            start_ = Clock::now();
+        }
+    }
+
+    ~ScopedTrace() {
+        if (name_) {
+            Tracer::Instance().Record(name_, start_, Clock::now());
+        }
+    }
+
+    ScopedTrace(const ScopedTrace&) = delete;
+    ScopedTrace& operator=(const ScopedTrace&) = delete;
+
+private:
+    const char* name_;
+    Clock::time_point start_;
+};
+
+// замер целого тика, медленные тики вместе со всеми фазами уходят в самописец
+class TickTrace {
+public:
+    TickTrace() : enabled_(Tracer::Instance().IsEnabled()) {
+        if (enabled_) {
+            begin_ = Tracer::Instance().BeginTick();
+            start_ = Clock::now();
+        }
+    }
+
+    ~TickTrace() {
+        if (enabled_) {
+            Tracer::Instance().EndTick(begin_, start_, Clock::now());
+        }
+    }
+
+    TickTrace(const TickTrace&) = delete;
+    TickTrace& operator=(const TickTrace&) = delete;
+
+private:
+    bool enabled_;
+    uint64_t begin_ = 0;
+    Clock::time_point start_;
+};
+
+}  // namespace tracing
@@ -0,0 +1,117 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include "../src/request_handler.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace {
+
+using namespace std::literals;
+namespace http = boost::beast::http;
+
+class NullRepository final : public postgres::RetiredPlayersRepository {
+public:
+    void EnsureSchema() override {}
+    void Add(const postgres::RetiredRecord&) override {}
+    std::vector<postgres::RetiredRecord> Get(int, int) override {
+        return {};
+    }
+};
+
+// игра с одной картой, менеджер и обработчик API со сжатием
+struct ApiFixture {
+    ApiFixture() {
+        model::Map map(map_id, "Map");
+        map.AddRoad(model::Road(model::Road::HORIZONTAL, model::Point{ 0, 0 }, 100));
+        game.AddMap(map);
+        loot_map.emplace(map_id, std::vector<extra_data::LootType>{});
+        handler.SetCompression(http_server::CompressionSettings{ .level = 6, .min_size = 1024 });
+    }
+
+    http_handler::StringResponse Get(std::string_view target, const app::Token& token, std::string_view accept_encoding) {
+        http::request<http::string_body> req{ http::verb::get, target, 11 };
+        req.set(http::field::authorization, "Bearer "s + *token);
+        req.set(http::field::accept_encoding, accept_encoding);
+        http_handler::StringResponse result;
+        handler(std::move(req), [&result](http_handler::StringResponse&& res) {
+            result = std::move(res);
+            });
+        return result;
+    }
+
+    model::Map::Id map_id{ "map1"s };
+    model::Game game;
+    LootMap loot_map;
+    loot_gen::LootGenerator generator{ loot_gen::LootGenerator::TimeInterval{ 1000 }, 0.0 };
+    NullRepository repository;
+    app::GameSessionManager manager{ game, loot_map, generator, /*is_random_dog_position=*/false, 100, repository };
+    http_handler::ApiRequestHandler handler{ game, "", manager, /*is_manual_tick_allowed=*/true };
+};
+
+}  // namespace
+
+TEST_CASE("Cached game state compressed below the threshold still carries Vary") {
+    ApiFixture fixture;
+    app::Token token{ ""s };
+    // состояние одинаковых собак хорошо жмётся: несжатое выше порога, сжатое - ниже
+    for (int i = 0; i < 30; ++i) {
+        token = fixture.manager.AddDogToMap("dog"s, fixture.map_id).first;
+    }
+
+    for (int request = 0; request < 2; ++request) {    // промах и попадание в кэш состояния
+        const auto res = fixture.Get("/api/v1/game/state", token, "gzip");
+        REQUIRE(res.result() == http::status::ok);
+        REQUIRE(res[http::field::content_encoding] == "gzip");
+        REQUIRE(res.body().size() < 1024);
+        REQUIRE(res[http::field::vary] == "Accept-Encoding");
+    }
+
+    // тот же ответ без сжатия: выше порога, тоже с Vary
+    const auto identity = fixture.Get("/api/v1/game/state", token, "identity");
+    REQUIRE(identity.count(http::field::content_encoding) == 0);
+    REQUIRE(identity.body().size() >= 1024);
+    REQUIRE(identity[http::field::vary] == "Accept-Encoding");
+}
+
+TEST_CASE("Rotating fake tokens from one IP stays within the IP rate limit") {
+    ApiFixture fixture;
+    boost::asio::io_context ioc;
+    auto handler = std::make_shared<http_handler::RequestHandler>(fixture.game, "", boost::asio::make_strand(ioc)
+        , fixture.manager, /*is_manual_tick_allowed=*/true);
+    handler->SetRateLimit(1, 2);    // ведро IP - 8 раз по столько же
+
+    int rejected = 0;
+    auto send_from = [&](std::string_view ip, std::string authorization) {
+        http::request<http::string_body> req{ http::verb::get, "/api/v1/game/state", 11 };
+        req.set(http::field::authorization, authorization);
+        (*handler)(std::move(req), [&rejected](auto&& res) {
+            rejected += res.result() == http::status::too_many_requests;
+            }, std::string(ip));
+    };
+
+    // каждый запрос с новым токеном правильной формы
+    constexpr int REQUESTS = 50;
+    for (int i = 0; i < REQUESTS; ++i) {
+        std::string token(32, '0');
+        const std::string n = std::to_string(i);
+        token.replace(token.size() - n.size(), n.size(), n);
+        send_from("10.0.0.1", "Bearer " + token);
+    }
+    REQUIRE(REQUESTS - rejected <= 16);
+
+    // кривой токен своего ведра не получает: сразу общее ведро IP
+    rejected = 0;
+    for (int i = 0; i < 5; ++i) {
+        send_from("10.0.0.2", "Bearer fake-" + std::to_string(i));
+    }
+    REQUIRE(5 - rejected <= 2);
+
+    // соседний IP лимит первого не задевает
+    rejected = 0;
+    send_from("10.0.0.3", "Bearer "s + std::string(32, 'a'));
+    REQUIRE(rejected == 0);
+
+    ioc.run();  // пропущенные запросы доходят до api_strand и получают 401
+}
@@ -0,0 +1,88 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include "../src/async_log.h"
+
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std::chrono_literals;
+
+TEST_CASE("BoundedQueue refuses pushes when full") {
+    async_log::BoundedQueue<int> queue(4);
+    REQUIRE(queue.Capacity() == 4);
+
+    for (int i = 0; i < 4; ++i) {
+        int value = i;
+        REQUIRE(queue.TryPush(value));
+    }
+    int extra = 100;
+    REQUIRE_FALSE(queue.TryPush(extra));
+
+    for (int i = 0; i < 4; ++i) {
+        REQUIRE(queue.TryPop() == i);
+    }
+    REQUIRE_FALSE(queue.TryPop().has_value());
+}
+
+TEST_CASE("AsyncLogSink writes lines from many threads and counts drops") {
+    std::ostringstream out;
+    uint64_t accepted = 0;
+    uint64_t dropped = 0;
+    {
+        async_log::AsyncLogSink sink(out, 1024);
+        std::vector<std::thread> writers;
+        std::atomic<uint64_t> ok{ 0 };
+        for (int t = 0; t < 4; ++t) {
+            writers.emplace_back([&sink, &ok] {
+                for (int i = 0; i < 1000; ++i) {
+                    if (sink.TryWrite("line\n")) {
+                        ++ok;
+                    }
+                }
+                });
+        }
+        for (auto& writer : writers) {
+            writer.join();
+        }
+        sink.Stop();
+        accepted = ok;
+        dropped = sink.GetDropped();
+        REQUIRE(sink.GetWritten() == accepted);
+    }
+    REQUIRE(accepted + dropped == 4000);
+
+    size_t lines = 0;
+    for (char c : out.str()) {
+        lines += c == '\n';
+    }
+    REQUIRE(lines == accepted);
+}
+
+TEST_CASE("SamplingConfig keeps errors and slow responses") {
+    const auto config = async_log::SamplingConfig::Parse({ "/api/v1/game/state=0" }, 1.0, 50ms);
+
+    REQUIRE(config.RateFor("/api/v1/game/state") == 0.0);
+    REQUIRE(config.RateFor("/api/v1/game/join") == 1.0);
+    REQUIRE_FALSE(config.ShouldSample("/api/v1/game/state"));
+    REQUIRE(config.ShouldSample("/api/v1/game/join"));
+
+    REQUIRE_FALSE(config.MustKeep(200, 1ms));
+    REQUIRE(config.MustKeep(404, 1ms));
+    REQUIRE(config.MustKeep(200, 50ms));
+
+    REQUIRE_THROWS(async_log::SamplingConfig::Parse({ "no-rate" }, 1.0, 50ms));
+}
+
+TEST_CASE("JsonLine builds escaped JSON without DOM") {
+    std::string line = async_log::JsonLine()
+        .Field("URI", "/a\"b")
+        .Field("code", int64_t{ 200 })
+        .NullField("content_type")
+        .Finish("response sent");
+
+    REQUIRE(line.starts_with("{\"timestamp\":\""));
+    REQUIRE(line.find(",\"data\":{\"URI\":\"/a\\\"b\",\"code\":200,\"content_type\":null},\"message\":\"response sent\"}\n")
+        != std::string::npos);
+}
@@ -9,6 +9,7 @@
 
 #include <vector>
 #include <cmath>
+#include <random>
 #include <sstream>
 
 
@@ -171,4 +172,60 @@ TEST_CASE("Correct time and distance for off-path collision") {
     REQUIRE(ev.gatherer_id == 0);
     REQUIRE(ev.sq_distance == Approx(1.0).margin(1e-10));
     REQUIRE(ev.time == Approx(0.5).margin(1e-10));
-}
\ No newline at end of file
+}
+
+TEST_CASE("Batch FindGatherEvents matches TryCollectPoint on random data") {
+    std::mt19937 rng(12345);
+    std::uniform_real_distribution<double> coord(-10.0, 10.0);
+    std::uniform_real_distribution<double> width(0.0, 1.0);
+
+    // число предметов не кратно 4, чтобы задеть и векторную часть, и хвост
+    for (size_t items_count : { 0, 1, 3, 4, 7, 61 }) {
+        GathererBatch gatherers;
+        ItemBatch items;
+        std::vector<Gatherer> gatherer_list;
+        std::vector<Item> item_list;
+        for (int i = 0; i < 9; ++i) {
+            Gatherer g{ { coord(rng), coord(rng) }, { coord(rng), coord(rng) }, width(rng) };
+            // один стоит на месте
+            if (i == 4) {
+                g.end_pos = g.start_pos;
+            }
+            gatherers.Add(g);
+            gatherer_list.push_back(g);
+        }
+        for (size_t i = 0; i < items_count; ++i) {
+            Item item{ { coord(rng), coord(rng) }, width(rng) * 3 };
+            items.Add(item);
+            item_list.push_back(item);
+        }
+
+        std::vector<GatheringEvent> expected;
+        for (size_t g = 0; g < gatherer_list.size(); ++g) {
+            const Gatherer& gatherer = gatherer_list[g];
+            if (gatherer.start_pos.GetX() == gatherer.end_pos.GetX()
+                && gatherer.start_pos.GetY() == gatherer.end_pos.GetY()) {
+                continue;
+            }
+            for (size_t i = 0; i < item_list.size(); ++i) {
+                const auto result = TryCollectPoint(gatherer.start_pos, gatherer.end_pos, item_list[i].position);
+                if (result.IsCollected(gatherer.width + item_list[i].width)) {
+                    expected.push_back(GatheringEvent{ i, g, result.sq_distance, result.proj_ratio });
+                }
+            }
+        }
+
+        const auto events = FindGatherEvents(gatherers, items);
+        REQUIRE(events.size() == expected.size());
+        for (const GatheringEvent& event : expected) {
+            const auto it = std::find_if(events.begin(), events.end(), [&event](const GatheringEvent& e) {
+                return e.item_id == event.item_id && e.gatherer_id == event.gatherer_id;
+                });
+            REQUIRE(it != events.end());
+            REQUIRE(EqualEvents(*it, event));
+        }
+        for (size_t i = 1; i < events.size(); ++i) {
+            REQUIRE(events[i - 1].time <= events[i].time);
+        }
+    }
+}
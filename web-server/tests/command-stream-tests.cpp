@@ -0,0 +1,140 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include "../src/command_stream.h"
+
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace std::literals;
+
+namespace {
+
+class NullRepository final : public postgres::RetiredPlayersRepository {
+public:
+    void EnsureSchema() override {
+    }
+
+    void Add(const postgres::RetiredRecord&) override {
+    }
+
+    std::vector<postgres::RetiredRecord> Get(int, int) override {
+        return {};
+    }
+};
+
+// игра с двумя картами, лут появляется каждую секунду, спавн случайный
+struct TestGame {
+    TestGame() {
+        for (const auto& id : { "a"s, "b"s }) {
+            model::Map map(model::Map::Id(id), id);
+            map.AddRoad(model::Road(model::Road::HORIZONTAL, model::Point{ 0, 0 }, 50));
+            map.AddRoad(model::Road(model::Road::VERTICAL, model::Point{ 50, 0 }, 50));
+            game.AddMap(map);
+            loot_map[model::Map::Id(id)].emplace_back(boost::json::object{ { "name", "key" }, { "value", 1 } });
+        }
+    }
+
+    std::unique_ptr<app::GameSessionManager> MakeManager(uint64_t seed) {
+        auto manager = std::make_unique<app::GameSessionManager>(game, loot_map, generator, true, 1e6, repository);
+        manager->SetRandomSeed(seed);
+        return manager;
+    }
+
+    model::Game game;
+    LootMap loot_map;
+    loot_gen::LootGenerator generator{ loot_gen::LootGenerator::TimeInterval{ 1000 }, 1.0 };
+    NullRepository repository;
+};
+
+// всё, что видно клиенту: позиции собак и лута по картам
+std::vector<double> Snapshot(app::GameSessionManager& manager, const model::Game& game) {
+    std::vector<double> values;
+    for (const model::Map& map : game.GetMaps()) {
+        app::GameSession* session = manager.GetSessionByMapId(map.GetId());
+        if (!session) {
+            continue;
+        }
+        for (const model::Dog& dog : session->GetDogs()) {
+            values.push_back(dog.GetPosition().GetX());
+            values.push_back(dog.GetPosition().GetY());
+        }
+        for (const model::LostObject& item : session->GetLostObjects()) {
+            values.push_back(item.pos.GetX());
+            values.push_back(item.pos.GetY());
+            values.push_back(item.type);
+        }
+    }
+    return values;
+}
+
+}  // namespace
+
+TEST_CASE("Commands survive a write/read round trip") {
+    const std::vector<app::Command> commands = {
+        app::JoinCommand{ "map1", "Rex the dog" },
+        app::MoveCommand{ 0, "L" },
+        app::MoveCommand{ 0, "" },
+        app::TickCommand{ 50 },
+    };
+    std::stringstream stream;
+    for (const auto& command : commands) {
+        app::WriteCommand(stream, command);
+    }
+
+    const auto read = app::ReadCommands(stream);
+    REQUIRE(read.size() == commands.size());
+    CHECK(std::get<app::JoinCommand>(read[0]).map_id == "map1");
+    CHECK(std::get<app::JoinCommand>(read[0]).name == "Rex the dog");
+    CHECK(std::get<app::MoveCommand>(read[1]).move == "L");
+    CHECK(std::get<app::MoveCommand>(read[2]).player == 0);
+    CHECK(std::get<app::MoveCommand>(read[2]).move.empty());
+    CHECK(std::get<app::TickCommand>(read[3]).ms == 50);
+
+    std::istringstream broken("T 50\nX 1\n");
+    CHECK_THROWS_AS(app::ReadCommands(broken), std::runtime_error);
+}
+
+TEST_CASE("Same seed and commands give the same game") {
+    TestGame game;
+    const auto commands = app::MakeSyntheticCommands(game.game, 20, 200, 50, 7);
+
+    auto first = game.MakeManager(1);
+    auto second = game.MakeManager(1);
+    app::ReplayCommands(*first, commands);
+    const auto stats = app::ReplayCommands(*second, commands);
+
+    CHECK(stats.ticks == 200);
+    CHECK(stats.joins == 20);
+    const auto snapshot = Snapshot(*first, game.game);
+    CHECK(snapshot.size() > 40);
+    CHECK(snapshot == Snapshot(*second, game.game));
+
+    auto other_seed = game.MakeManager(2);
+    app::ReplayCommands(*other_seed, commands);
+    CHECK(snapshot != Snapshot(*other_seed, game.game));
+}
+
+TEST_CASE("Recorded live commands replay to the same game") {
+    TestGame game;
+    std::stringstream record;
+    app::CommandRecorder recorder(record);
+
+    auto live = game.MakeManager(3);
+    live->SetRecorder(&recorder);
+    const auto [rex, rex_id] = live->AddDogToMap("Rex", model::Map::Id("a"s));
+    const auto [bim, bim_id] = live->AddDogToMap("Bim", model::Map::Id("b"s));
+    live->SetMoveDog(live->FindPlayerByToken(rex), "R");
+    live->ProcessTick(700);
+    live->SetMoveDog(live->FindPlayerByToken(bim), "U");
+    live->SetMoveDog(live->FindPlayerByToken(rex), "D");
+    live->ProcessTick(1300);
+    live->SetRecorder(nullptr);
+
+    auto replayed = game.MakeManager(3);
+    const auto stats = app::ReplayCommands(*replayed, app::ReadCommands(record));
+    CHECK(stats.joins == 2);
+    CHECK(stats.moves == 3);
+    CHECK(stats.ticks == 2);
+    CHECK(Snapshot(*replayed, game.game) == Snapshot(*live, game.game));
+}
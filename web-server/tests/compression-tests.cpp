@@ -0,0 +1,63 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include "../src/compression.h"
+
+#include <zlib.h>
+
+#include <string>
+
+using http_server::ContentCoding;
+using http_server::SelectContentCoding;
+
+namespace {
+
+std::string Inflate(const std::string& data, int window_bits) {
+    z_stream stream{};
+    REQUIRE(inflateInit2(&stream, window_bits) == Z_OK);
+    std::string result(1 << 20, '\0');
+    stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data.data()));
+    stream.avail_in = static_cast<uInt>(data.size());
+    stream.next_out = reinterpret_cast<Bytef*>(result.data());
+    stream.avail_out = static_cast<uInt>(result.size());
+    const int status = inflate(&stream, Z_FINISH);
+    result.resize(stream.total_out);
+    inflateEnd(&stream);
+    REQUIRE(status == Z_STREAM_END);
+    return result;
+}
+
+}  // namespace
+
+TEST_CASE("Content coding follows Accept-Encoding") {
+    CHECK(SelectContentCoding("") == ContentCoding::IDENTITY);
+    CHECK(SelectContentCoding("gzip") == ContentCoding::GZIP);
+    CHECK(SelectContentCoding("deflate, gzip") == ContentCoding::GZIP);
+    CHECK(SelectContentCoding("gzip, deflate, br") == ContentCoding::GZIP);
+    CHECK(SelectContentCoding("deflate") == ContentCoding::DEFLATE);
+    CHECK(SelectContentCoding("GZip;q=0.5, deflate") == ContentCoding::DEFLATE);
+    CHECK(SelectContentCoding("gzip;q=0, deflate;q=0") == ContentCoding::IDENTITY);
+    CHECK(SelectContentCoding("br, *;q=0.1") == ContentCoding::GZIP);
+    CHECK(SelectContentCoding("*;q=0.5, gzip;q=0") == ContentCoding::DEFLATE);
+    CHECK(SelectContentCoding("identity, br") == ContentCoding::IDENTITY);
+    CHECK(SelectContentCoding("gzip;q=abc") == ContentCoding::IDENTITY);
+}
+
+TEST_CASE("Compressed bodies inflate back") {
+    std::string json;
+    for (int i = 0; i < 500; ++i) {
+        json += R"({"pos":[)" + std::to_string(i) + R"(.5,0.0],"speed":[0.0,0.0],"dir":"U","bag":[],"score":0},)";
+    }
+
+    const std::string gzip = http_server::Compress(json, ContentCoding::GZIP, 6);
+    const std::string deflate = http_server::Compress(json, ContentCoding::DEFLATE, 1);
+    CHECK(gzip.size() < json.size() / 4);
+    CHECK(deflate.size() < json.size() / 4);
+    // заголовок gzip
+    CHECK(static_cast<unsigned char>(gzip[0]) == 0x1f);
+    CHECK(static_cast<unsigned char>(gzip[1]) == 0x8b);
+
+    CHECK(Inflate(gzip, 15 + 16) == json);
+    CHECK(Inflate(deflate, 15) == json);
+    CHECK(Inflate(http_server::Compress("", ContentCoding::GZIP, 9), 15 + 16).empty());
+    CHECK(http_server::Compress(json, ContentCoding::IDENTITY, 6) == json);
+}
@@ -0,0 +1,179 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include "../src/http_server.h"
+#include "../src/request_handler.h"
+
+#include <boost/asio/read.hpp>
+#include <boost/asio/write.hpp>
+
+#include <array>
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include <string>
+#include <thread>
+
+// Глобальный operator new со счётчиком: считает только пока включён g_count_allocations
+namespace {
+std::atomic<bool> g_count_allocations{ false };
+std::atomic<size_t> g_allocations{ 0 };
+}  // namespace
+
+void* operator new(size_t size) {
+    if (g_count_allocations.load(std::memory_order_relaxed)) {
+        g_allocations.fetch_add(1, std::memory_order_relaxed);
+    }
+    if (void* pointer = std::malloc(size ? size : 1)) {
+        return pointer;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* pointer) noexcept {
+    std::free(pointer);
+}
+
+void operator delete(void* pointer, size_t) noexcept {
+    std::free(pointer);
+}
+
+namespace {
+
+namespace net = boost::asio;
+namespace http = boost::beast::http;
+using tcp = net::ip::tcp;
+
+// отвечает "ok", заголовки ответа берёт из той же памяти соединения, что и запрос
+struct OkHandler {
+    template <typename Request, typename Send>
+    void operator()(Request&& req, Send&& send, std::string) {
+        using Fields = http::basic_fields<typename std::decay_t<Request>::allocator_type>;
+        http::response<http::string_body, Fields> response(std::piecewise_construct,
+            std::make_tuple(), std::make_tuple(req.get_allocator()));
+        response.result(http::status::ok);
+        response.version(req.version());
+        response.keep_alive(req.keep_alive());
+        response.body() = "ok";
+        response.prepare_payload();
+        send(std::move(response));
+    }
+};
+
+// настоящий обработчик API, вызывается прямо в потоке соединения, без api_strand
+struct ApiHandler {
+    template <typename Request, typename Send>
+    void operator()(Request&& req, Send&& send, std::string) {
+        api(std::forward<Request>(req), std::forward<Send>(send));
+    }
+
+    http_handler::ApiRequestHandler& api;
+};
+
+class NullRepository final : public postgres::RetiredPlayersRepository {
+public:
+    void EnsureSchema() override {}
+    void Add(const postgres::RetiredRecord&) override {}
+    std::vector<postgres::RetiredRecord> Get(int, int) override {
+        return {};
+    }
+};
+
+// Гоняет request по keep-alive соединению с настоящим Session и возвращает,
+// сколько раз звался operator new за REQUESTS запросов после прогрева.
+// Ответы должны быть одной длины, первый читается до body_end
+template <typename Handler>
+size_t CountKeepAliveAllocations(Handler handler, std::string_view request, std::string_view body_end, size_t requests) {
+    net::io_context ioc(1);
+    tcp::acceptor acceptor(ioc, tcp::endpoint(net::ip::make_address("127.0.0.1"), 0));
+    auto tracker = std::make_shared<http_server::ConnectionTracker>(ioc, http_server::ConnectionLimits{});
+    acceptor.async_accept(net::make_strand(ioc), [tracker, handler](boost::system::error_code ec, http_server::SessionSocket socket) {
+        REQUIRE_FALSE(ec);
+        REQUIRE(tracker->TryAdd());
+        using MySession = http_server::Session<Handler>;
+        std::make_shared<MySession>(std::move(socket), handler, tracker)->Run();
+        });
+    std::thread server([&ioc] { ioc.run(); });
+
+    net::io_context client_ioc;
+    tcp::socket client(client_ioc);
+    client.connect(acceptor.local_endpoint());
+
+    std::array<char, 512> response{};
+
+    // первый ответ целиком, дальше ответы одинаковой длины
+    net::write(client, net::buffer(request));
+    size_t response_size = 0;
+    while (!std::string_view(response.data(), response_size).ends_with(body_end)) {
+        response_size += client.read_some(net::buffer(response.data() + response_size, response.size() - response_size));
+    }
+
+    auto exchange = [&] {
+        net::write(client, net::buffer(request));
+        net::read(client, net::buffer(response.data(), response_size));
+    };
+    // прогрев: кэши памяти соединения и потоков заполняются
+    for (int i = 0; i < 100; ++i) {
+        exchange();
+    }
+
+    g_allocations = 0;
+    g_count_allocations = true;
+    for (size_t i = 0; i < requests; ++i) {
+        exchange();
+    }
+    g_count_allocations = false;
+    const size_t allocations = g_allocations;
+
+    CHECK(std::string_view(response.data(), response_size).ends_with(body_end));
+
+    client.close();
+    ioc.stop();
+    server.join();
+    return allocations;
+}
+
+}  // namespace
+
+TEST_CASE("HandlerMemory reuses freed blocks of the same size class") {
+    http_server::HandlerMemory memory;
+    void* first = memory.Allocate(100);
+    memory.Deallocate(first, 100);
+
+    g_allocations = 0;
+    g_count_allocations = true;
+    void* second = memory.Allocate(120);
+    g_count_allocations = false;
+
+    REQUIRE(second == first);
+    REQUIRE(g_allocations == 0);
+    memory.Deallocate(second, 120);
+}
+
+TEST_CASE("Keep-alive transport does not allocate per request") {
+    // синтетический обработчик: проверяется только транспорт (чтение, очередь ответов, запись)
+    const std::string request = "GET /api/v1/game/state HTTP/1.1\r\nHost: localhost\r\nContent-Type: application/json\r\n\r\n";
+    CHECK(CountKeepAliveAllocations(OkHandler{}, request, "\r\n\r\nok", 1000) == 0);
+}
+
+TEST_CASE("GET /api/v1/maps stays within its allocation budget") {
+    model::Game game;
+    model::Map map(model::Map::Id{ "map1" }, "Map 1");
+    map.AddRoad(model::Road(model::Road::HORIZONTAL, model::Point{ 0, 0 }, 100));
+    game.AddMap(map);
+    LootMap loot_map;
+    loot_map.emplace(model::Map::Id{ "map1" }, std::vector<extra_data::LootType>{});
+    loot_gen::LootGenerator generator{ loot_gen::LootGenerator::TimeInterval{ 1000 }, 0.0 };
+    NullRepository repository;
+    app::GameSessionManager manager{ game, loot_map, generator, /*is_random_dog_position=*/false, 100, repository };
+    http_handler::ApiRequestHandler api{ game, "", manager, /*is_manual_tick_allowed=*/true };
+
+    // транспорт не выделяет ничего (тест выше), всё это - сам обработчик: заголовки StringResponse,
+    // дерево JSON со списком карт и его сериализация в тело.
+    // Сейчас выходит 8 на запрос, бюджет с небольшим запасом; рост сверх него - повод разобраться
+    constexpr size_t ALLOCATIONS_PER_REQUEST = 10;
+    constexpr size_t REQUESTS = 1000;
+    const std::string request = "GET /api/v1/maps HTTP/1.1\r\nHost: localhost\r\n\r\n";
+    const size_t allocations = CountKeepAliveAllocations(ApiHandler{ api }, request, "\"name\":\"Map 1\"}]", REQUESTS);
+    INFO("allocations per request: " << static_cast<double>(allocations) / REQUESTS);
+    CHECK(allocations <= ALLOCATIONS_PER_REQUEST * REQUESTS);
+}
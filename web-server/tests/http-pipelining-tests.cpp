@@ -0,0 +1,161 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include "../src/http_server.h"
+
+#include <boost/asio/write.hpp>
+
+#include <atomic>
+#include <charconv>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+namespace net = boost::asio;
+namespace beast = boost::beast;
+namespace http = beast::http;
+using tcp = net::ip::tcp;
+using namespace std::literals;
+
+// Отвечает телом = target, но на запрос "/r/<i>" - через (10 - i) * 5 мс:
+// поздние запросы конвейера готовы раньше ранних, порядок восстанавливает сессия
+struct DelayedHandler {
+    template <typename Request, typename Send>
+    void operator()(Request&& req, Send&& send, std::string) {
+        handled->fetch_add(1);
+        const std::string target(req.target());
+        int index = 0;
+        std::from_chars(target.data() + 3, target.data() + target.size(), index);
+
+        http::response<http::string_body> response(http::status::ok, req.version());
+        response.keep_alive(req.keep_alive());
+        response.body() = target;
+        response.prepare_payload();
+
+        auto timer = std::make_shared<net::steady_timer>(*ioc, std::chrono::milliseconds((10 - index % 10) * 5));
+        timer->async_wait([timer, send = std::forward<Send>(send), response = std::move(response)](boost::system::error_code) mutable {
+            send(std::move(response));
+        });
+    }
+
+    net::io_context* ioc;
+    std::shared_ptr<std::atomic<int>> handled = std::make_shared<std::atomic<int>>(0);
+};
+
+// сервер с одной сессией на loopback и клиентский сокет к нему
+struct Loopback {
+    explicit Loopback(size_t pipeline_depth) {
+        http_server::ConnectionLimits limits;
+        limits.pipeline_depth = pipeline_depth;
+        auto tracker = std::make_shared<http_server::ConnectionTracker>(ioc, limits);
+        acceptor.async_accept(net::make_strand(ioc), [this, tracker](boost::system::error_code ec, http_server::SessionSocket socket) {
+            REQUIRE_FALSE(ec);
+            REQUIRE(tracker->TryAdd());
+            using MySession = http_server::Session<DelayedHandler>;
+            std::make_shared<MySession>(std::move(socket), handler, tracker)->Run();
+        });
+        server = std::thread([this] { ioc.run(); });
+        client.connect(acceptor.local_endpoint());
+    }
+
+    ~Loopback() {
+        boost::system::error_code ignored;
+        client.close(ignored);
+        ioc.stop();
+        server.join();
+    }
+
+    // все запросы одной записью
+    void SendPipelined(const std::vector<std::string>& requests) {
+        std::string batch;
+        for (const auto& request : requests) {
+            batch += request;
+        }
+        net::write(client, net::buffer(batch));
+    }
+
+    // тела ответов по порядку, пока сервер не закрыл соединение или не пришло expected ответов
+    std::vector<std::string> ReadResponses(size_t expected) {
+        std::vector<std::string> bodies;
+        while (bodies.size() < expected) {
+            http::response<http::string_body> response;
+            boost::system::error_code ec;
+            http::read(client, buffer, response, ec);
+            if (ec) {
+                break;
+            }
+            bodies.push_back(response.body());
+        }
+        return bodies;
+    }
+
+    bool ServerClosed() {
+        http::response<http::string_body> response;
+        boost::system::error_code ec;
+        http::read(client, buffer, response, ec);
+        return ec == http::error::end_of_stream || ec == net::error::eof;
+    }
+
+    net::io_context ioc{ 1 };
+    tcp::acceptor acceptor{ ioc, tcp::endpoint(net::ip::make_address("127.0.0.1"), 0) };
+    DelayedHandler handler{ &ioc };
+    std::thread server;
+
+    net::io_context client_ioc;
+    tcp::socket client{ client_ioc };
+    beast::flat_buffer buffer;
+};
+
+std::string MakeRequest(int index, bool close = false) {
+    return "GET /r/" + std::to_string(index) + " HTTP/1.1\r\nHost: localhost\r\n"
+        + (close ? "Connection: close\r\n"s : ""s) + "\r\n";
+}
+
+std::vector<std::string> MakeTargets(int count) {
+    std::vector<std::string> targets;
+    for (int i = 0; i < count; ++i) {
+        targets.push_back("/r/" + std::to_string(i));
+    }
+    return targets;
+}
+
+}  // namespace
+
+TEST_CASE("Pipelined requests are answered in request order") {
+    // запросов больше глубины: кольцо слотов проходится по кругу, а чтение ждёт освобождения слота
+    Loopback loopback(4);
+    constexpr int count = 10;
+    std::vector<std::string> requests;
+    for (int i = 0; i < count; ++i) {
+        requests.push_back(MakeRequest(i));
+    }
+    loopback.SendPipelined(requests);
+
+    CHECK(loopback.ReadResponses(count) == MakeTargets(count));
+    CHECK(*loopback.handler.handled == count);
+}
+
+TEST_CASE("Requests after Connection: close are not answered") {
+    Loopback loopback(8);
+    loopback.SendPipelined({ MakeRequest(0), MakeRequest(1, true), MakeRequest(2) });
+
+    CHECK(loopback.ReadResponses(3) == MakeTargets(2));
+    CHECK(loopback.ServerClosed());
+    CHECK(*loopback.handler.handled == 2);
+}
+
+TEST_CASE("Half-closed client still gets every pipelined response") {
+    Loopback loopback(8);
+    constexpr int count = 6;
+    std::vector<std::string> requests;
+    for (int i = 0; i < count; ++i) {
+        requests.push_back(MakeRequest(i));
+    }
+    loopback.SendPipelined(requests);
+    loopback.client.shutdown(tcp::socket::shutdown_send);
+
+    CHECK(loopback.ReadResponses(count) == MakeTargets(count));
+    CHECK(loopback.ServerClosed());
+}
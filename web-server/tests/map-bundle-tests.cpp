@@ -0,0 +1,129 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include "../src/map_bundle.h"
+
+#include <fstream>
+#include <string>
+
+using namespace std::literals;
+namespace fs = std::filesystem;
+
+namespace {
+
+json_loader::LoadedData MakeData() {
+    json_loader::LoadedData data;
+    data.gen_config = { loot_gen::LootGenerator::TimeInterval{ 2500 }, 0.5 };
+    data.dog_retirement_time_sec = 15;
+
+    model::Map map(model::Map::Id("town"s), "Town"s);
+    map.AddRoad(model::Road(model::Road::HORIZONTAL, model::Point{ 0, 0 }, 40));
+    map.AddRoad(model::Road(model::Road::VERTICAL, model::Point{ 40, 0 }, 30));
+    map.AddRoad(model::Road(model::Road::HORIZONTAL, model::Point{ 40, 30 }, 0));
+    map.AddBuilding(model::Building(model::Rectangle{ { 5, 5 }, { 30, 20 } }));
+    map.AddOffice(model::Office(model::Office::Id("o0"s), model::Point{ 40, 30 }, model::Offset{ 5, 0 }));
+    map.SetDogSpeed(3.5);
+    map.SetBagCapacity(4);
+    data.game.AddMap(std::move(map));
+
+    data.loot_type_by_map_id[model::Map::Id("town"s)].emplace_back(boost::json::object{ { "name", "key" }, { "value", 10 } });
+    data.map_responses.emplace(model::Map::Id("town"s), R"({"id":"town"})"s);
+    return data;
+}
+
+// уникальный файл в temp на тест, удаляется в деструкторе
+struct TempFile {
+    explicit TempFile(std::string_view name)
+        : path(fs::temp_directory_path() / ("map-bundle-tests-"s + std::string(name))) {
+    }
+    ~TempFile() {
+        std::error_code ec;
+        fs::remove(path, ec);
+    }
+    fs::path path;
+};
+
+}  // namespace
+
+TEST_CASE("Map bundle round trip keeps maps, loot and map responses") {
+    TempFile file("round-trip");
+    const auto source = MakeData();
+    map_bundle::WriteBundle(source, file.path);
+
+    const auto loaded = map_bundle::LoadBundle(file.path);
+    CHECK(loaded.gen_config.period == source.gen_config.period);
+    CHECK(loaded.gen_config.probability == 0.5);
+    CHECK(loaded.dog_retirement_time_sec == 15);
+
+    const model::Map* map = loaded.game.FindMap(model::Map::Id("town"s));
+    REQUIRE(map);
+    CHECK(map->GetName() == "Town");
+    CHECK(map->GetDogSpeed() == 3.5);
+    CHECK(map->GetBagCapacity() == 4);
+    REQUIRE(map->GetRoads().size() == 3);
+    CHECK(map->GetRoads()[1].IsVertical());
+    CHECK(map->GetRoads()[2].GetEnd().x == 0);
+    REQUIRE(map->GetBuildings().size() == 1);
+    CHECK(map->GetBuildings()[0].GetBounds().size.width == 30);
+    REQUIRE(map->GetOffices().size() == 1);
+    CHECK(*map->GetOffices()[0].GetId() == "o0");
+    CHECK(map->GetOffices()[0].GetOffset().dx == 5);
+
+    // индекс берётся из бандла и совпадает с построенным по дорогам
+    REQUIRE(map->HasRoadIndex());
+    const model::RoadIndex rebuilt(map->GetRoads());
+    const auto index = map->GetRoadIndex();
+    CHECK(index->GetHorizontalLines().keys == rebuilt.GetHorizontalLines().keys);
+    CHECK(index->GetHorizontalLines().offsets == rebuilt.GetHorizontalLines().offsets);
+    CHECK(index->GetVertical(40).size() == 1);
+    CHECK(index->GetVertical(40)[0].b == 30.4);
+
+    const auto& loot = loaded.loot_type_by_map_id.at(map->GetId());
+    REQUIRE(loot.size() == 1);
+    CHECK(loot[0].GetValue() == 10);
+    CHECK(loaded.map_responses.at(map->GetId()) == R"({"id":"town"})");
+}
+
+TEST_CASE("Damaged map bundle is rejected") {
+    TempFile file("damaged");
+    map_bundle::WriteBundle(MakeData(), file.path);
+    const auto size = fs::file_size(file.path);
+
+    SECTION("flipped byte") {
+        std::fstream stream(file.path, std::ios::in | std::ios::out | std::ios::binary);
+        stream.seekp(static_cast<std::streamoff>(size - 3));
+        stream.put('#');
+    }
+    SECTION("truncated") {
+        fs::resize_file(file.path, size - 1);
+    }
+    SECTION("not a bundle") {
+        std::ofstream(file.path, std::ios::trunc) << R"({"maps": []})" << std::string(64, ' ');
+    }
+    CHECK_THROWS_AS(map_bundle::LoadBundle(file.path), std::runtime_error);
+}
+
+TEST_CASE("Map bundle validates maps before writing") {
+    TempFile file("invalid");
+    auto data = MakeData();
+    model::Map map(model::Map::Id("field"s), "Field"s);
+    map.AddRoad(model::Road(model::Road::HORIZONTAL, model::Point{ 0, 0 }, 10));
+    map.AddOffice(model::Office(model::Office::Id("far"s), model::Point{ 5, 7 }, model::Offset{ 0, 0 }));
+    data.game.AddMap(std::move(map));
+    data.loot_type_by_map_id[model::Map::Id("field"s)].emplace_back(boost::json::object{ { "name", "key" } });
+
+    CHECK_THROWS_AS(map_bundle::WriteBundle(data, file.path), std::invalid_argument);
+    CHECK_FALSE(fs::exists(file.path));
+}
+
+TEST_CASE("Map bundle is fresh only if not older than config") {
+    TempFile config("config.json");
+    TempFile bundle("fresh");
+    std::ofstream(config.path) << "{}";
+    CHECK_FALSE(map_bundle::IsBundleFresh(bundle.path, config.path));
+
+    map_bundle::WriteBundle(MakeData(), bundle.path);
+    fs::last_write_time(bundle.path, fs::last_write_time(config.path) + 1s);
+    CHECK(map_bundle::IsBundleFresh(bundle.path, config.path));
+    fs::last_write_time(bundle.path, fs::last_write_time(config.path) - 1s);
+    CHECK_FALSE(map_bundle::IsBundleFresh(bundle.path, config.path));
+}
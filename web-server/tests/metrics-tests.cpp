@@ -0,0 +1,96 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include "../src/metrics.h"
+
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+using metrics::Histogram;
+
+TEST_CASE("Histogram buckets keep relative error bounded") {
+    for (uint64_t value : { 0ull, 1ull, 7ull, 8ull, 9ull, 100ull, 1000ull, 123456ull, 1ull << 40, ~0ull }) {
+        const size_t index = Histogram::BucketIndex(value);
+        REQUIRE(index < Histogram::BUCKETS);
+        const uint64_t upper = Histogram::BucketUpperBound(index);
+        REQUIRE(upper >= value);
+        // верхняя граница отличается от значения не больше чем на 1/SUB_BUCKETS
+        REQUIRE(upper - value <= value / Histogram::SUB_BUCKETS);
+    }
+    // корзины идут по возрастанию без дыр
+    for (size_t i = 1; i < Histogram::BUCKETS; ++i) {
+        REQUIRE(Histogram::BucketIndex(Histogram::BucketUpperBound(i - 1) + 1) == i);
+    }
+}
+
+TEST_CASE("Histogram quantiles and counters across threads") {
+    Histogram histogram;
+    metrics::Counter counter;
+
+    std::vector<std::thread> workers;
+    for (int t = 0; t < 4; ++t) {
+        workers.emplace_back([&] {
+            for (uint64_t v = 1; v <= 1000; ++v) {
+                histogram.Record(v);
+                counter.Add();
+            }
+            });
+    }
+    for (auto& worker : workers) {
+        worker.join();
+    }
+
+    const auto snapshot = histogram.TakeSnapshot();
+    REQUIRE(snapshot.count == 4000);
+    REQUIRE(snapshot.sum == 4 * 500500);
+    REQUIRE(counter.Value() == 4000);
+
+    const uint64_t p50 = snapshot.ValueAtQuantile(0.5);
+    REQUIRE(p50 >= 500);
+    REQUIRE(p50 <= 500 + 500 / Histogram::SUB_BUCKETS);
+    REQUIRE(snapshot.ValueAtQuantile(1.0) >= 1000);
+}
+
+TEST_CASE("Registry renders Prometheus text format") {
+    auto& registry = metrics::Registry::Instance();
+    registry.GetCounter("test_requests_total", "Test counter", metrics::Label("endpoint", "/a")).Add(3);
+    registry.GetGauge("test_dogs", "Test gauge").Set(42);
+    registry.GetHistogram("test_latency_us", "Test histogram").Record(10);
+
+    const std::string text = registry.RenderPrometheus();
+    REQUIRE(text.find("# TYPE test_requests_total counter") != std::string::npos);
+    REQUIRE(text.find("test_requests_total{endpoint=\"/a\"} 3") != std::string::npos);
+    REQUIRE(text.find("test_dogs 42") != std::string::npos);
+    REQUIRE(text.find("test_latency_us_bucket{le=\"7\"} 0") != std::string::npos);
+    REQUIRE(text.find("test_latency_us_bucket{le=\"15\"} 1") != std::string::npos);
+    REQUIRE(text.find("test_latency_us_bucket{le=\"+Inf\"} 1") != std::string::npos);
+    REQUIRE(text.find("test_latency_us_count 1") != std::string::npos);
+
+    // одно имя - один тип
+    REQUIRE_THROWS(registry.GetGauge("test_requests_total", "wrong type"));
+}
+
+TEST_CASE("Registry drops a callback gauge with its registration") {
+    auto& registry = metrics::Registry::Instance();
+    auto value = std::make_shared<int>(7);
+    {
+        const auto registration = registry.AddCallbackGauge("test_callback_gauge", "Test callback gauge",
+            [value] { return static_cast<double>(*value); });
+        REQUIRE(registry.RenderPrometheus().find("test_callback_gauge 7") != std::string::npos);
+        REQUIRE(value.use_count() == 2);
+    }
+    // захваченное отпущено, в выгрузке колбэка больше нет
+    REQUIRE(value.use_count() == 1);
+    REQUIRE(registry.RenderPrometheus().find("test_callback_gauge 7") == std::string::npos);
+}
+
+TEST_CASE("Registry exports callback counters with counter type") {
+    auto& registry = metrics::Registry::Instance();
+    const auto registration = registry.AddCallbackCounter("test_callback_events_total", "Test callback counter",
+        [] { return 5.0; });
+
+    const std::string text = registry.RenderPrometheus();
+    REQUIRE(text.find("# TYPE test_callback_events_total counter") != std::string::npos);
+    REQUIRE(text.find("test_callback_events_total 5") != std::string::npos);
+}
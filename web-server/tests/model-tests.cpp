@@ -96,4 +96,200 @@ TEST_CASE("GameSessionManager::ProcessTick generates loot for sessions") {
 
     const auto& lost = session->GetLostObjects();
     REQUIRE(lost.size() == 1);
-}
\ No newline at end of file
+}
+
+TEST_CASE("GameSessionManager retires idle dogs without invalidating other players") {
+    using namespace std::string_literals;
+
+    model::Game game;
+    Map::Id map_id{ std::string("map_afk") };
+    Map map(map_id, "AFK map");
+    map.AddRoad(Road(Road::HORIZONTAL, Point{ 0, 0 }, 100));
+    game.AddMap(map);
+
+    LootMap loot_map;
+    loot_map.emplace(map_id, std::vector<extra_data::LootType>{});
+
+    LootGenerator generator(LootGenerator::TimeInterval{ 1000 }, 0.0);
+    DummyRetiredPlayersRepository dummy_rep;
+
+    // собака уходит на покой после 1 секунды бездействия
+    GameSessionManager manager(game, loot_map, generator, /*random_spawn=*/false, 1.0, dummy_rep);
+
+    std::vector<app::Token> tokens;
+    for (int i = 0; i < 10; ++i) {
+        tokens.push_back(manager.AddDogToMap("Dog"s + std::to_string(i), map_id).first);
+    }
+
+    // нечётные игроки двигаются, чётные стоят на месте
+    for (size_t i = 1; i < tokens.size(); i += 2) {
+        manager.SetMoveDog(manager.FindPlayerByToken(tokens[i]), "R");
+    }
+
+    manager.ProcessTick(/*ms=*/1000);
+
+    GameSession* session = manager.GetSessionByMapId(map_id);
+    REQUIRE(session != nullptr);
+    REQUIRE(session->GetDogs().size() == 5);
+    REQUIRE(dummy_rep.Get(0, 100).size() == 5);
+
+    for (size_t i = 0; i < tokens.size(); ++i) {
+        app::Player* player = manager.FindPlayerByToken(tokens[i]);
+        if (i % 2 == 0) {
+            REQUIRE(player == nullptr);
+        }
+        else {
+            REQUIRE(player != nullptr);
+            REQUIRE(session->FindDog(player->GetDogHandle()) == player->GetDogPtr());
+            REQUIRE(player->GetDogPtr()->GetName() == "Dog"s + std::to_string(i));
+        }
+    }
+}
+
+TEST_CASE("GameSessionManager counts idle time from the moment a dog stops") {
+    using namespace std::string_literals;
+
+    model::Game game;
+    Map::Id map_id{ std::string("map_idle") };
+    Map map(map_id, "Idle map");
+    map.AddRoad(Road(Road::HORIZONTAL, Point{ 0, 0 }, 1000));
+    game.AddMap(map);
+
+    LootMap loot_map;
+    loot_map.emplace(map_id, std::vector<extra_data::LootType>{});
+
+    LootGenerator generator(LootGenerator::TimeInterval{ 1000 }, 0.0);
+    DummyRetiredPlayersRepository dummy_rep;
+    GameSessionManager manager(game, loot_map, generator, /*random_spawn=*/false, 1.0, dummy_rep);
+
+    const app::Token token = manager.AddDogToMap("Runner"s, map_id).first;
+    manager.SetMoveDog(manager.FindPlayerByToken(token), "R");
+
+    // пока бежит - на покой не уходит, сколько бы тиков ни прошло
+    for (int i = 0; i < 3; ++i) {
+        manager.ProcessTick(/*ms=*/500);
+    }
+    REQUIRE(manager.FindPlayerByToken(token) != nullptr);
+
+    // остановилась: через полсекунды ещё в игре, через секунду - ушла
+    manager.SetMoveDog(manager.FindPlayerByToken(token), "");
+    manager.ProcessTick(/*ms=*/500);
+    REQUIRE(manager.FindPlayerByToken(token) != nullptr);
+
+    manager.ProcessTick(/*ms=*/500);
+    REQUIRE(manager.FindPlayerByToken(token) == nullptr);
+
+    const auto records = dummy_rep.Get(0, 100);
+    REQUIRE(records.size() == 1);
+    REQUIRE(records[0].name == "Runner");
+    // время в игре - от входа до ухода
+    REQUIRE(records[0].play_time == 2.5);
+}
+
+TEST_CASE("RoadIndex merges roads per line and is shared by map copies") {
+    Map map(Map::Id("m"), "m");
+    map.AddRoad(Road(Road::HORIZONTAL, Point{ 0, 0 }, 10));
+    // касается первой с учётом ширины дороги
+    map.AddRoad(Road(Road::HORIZONTAL, Point{ 20, 0 }, 10));
+    map.AddRoad(Road(Road::HORIZONTAL, Point{ 30, 0 }, 40));
+    map.AddRoad(Road(Road::VERTICAL, Point{ 5, 10 }, -3));
+
+    model::Game game;
+    game.AddMap(map);
+    const Map& stored = game.GetMaps().front();
+
+    const auto index = stored.GetRoadIndex();
+    const auto line = index->GetHorizontal(0);
+    REQUIRE(line.size() == 2);
+    CHECK(line[0].a == -model::ROAD_HALF_WIDTH);
+    CHECK(line[0].b == 20 + model::ROAD_HALF_WIDTH);
+    CHECK(line[1].a == 30 - model::ROAD_HALF_WIDTH);
+    CHECK(line[1].b == 40 + model::ROAD_HALF_WIDTH);
+
+    const auto column = index->GetVertical(5);
+    REQUIRE(column.size() == 1);
+    CHECK(column[0].a == -3 - model::ROAD_HALF_WIDTH);
+    CHECK(column[0].b == 10 + model::ROAD_HALF_WIDTH);
+
+    CHECK(index->GetHorizontal(1).empty());
+    CHECK(index->GetVertical(0).empty());
+
+    // один индекс на карту, а не на сессию
+    CHECK(stored.GetRoadIndex() == index);
+    Map copy = stored;
+    CHECK(copy.GetRoadIndex() == index);
+    copy.AddRoad(Road(Road::HORIZONTAL, Point{ 0, 1 }, 3));
+    CHECK(copy.GetRoadIndex()->GetHorizontal(1).size() == 1);
+    CHECK(stored.GetRoadIndex() == index);
+}
+
+TEST_CASE("GameSessionManager drops sessions that stay empty") {
+    using namespace std::string_literals;
+
+    model::Game game;
+    Map::Id map_id{ "map_reclaim"s };
+    Map map(map_id, "Reclaim map");
+    map.AddRoad(Road(Road::HORIZONTAL, Point{ 0, 0 }, 10));
+    game.AddMap(map);
+
+    LootMap loot_map;
+    loot_map.emplace(map_id, std::vector<extra_data::LootType>{});
+    LootGenerator generator(LootGenerator::TimeInterval{ 1000 }, 0.0);
+    DummyRetiredPlayersRepository dummy_rep;
+
+    // собака уходит на покой через 1 с, пустая сессия живёт ещё 2 с
+    GameSessionManager manager(game, loot_map, generator, /*random_spawn=*/false, 1.0, dummy_rep);
+    manager.SetSessionIdleTimeout(std::chrono::milliseconds{ 2000 });
+
+    manager.AddDogToMap("Rex"s, map_id);
+    manager.ProcessTick(1000);
+    REQUIRE(dummy_rep.Get(0, 10).size() == 1);
+    REQUIRE(manager.GetSessionByMapId(map_id) != nullptr);
+
+    manager.ProcessTick(1500);
+    REQUIRE(manager.GetSessionByMapId(map_id) != nullptr);
+    manager.ProcessTick(500);
+    REQUIRE(manager.GetSessionByMapId(map_id) == nullptr);
+
+    // следующий игрок получает новую сессию
+    const auto [token, dog_id] = manager.AddDogToMap("Bim"s, map_id);
+    GameSession* session = manager.GetSessionByMapId(map_id);
+    REQUIRE(session != nullptr);
+    REQUIRE(manager.FindPlayerByToken(token)->GetSessionPtr() == session);
+    REQUIRE(dog_id == 0);
+}
+
+TEST_CASE("Join and move change the state version of their session only, tick - of all sessions") {
+    using namespace std::string_literals;
+
+    model::Game game;
+    Map::Id first_id{ std::string("map_first") };
+    Map::Id second_id{ std::string("map_second") };
+    for (const Map::Id& id : { first_id, second_id }) {
+        Map map(id, "Map");
+        map.AddRoad(Road(Road::HORIZONTAL, Point{ 0, 0 }, 10));
+        game.AddMap(map);
+    }
+    LootMap loot_map;
+    loot_map.emplace(first_id, std::vector<extra_data::LootType>{});
+    loot_map.emplace(second_id, std::vector<extra_data::LootType>{});
+    LootGenerator generator(LootGenerator::TimeInterval{ 1000 }, 0.0);
+    DummyRetiredPlayersRepository dummy_rep;
+    GameSessionManager manager(game, loot_map, generator, /*random_spawn=*/false, 100, dummy_rep);
+
+    auto [first_token, first_dog] = manager.AddDogToMap("Rex"s, first_id);
+    manager.AddDogToMap("Max"s, second_id);
+    GameSession* first = manager.GetSessionByMapId(first_id);
+    GameSession* second = manager.GetSessionByMapId(second_id);
+    const uint64_t second_version = second->GetStateVersion();
+
+    const uint64_t first_version = first->GetStateVersion();
+    manager.SetMoveDog(manager.FindPlayerByToken(first_token), "R");
+    REQUIRE(first->GetStateVersion() != first_version);
+    REQUIRE(second->GetStateVersion() == second_version);
+
+    manager.ProcessTick(100);
+    REQUIRE(second->GetStateVersion() != second_version);
+    REQUIRE(first->GetStateVersion() == manager.GetTickStateVersion());
+    REQUIRE(second->GetStateVersion() == manager.GetTickStateVersion());
+}
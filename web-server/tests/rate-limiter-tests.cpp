@@ -0,0 +1,51 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include "../src/rate_limiter.h"
+
+#include <string>
+
+using http_server::TokenBucketLimiter;
+using namespace std::chrono_literals;
+
+TEST_CASE("TokenBucketLimiter lets a burst through and then refills at the rate") {
+    TokenBucketLimiter limiter(/*rate_per_second=*/10, /*burst=*/5);
+    const auto start = TokenBucketLimiter::Clock::time_point{};
+
+    for (int i = 0; i < 5; ++i) {
+        REQUIRE(limiter.TryAcquire("token", start));
+    }
+    REQUIRE_FALSE(limiter.TryAcquire("token", start));
+
+    // за 100мс набегает ровно один токен
+    REQUIRE_FALSE(limiter.TryAcquire("token", start + 50ms));
+    REQUIRE(limiter.TryAcquire("token", start + 100ms));
+    REQUIRE_FALSE(limiter.TryAcquire("token", start + 100ms));
+
+    // ведро не копит больше burst
+    const auto later = start + 1h;
+    for (int i = 0; i < 5; ++i) {
+        REQUIRE(limiter.TryAcquire("token", later));
+    }
+    REQUIRE_FALSE(limiter.TryAcquire("token", later));
+}
+
+TEST_CASE("TokenBucketLimiter keeps separate buckets per key") {
+    TokenBucketLimiter limiter(1, 1);
+    const auto now = TokenBucketLimiter::Clock::time_point{};
+
+    REQUIRE(limiter.TryAcquire("a", now));
+    REQUIRE_FALSE(limiter.TryAcquire("a", now));
+    REQUIRE(limiter.TryAcquire("b", now));
+    REQUIRE(limiter.Size() == 2);
+}
+
+TEST_CASE("TokenBucketLimiter bounds the number of tracked keys") {
+    constexpr size_t MAX_KEYS = TokenBucketLimiter::SHARDS * 8;
+    TokenBucketLimiter limiter(1, 2, MAX_KEYS);
+    const auto now = TokenBucketLimiter::Clock::time_point{};
+
+    for (int i = 0; i < 10'000; ++i) {
+        limiter.TryAcquire(std::to_string(i), now);
+    }
+    REQUIRE(limiter.Size() <= MAX_KEYS);
+}
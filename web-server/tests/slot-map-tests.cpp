@@ -0,0 +1,106 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include "../src/slot_map.h"
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+using util::SlotMap;
+
+TEST_CASE("SlotMap inserts and finds values by handle") {
+    SlotMap<std::string> slots;
+    REQUIRE(slots.empty());
+
+    auto a = slots.Insert("a");
+    auto b = slots.Insert("b");
+
+    REQUIRE(slots.size() == 2);
+    REQUIRE(slots.Contains(a));
+    REQUIRE(*slots.Get(a) == "a");
+    REQUIRE(*slots.Get(b) == "b");
+}
+
+TEST_CASE("SlotMap keeps addresses stable after erase") {
+    SlotMap<int> slots;
+    std::vector<SlotMap<int>::Handle> handles;
+    std::vector<int*> pointers;
+    for (int i = 0; i < 100; ++i) {
+        handles.push_back(slots.Insert(i));
+        pointers.push_back(slots.Get(handles.back()));
+    }
+
+    // удаляем каждый второй элемент
+    for (int i = 0; i < 100; i += 2) {
+        REQUIRE(slots.Erase(handles[i]));
+    }
+
+    REQUIRE(slots.size() == 50);
+    for (int i = 1; i < 100; i += 2) {
+        REQUIRE(slots.Get(handles[i]) == pointers[i]);
+        REQUIRE(*pointers[i] == i);
+    }
+}
+
+TEST_CASE("SlotMap rejects stale handles after slot reuse") {
+    SlotMap<int> slots;
+    auto old_handle = slots.Insert(1);
+    REQUIRE(slots.Erase(old_handle));
+    REQUIRE_FALSE(slots.Erase(old_handle));
+
+    // слот переиспользуется, но поколение уже другое
+    auto new_handle = slots.Insert(2);
+    REQUIRE(new_handle.index == old_handle.index);
+    REQUIRE_FALSE(slots.Contains(old_handle));
+    REQUIRE(slots.Get(old_handle) == nullptr);
+    REQUIRE(*slots.Get(new_handle) == 2);
+}
+
+TEST_CASE("SlotMap iterates only live values") {
+    SlotMap<int> slots;
+    auto h0 = slots.Insert(0);
+    slots.Insert(1);
+    auto h2 = slots.Insert(2);
+    slots.Insert(3);
+
+    slots.Erase(h0);
+    slots.Erase(h2);
+
+    std::vector<int> values(slots.begin(), slots.end());
+    std::sort(values.begin(), values.end());
+    REQUIRE(values == std::vector<int>{ 1, 3 });
+
+    // handle, полученный из итератора, указывает на тот же элемент
+    for (auto it = slots.begin(); it != slots.end(); ++it) {
+        REQUIRE(slots.Get(it.GetHandle()) == &*it);
+    }
+
+    slots.clear();
+    REQUIRE(slots.empty());
+    REQUIRE(slots.begin() == slots.end());
+}
+
+TEST_CASE("SlotMap shrink_to_fit keeps live values and stale handles dead") {
+    SlotMap<int> slots;
+    std::vector<SlotMap<int>::Handle> handles;
+    for (int i = 0; i < 10; ++i) {
+        handles.push_back(slots.Insert(i));
+    }
+    int* kept = slots.Get(handles[2]);
+    for (int i = 3; i < 10; ++i) {
+        REQUIRE(slots.Erase(handles[i]));
+    }
+
+    slots.shrink_to_fit();
+    REQUIRE(slots.size() == 3);
+    REQUIRE(slots.Get(handles[2]) == kept);
+
+    // хвостовые слоты срезаны, новые создаются заново, но со свежим поколением
+    for (int i = 0; i < 7; ++i) {
+        auto handle = slots.Insert(100 + i);
+        REQUIRE(handle.index == static_cast<uint32_t>(3 + i));
+    }
+    for (int i = 3; i < 10; ++i) {
+        REQUIRE_FALSE(slots.Contains(handles[i]));
+    }
+}
@@ -0,0 +1,91 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include "../src/spatial_grid.h"
+#include "../src/player.h"
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+using util::SpatialGrid;
+using model::RealCoord;
+
+namespace {
+
+std::vector<int> Candidates(const SpatialGrid<int>& grid, RealCoord center, double radius) {
+    std::vector<int> result;
+    grid.ForEachCandidate(center, radius, [&result](int id) {
+        result.push_back(id);
+        });
+    std::sort(result.begin(), result.end());
+    return result;
+}
+
+}  // namespace
+
+TEST_CASE("SpatialGrid returns objects from neighbouring cells only") {
+    SpatialGrid<int> grid(10.0);
+    grid.Insert(1, RealCoord{ 1, 1 });
+    grid.Insert(2, RealCoord{ 12, 3 });
+    grid.Insert(3, RealCoord{ 55, 55 });
+    grid.Insert(4, RealCoord{ -3, -3 });
+
+    REQUIRE(grid.Size() == 4);
+    REQUIRE(Candidates(grid, RealCoord{ 5, 5 }, 5) == std::vector<int>{ 1, 2 });
+    REQUIRE(Candidates(grid, RealCoord{ 1, 1 }, 5) == std::vector<int>{ 1, 4 });
+    REQUIRE(Candidates(grid, RealCoord{ 50, 50 }, 5) == std::vector<int>{ 3 });
+}
+
+TEST_CASE("SpatialGrid moves objects between cells") {
+    SpatialGrid<int> grid(10.0);
+    grid.Insert(1, RealCoord{ 1, 1 });
+
+    // внутри ячейки - ничего не меняется
+    grid.Move(1, RealCoord{ 1, 1 }, RealCoord{ 9, 9 });
+    REQUIRE(Candidates(grid, RealCoord{ 5, 5 }, 1) == std::vector<int>{ 1 });
+
+    grid.Move(1, RealCoord{ 9, 9 }, RealCoord{ 95, 5 });
+    REQUIRE(Candidates(grid, RealCoord{ 5, 5 }, 1).empty());
+    REQUIRE(Candidates(grid, RealCoord{ 95, 5 }, 1) == std::vector<int>{ 1 });
+
+    REQUIRE(grid.CellCount() == 1);
+
+    grid.Erase(1, RealCoord{ 95, 5 });
+    REQUIRE(grid.Size() == 0);
+    REQUIRE(grid.CellCount() == 0);
+    REQUIRE(Candidates(grid, RealCoord{ 95, 5 }, 1).empty());
+}
+
+TEST_CASE("GameSession with interest radius finds only nearby dogs and loot") {
+    model::Map map(model::Map::Id{ std::string("map_aoi") }, "AOI map");
+    map.AddRoad(model::Road(model::Road::HORIZONTAL, model::Point{ 0, 0 }, 100));
+
+    app::GameSession session(&map, /*is_random_dog_position=*/false);
+    session.SetInterestRadius(5.0);
+
+    // все собаки появляются в начале дороги
+    const app::DogHandle near_dog = session.AddDogToMap(model::Dog("near"));
+    const app::DogHandle far_dog = session.AddDogToMap(model::Dog("far"));
+    session.FindDog(far_dog)->SetMoveDog(model::EAST, 1.0);
+    session.ProcessTickMove(/*milliseconds=*/50000);
+
+    session.AddLostObject(model::LostObject{ .type = 0, .pos = RealCoord{ 3, 0 } });
+    session.AddLostObject(model::LostObject{ .type = 0, .pos = RealCoord{ 52, 0 } });
+
+    const RealCoord center = session.FindDog(near_dog)->GetPosition();
+    const auto dogs = session.FindDogsNear(center);
+    REQUIRE(dogs.size() == 1);
+    REQUIRE(dogs[0]->GetName() == "near");
+    const auto near_loot = session.FindLostObjectsNear(center);
+    REQUIRE(near_loot.size() == 1);
+    REQUIRE(near_loot[0].index == 0);
+
+    // подобранный предмет уходит из сетки, у оставшегося handle не меняется
+    session.GetLostObjects()[0].is_collected = true;
+    session.RemoveCollectedLostObjects();
+    REQUIRE(session.FindLostObjectsNear(center).empty());
+    const auto far_loot = session.FindLostObjectsNear(session.FindDog(far_dog)->GetPosition());
+    REQUIRE(far_loot.size() == 1);
+    REQUIRE(far_loot[0].index == 1);
+    REQUIRE(session.GetLostObjects().Get(far_loot[0])->pos.GetX() == 52);
+}
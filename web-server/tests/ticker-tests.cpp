@@ -0,0 +1,64 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include "../src/ticker.h"
+
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+using namespace std::chrono_literals;
+
+TEST_CASE("Ticker passes fixed delta and counts overruns") {
+    net::io_context ioc;
+    auto strand = net::make_strand(ioc);
+
+    std::vector<std::chrono::milliseconds> deltas;
+    auto ticker = std::make_shared<Ticker>(strand, 10ms, [&](std::chrono::milliseconds delta) {
+        deltas.push_back(delta);
+        // первые тики заведомо не укладываются в период
+        if (deltas.size() <= 3) {
+            std::this_thread::sleep_for(15ms);
+        }
+        if (deltas.size() == 20) {
+            ioc.stop();
+        }
+        });
+    ticker->Start();
+    ioc.run_for(5s);
+
+    REQUIRE(deltas.size() >= 20);
+    for (auto delta : deltas) {
+        REQUIRE(delta == 10ms);
+    }
+
+    const TickerStats& stats = ticker->GetStats();
+    REQUIRE(stats.ticks == deltas.size());
+    REQUIRE(stats.overruns >= 3);
+    // отставание от первых тиков пришлось догонять
+    REQUIRE(stats.catch_up_steps + stats.skipped_ticks > 0);
+}
+
+TEST_CASE("Ticker reports handler exceptions and keeps ticking") {
+    net::io_context ioc;
+    auto strand = net::make_strand(ioc);
+
+    int calls = 0;
+    int reported = 0;
+    auto ticker = std::make_shared<Ticker>(strand, 1ms,
+        [&](std::chrono::milliseconds) {
+            if (++calls == 3) {
+                ioc.stop();
+            }
+            throw std::runtime_error("tick failed");
+        },
+        [&](std::exception_ptr error) {
+            REQUIRE(error);
+            ++reported;
+        });
+    ticker->Start();
+    ioc.run_for(5s);
+
+    REQUIRE(calls == 3);
+    REQUIRE(reported == 3);
+    REQUIRE(ticker->GetStats().errors == 3);
+}
@@ -0,0 +1,125 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include "../src/timer_wheel.h"
+#include "../src/http_server.h"
+
+#include <random>
+#include <thread>
+#include <vector>
+
+using http_server::TimerWheel;
+
+namespace {
+
+std::vector<uint64_t> AdvanceAndCollect(TimerWheel& wheel, uint64_t now) {
+    std::vector<uint64_t> fired;
+    wheel.Advance(now, [&wheel, &fired](TimerWheel::Entry& entry) {
+        fired.push_back(wheel.GetCurrentTick());
+        REQUIRE_FALSE(entry.IsScheduled());
+        });
+    return fired;
+}
+
+}  // namespace
+
+TEST_CASE("TimerWheel fires entries exactly at their tick") {
+    TimerWheel wheel;
+    TimerWheel::Entry near, far, very_far;
+    wheel.Schedule(near, 5);
+    wheel.Schedule(far, 100);          // второй уровень
+    wheel.Schedule(very_far, 70'000);  // третий уровень
+    REQUIRE(wheel.Size() == 3);
+
+    REQUIRE(AdvanceAndCollect(wheel, 4).empty());
+    REQUIRE(AdvanceAndCollect(wheel, 5) == std::vector<uint64_t>{ 5 });
+    REQUIRE(AdvanceAndCollect(wheel, 99).empty());
+    REQUIRE(AdvanceAndCollect(wheel, 100) == std::vector<uint64_t>{ 100 });
+    REQUIRE(AdvanceAndCollect(wheel, 69'999).empty());
+    REQUIRE(AdvanceAndCollect(wheel, 70'000) == std::vector<uint64_t>{ 70'000 });
+    REQUIRE(wheel.Size() == 0);
+}
+
+TEST_CASE("TimerWheel reschedules and cancels entries") {
+    TimerWheel wheel;
+    TimerWheel::Entry entry;
+
+    wheel.Schedule(entry, 10);
+    wheel.Schedule(entry, 200);
+    REQUIRE(wheel.Size() == 1);
+    REQUIRE(AdvanceAndCollect(wheel, 150).empty());
+    REQUIRE(AdvanceAndCollect(wheel, 200) == std::vector<uint64_t>{ 200 });
+
+    wheel.Schedule(entry, 300);
+    wheel.Cancel(entry);
+    REQUIRE_FALSE(entry.IsScheduled());
+    REQUIRE(wheel.Size() == 0);
+    REQUIRE(AdvanceAndCollect(wheel, 400).empty());
+
+    SECTION("deadline in the past fires on the next tick") {
+        wheel.Schedule(entry, 1);
+        REQUIRE(AdvanceAndCollect(wheel, 401) == std::vector<uint64_t>{ 401 });
+    }
+}
+
+TEST_CASE("TimerWheel matches a sorted schedule for random deadlines") {
+    TimerWheel wheel;
+    std::mt19937 rng(42);
+    std::uniform_int_distribution<uint64_t> delay(1, 300'000);
+
+    constexpr size_t COUNT = 2000;
+    std::vector<TimerWheel::Entry> entries(COUNT);
+    std::vector<uint64_t> deadlines(COUNT);
+    for (size_t i = 0; i < COUNT; ++i) {
+        deadlines[i] = delay(rng);
+        wheel.Schedule(entries[i], deadlines[i]);
+    }
+
+    size_t fired = 0;
+    bool all_on_time = true;
+    wheel.Advance(300'000, [&](TimerWheel::Entry& entry) {
+        const size_t index = &entry - entries.data();
+        all_on_time = all_on_time && deadlines[index] == wheel.GetCurrentTick();
+        ++fired;
+        });
+    REQUIRE(fired == COUNT);
+    REQUIRE(all_on_time);
+}
+
+TEST_CASE("ConnectionTracker closes a connection that never sends a request") {
+    namespace net = boost::asio;
+    using tcp = net::ip::tcp;
+
+    http_server::ConnectionLimits limits;
+    limits.read_timeout = std::chrono::seconds(0);
+    limits.tick = std::chrono::milliseconds(10);
+    auto& evicted = metrics::Registry::Instance().GetCounter("http_connections_evicted_total",
+        "Connections closed by timeout", metrics::Label("reason", "read"));
+    const uint64_t evicted_before = evicted.Value();
+
+    net::io_context ioc(1);
+    auto tracker = std::make_shared<http_server::ConnectionTracker>(ioc, limits);
+    tracker->Start();
+    tcp::acceptor acceptor(ioc, tcp::endpoint(net::ip::make_address("127.0.0.1"), 0));
+    acceptor.async_accept(net::make_strand(ioc), [tracker](boost::system::error_code ec, http_server::SessionSocket socket) {
+        REQUIRE_FALSE(ec);
+        REQUIRE(tracker->TryAdd());
+        auto handler = [](auto&&, auto&&, auto&&) {};
+        using MySession = http_server::Session<decltype(handler)>;
+        std::make_shared<MySession>(std::move(socket), handler, tracker)->Run();
+        });
+    std::thread server([&ioc] { ioc.run(); });
+
+    net::io_context client_ioc;
+    tcp::socket client(client_ioc);
+    client.connect(acceptor.local_endpoint());
+    std::array<char, 16> buffer{};
+    boost::system::error_code ec;
+    client.read_some(net::buffer(buffer), ec);
+
+    CHECK(ec);
+    CHECK(evicted.Value() == evicted_before + 1);
+
+    ioc.stop();
+    server.join();
+    CHECK(tracker->GetActiveConnections() == 0);
+}
@@ -0,0 +1,80 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include "../src/tracing.h"
+
+#include <atomic>
+#include <string>
+#include <thread>
+
+using namespace std::chrono_literals;
+
+TEST_CASE("ThreadBuffer keeps only the last CAPACITY events") {
+    tracing::ThreadBuffer buffer(7);
+    const size_t total = tracing::ThreadBuffer::CAPACITY + 10;
+    for (size_t i = 0; i < total; ++i) {
+        buffer.Push("event", static_cast<int64_t>(i), 1);
+    }
+
+    const auto events = buffer.Snapshot();
+    REQUIRE(events.size() == tracing::ThreadBuffer::CAPACITY);
+    REQUIRE(events.front().start_us == 10);
+    REQUIRE(events.back().start_us == static_cast<int64_t>(total - 1));
+    REQUIRE(events.front().tid == 7);
+
+    // с номера события
+    REQUIRE(buffer.Snapshot(total - 3).size() == 3);
+}
+
+TEST_CASE("ThreadBuffer snapshot never returns a slot that is being overwritten") {
+    tracing::ThreadBuffer buffer(1);
+    std::atomic<bool> stop = false;
+    // в каждом событии длительность равна началу: разорванный слот сразу видно
+    std::thread writer([&] {
+        for (int64_t i = 0; !stop.load(std::memory_order_relaxed); ++i) {
+            buffer.Push("event", i, i);
+        }
+    });
+
+    bool consistent = true;
+    for (int round = 0; round < 2000 && consistent; ++round) {
+        const auto events = buffer.Snapshot();
+        for (size_t i = 0; i < events.size(); ++i) {
+            consistent = consistent && events[i].start_us == events[i].duration_us
+                && (i == 0 || events[i].start_us > events[i - 1].start_us);
+        }
+    }
+    stop = true;
+    writer.join();
+    REQUIRE(consistent);
+}
+
+TEST_CASE("Tracer exports scopes and keeps slow ticks") {
+    auto& tracer = tracing::Tracer::Instance();
+    tracer.SetSlowTickBudget(500us, 2);
+    tracer.SetEnabled(true);
+
+    {
+        tracing::TickTrace tick;
+        tracing::ScopedTrace phase("SlowPhase");
+        std::this_thread::sleep_for(2ms);
+    }
+    {
+        // быстрый тик в самописец не попадает
+        tracing::TickTrace tick;
+        tracing::ScopedTrace phase("FastPhase");
+    }
+    tracer.SetEnabled(false);
+    {
+        tracing::ScopedTrace phase("DisabledPhase");
+    }
+
+    const std::string trace = tracer.DumpChromeTrace();
+    REQUIRE(trace.find("traceEvents") != std::string::npos);
+    REQUIRE(trace.find("SlowPhase") != std::string::npos);
+    REQUIRE(trace.find("FastPhase") != std::string::npos);
+    REQUIRE(trace.find("DisabledPhase") == std::string::npos);
+
+    const std::string slow = tracer.DumpSlowTicks();
+    REQUIRE(slow.find("SlowPhase") != std::string::npos);
+    REQUIRE(slow.find("FastPhase") == std::string::npos);
+}
@@ -0,0 +1,50 @@
+// Собирает бандл карт из config.json: map_bundle <config.json> <bundle>
+// Сервер подхватывает его через --map-bundle, пока бандл не старше конфига.
+
+#include "../src/json_loader.h"
+#include "../src/map_bundle.h"
+#include "../src/request_handler.h"
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+
+using namespace std::literals;
+
+int main(int argc, const char* argv[]) {
+    if (argc != 3) {
+        std::cerr << "Usage: "sv << argv[0] << " <config.json> <bundle>"sv << std::endl;
+        return EXIT_FAILURE;
+    }
+    const std::filesystem::path config_path = argv[1];
+    const std::filesystem::path bundle_path = argv[2];
+
+    try {
+        json_loader::LoadedData data = json_loader::LoadGame(config_path);
+        size_t roads = 0;
+        for (const model::Map& map : data.game.GetMaps()) {
+            boost::json::array loot_types;
+            for (const auto& loot_type : data.loot_type_by_map_id.at(map.GetId())) {
+                loot_types.push_back(loot_type.GetAsJsonObject());
+            }
+            data.map_responses.emplace(map.GetId(),
+                boost::json::serialize(http_handler::ApiRequestHandler::SerializeMap(map, std::move(loot_types))));
+            roads += map.GetRoads().size();
+        }
+        map_bundle::WriteBundle(data, bundle_path);
+
+        // сразу читаем обратно тем же кодом, что и сервер
+        const auto start = std::chrono::steady_clock::now();
+        const json_loader::LoadedData loaded = map_bundle::LoadBundle(bundle_path);
+        const std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+
+        std::cout << "maps: "sv << loaded.game.GetMaps().size() << ", roads: "sv << roads
+            << ", bytes: "sv << std::filesystem::file_size(bundle_path)
+            << ", load: "sv << elapsed.count() << " ms"sv << std::endl;
+    }
+    catch (const std::exception& ex) {
+        std::cerr << ex.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}